@@ -0,0 +1,103 @@
+/*
+ * File:   ModifierBenchmark.cpp
+ * Author: Catherine
+ *
+ * Created on October 19, 2026, 1:05 AM
+ *
+ * This file is a part of Shoddy Battle.
+ * Copyright (C) 2009  Catherine Fitzpatrick and Benjamin Gwin
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program; if not, visit the Free Software Foundation, Inc.
+ * online at http://gnu.org.
+ */
+
+#include <iostream>
+#include <cstdlib>
+#include <ctime>
+#include <new>
+
+#include "../src/mechanics/Modifiers.h"
+
+/**
+ * Micro-benchmark for the modifier accumulation in calculateDamage. Every
+ * call to operator new is counted, so the second line of output should read
+ * zero allocations per iteration.
+ *
+ * Run with "make benchmark".
+ */
+
+namespace {
+int g_allocations = 0;
+}
+
+void *operator new(size_t size) throw(std::bad_alloc) {
+    ++g_allocations;
+    void *p = malloc(size);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+void operator delete(void *p) throw() {
+    free(p);
+}
+
+using namespace shoddybattle;
+
+namespace {
+
+int accumulate(ModifierSet &mods, PriorityMap &stat) {
+    // Roughly what a busy double battle contributes to a single hit.
+    mods[1][2] = makeFraction(3, 4);
+    mods[1][0] = makeFraction(3, 2);
+    mods[2][1] = makeFraction(13, 10);
+    mods[3][3] = makeFraction(2, 1);
+    mods[3][1] = makeFraction(6, 5);
+    mods[0][6] = makeFraction(3, 2);
+    mods[0][0] = makeFraction(80, 1);
+    stat[1] = makeFraction(3, 2);
+    stat[0] = makeFraction(2, 1);
+    int attack = 250;
+    multiplyBy(attack, stat);
+    int damage = multiplyOut(mods[0]) * attack / 50;
+    multiplyBy(damage, 1, mods);
+    multiplyBy(damage, 2, mods);
+    multiplyBy(damage, 3, mods);
+    return damage;
+}
+
+}
+
+int main() {
+    const int ITERATIONS = 10000000;
+    int sum = 0;
+    clock_t start = clock();
+    for (int i = 0; i < ITERATIONS; ++i) {
+        ModifierSet mods;
+        PriorityMap stat;
+        sum += accumulate(mods, stat);
+    }
+    clock_t end = clock();
+    std::cout << "time: " << double(end - start) / CLOCKS_PER_SEC
+            << "s, checksum " << sum << std::endl;
+
+    g_allocations = 0;
+    {
+        ModifierSet mods;
+        PriorityMap stat;
+        sum = accumulate(mods, stat);
+    }
+    std::cout << "allocations per iteration: " << g_allocations
+            << std::endl;
+    return 0;
+}
@@ -59,7 +59,20 @@ OBJECTFILES= \
 	${OBJECTDIR}/src/network/Channel.o \
 	${OBJECTDIR}/src/scripting/PokemonObject.o \
 	${OBJECTDIR}/src/database/sha2.o \
-	${OBJECTDIR}/src/shoddybattle/Team.o
+	${OBJECTDIR}/src/shoddybattle/Team.o \
+	${OBJECTDIR}/src/shoddybattle/StatusList.o \
+	${OBJECTDIR}/src/shoddybattle/BattleRecord.o \
+	${OBJECTDIR}/src/shoddybattle/ReplayBattle.o \
+	${OBJECTDIR}/src/shoddybattle/BattleArena.o \
+	${OBJECTDIR}/src/network/WorkerPool.o \
+	${OBJECTDIR}/src/network/TeamCache.o \
+	${OBJECTDIR}/src/shoddybattle/DataImage.o \
+	${OBJECTDIR}/src/main/StartupGraph.o \
+	${OBJECTDIR}/src/database/LadderCache.o \
+	${OBJECTDIR}/src/database/DatabaseQueue.o \
+	${OBJECTDIR}/src/database/SessionCache.o \
+	${OBJECTDIR}/src/database/LadderIndex.o \
+	${OBJECTDIR}/src/main/ServerStartup.o
 
 # C Compiler Flags
 CFLAGS=
@@ -350,6 +363,71 @@ ${OBJECTDIR}/src/network/ThreadedQueue.h.gch: nbproject/Makefile-${CND_CONF}.mk
 	${RM} $@.d
 	$(COMPILE.cc) -O2 -I/usr/local/include/boost-1_38/ -I/usr/local/include/mysql++ -I/usr/include/mysql -MMD -MP -MF $@.d -o $@ src/network/ThreadedQueue.h
 
+${OBJECTDIR}/src/shoddybattle/StatusList.o: nbproject/Makefile-${CND_CONF}.mk src/shoddybattle/StatusList.cpp 
+	${MKDIR} -p ${OBJECTDIR}/src/shoddybattle
+	${RM} $@.d
+	$(COMPILE.cc) -O2 -I/usr/local/include/boost-1_38/ -I/usr/local/include/mysql++ -I/usr/include/mysql -MMD -MP -MF $@.d -o ${OBJECTDIR}/src/shoddybattle/StatusList.o src/shoddybattle/StatusList.cpp
+
+${OBJECTDIR}/src/shoddybattle/BattleRecord.o: nbproject/Makefile-${CND_CONF}.mk src/shoddybattle/BattleRecord.cpp 
+	${MKDIR} -p ${OBJECTDIR}/src/shoddybattle
+	${RM} $@.d
+	$(COMPILE.cc) -O2 -I/usr/local/include/boost-1_38/ -I/usr/local/include/mysql++ -I/usr/include/mysql -MMD -MP -MF $@.d -o ${OBJECTDIR}/src/shoddybattle/BattleRecord.o src/shoddybattle/BattleRecord.cpp
+
+${OBJECTDIR}/src/shoddybattle/ReplayBattle.o: nbproject/Makefile-${CND_CONF}.mk src/shoddybattle/ReplayBattle.cpp 
+	${MKDIR} -p ${OBJECTDIR}/src/shoddybattle
+	${RM} $@.d
+	$(COMPILE.cc) -O2 -I/usr/local/include/boost-1_38/ -I/usr/local/include/mysql++ -I/usr/include/mysql -MMD -MP -MF $@.d -o ${OBJECTDIR}/src/shoddybattle/ReplayBattle.o src/shoddybattle/ReplayBattle.cpp
+
+${OBJECTDIR}/src/shoddybattle/BattleArena.o: nbproject/Makefile-${CND_CONF}.mk src/shoddybattle/BattleArena.cpp 
+	${MKDIR} -p ${OBJECTDIR}/src/shoddybattle
+	${RM} $@.d
+	$(COMPILE.cc) -O2 -I/usr/local/include/boost-1_38/ -I/usr/local/include/mysql++ -I/usr/include/mysql -MMD -MP -MF $@.d -o ${OBJECTDIR}/src/shoddybattle/BattleArena.o src/shoddybattle/BattleArena.cpp
+
+${OBJECTDIR}/src/network/WorkerPool.o: nbproject/Makefile-${CND_CONF}.mk src/network/WorkerPool.cpp 
+	${MKDIR} -p ${OBJECTDIR}/src/network
+	${RM} $@.d
+	$(COMPILE.cc) -O2 -I/usr/local/include/boost-1_38/ -I/usr/local/include/mysql++ -I/usr/include/mysql -MMD -MP -MF $@.d -o ${OBJECTDIR}/src/network/WorkerPool.o src/network/WorkerPool.cpp
+
+${OBJECTDIR}/src/network/TeamCache.o: nbproject/Makefile-${CND_CONF}.mk src/network/TeamCache.cpp 
+	${MKDIR} -p ${OBJECTDIR}/src/network
+	${RM} $@.d
+	$(COMPILE.cc) -O2 -I/usr/local/include/boost-1_38/ -I/usr/local/include/mysql++ -I/usr/include/mysql -MMD -MP -MF $@.d -o ${OBJECTDIR}/src/network/TeamCache.o src/network/TeamCache.cpp
+
+${OBJECTDIR}/src/shoddybattle/DataImage.o: nbproject/Makefile-${CND_CONF}.mk src/shoddybattle/DataImage.cpp 
+	${MKDIR} -p ${OBJECTDIR}/src/shoddybattle
+	${RM} $@.d
+	$(COMPILE.cc) -O2 -I/usr/local/include/boost-1_38/ -I/usr/local/include/mysql++ -I/usr/include/mysql -MMD -MP -MF $@.d -o ${OBJECTDIR}/src/shoddybattle/DataImage.o src/shoddybattle/DataImage.cpp
+
+${OBJECTDIR}/src/main/StartupGraph.o: nbproject/Makefile-${CND_CONF}.mk src/main/StartupGraph.cpp 
+	${MKDIR} -p ${OBJECTDIR}/src/main
+	${RM} $@.d
+	$(COMPILE.cc) -O2 -I/usr/local/include/boost-1_38/ -I/usr/local/include/mysql++ -I/usr/include/mysql -MMD -MP -MF $@.d -o ${OBJECTDIR}/src/main/StartupGraph.o src/main/StartupGraph.cpp
+
+${OBJECTDIR}/src/database/LadderCache.o: nbproject/Makefile-${CND_CONF}.mk src/database/LadderCache.cpp 
+	${MKDIR} -p ${OBJECTDIR}/src/database
+	${RM} $@.d
+	$(COMPILE.cc) -O2 -I/usr/local/include/boost-1_38/ -I/usr/local/include/mysql++ -I/usr/include/mysql -MMD -MP -MF $@.d -o ${OBJECTDIR}/src/database/LadderCache.o src/database/LadderCache.cpp
+
+${OBJECTDIR}/src/database/DatabaseQueue.o: nbproject/Makefile-${CND_CONF}.mk src/database/DatabaseQueue.cpp 
+	${MKDIR} -p ${OBJECTDIR}/src/database
+	${RM} $@.d
+	$(COMPILE.cc) -O2 -I/usr/local/include/boost-1_38/ -I/usr/local/include/mysql++ -I/usr/include/mysql -MMD -MP -MF $@.d -o ${OBJECTDIR}/src/database/DatabaseQueue.o src/database/DatabaseQueue.cpp
+
+${OBJECTDIR}/src/database/SessionCache.o: nbproject/Makefile-${CND_CONF}.mk src/database/SessionCache.cpp 
+	${MKDIR} -p ${OBJECTDIR}/src/database
+	${RM} $@.d
+	$(COMPILE.cc) -O2 -I/usr/local/include/boost-1_38/ -I/usr/local/include/mysql++ -I/usr/include/mysql -MMD -MP -MF $@.d -o ${OBJECTDIR}/src/database/SessionCache.o src/database/SessionCache.cpp
+
+${OBJECTDIR}/src/database/LadderIndex.o: nbproject/Makefile-${CND_CONF}.mk src/database/LadderIndex.cpp 
+	${MKDIR} -p ${OBJECTDIR}/src/database
+	${RM} $@.d
+	$(COMPILE.cc) -O2 -I/usr/local/include/boost-1_38/ -I/usr/local/include/mysql++ -I/usr/include/mysql -MMD -MP -MF $@.d -o ${OBJECTDIR}/src/database/LadderIndex.o src/database/LadderIndex.cpp
+
+${OBJECTDIR}/src/main/ServerStartup.o: nbproject/Makefile-${CND_CONF}.mk src/main/ServerStartup.cpp 
+	${MKDIR} -p ${OBJECTDIR}/src/main
+	${RM} $@.d
+	$(COMPILE.cc) -O2 -I/usr/local/include/boost-1_38/ -I/usr/local/include/mysql++ -I/usr/include/mysql -MMD -MP -MF $@.d -o ${OBJECTDIR}/src/main/ServerStartup.o src/main/ServerStartup.cpp
+
 # Subprojects
 .build-subprojects:
 
@@ -36,6 +36,8 @@ HoldItem.prototype.use = function() { };
 HoldItem.prototype.consume = function() {
     if (this.subject.fainted)
         return;
+    if (this.subject.field.query)
+        return;
     var effect = this.subject.getStatus("ItemConsumedEffect");
     if (!effect) {
         effect = new StatusEffect("ItemConsumedEffect");
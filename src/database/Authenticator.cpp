@@ -43,8 +43,7 @@ namespace shoddybattle { namespace database {
 
 SECRET_PAIR DefaultAuthenticator::getSecret(ScopedConnection &conn,
         const string &user, const string &) {
-    Query query = conn->query("SELECT password FROM users WHERE name = %0q");
-    query.parse();
+    Query &query = conn.prepare("SELECT password FROM users WHERE name = %0q");
     StoreQueryResult result = query.store(user);
     if (result.empty()) {
         return SECRET_PAIR();
@@ -58,11 +57,10 @@ SECRET_PAIR DefaultAuthenticator::getSecret(ScopedConnection &conn,
 bool DefaultAuthenticator::registerUser(ScopedConnection &conn,
         const string &user, const string &password, const string &ip) {
     string hexPassword = DatabaseRegistry::getShaHexHash(password);
-    Query query = conn->query(
+    Query &query = conn.prepare(
             "INSERT INTO users (name, password, activity, ip) "
             "VALUES (%0q, %1q, now(), %2q)"
         );
-    query.parse();
     query.execute(user, hexPassword, ip);
     return true;
 }
@@ -76,22 +74,32 @@ VBulletinAuthenticator::VBulletinAuthenticator(const string &login,
         const string &database):
             m_database(database),
             m_loginInfo(login),
-            m_registrationInfo(registration) { }
+            m_registrationInfo(registration),
+            m_strikesQuery(
+                "SELECT count(*) AS strikes,"
+                    "unix_timestamp() - MAX(striketime) AS lasttime "
+                "FROM " + database + ".strikes "
+                "WHERE strikeip = %0q "
+                    "AND striketime > (unix_timestamp() - 3600)"),
+            m_secretQuery(
+                "SELECT password, salt "
+                "FROM " + database + ".user "
+                "WHERE username = %0q "
+                    "AND NOT usergroupid IN (3, 8)"),
+            m_strikeQuery(
+                "INSERT INTO " + database + ".strikes "
+                    "(striketime, strikeip, username) "
+                "VALUES (unix_timestamp(), %0q, %1q)"),
+            m_userQuery(
+                "SELECT username, userid FROM " + database + ".user "
+                "WHERE username = %0q") { }
 
 SECRET_PAIR VBulletinAuthenticator::getSecret(ScopedConnection &conn,
         const string &user, const string &ip) {
     // First check the strike system to make sure the IP is allowed to
     // attempt to log in.
     {
-        Query query = conn->query(
-                "SELECT count(*) AS strikes,"
-                    "unix_timestamp() - MAX(striketime) AS lasttime "
-                "FROM " + m_database + ".strikes "
-                "WHERE strikeip = %0q "
-                    "AND striketime > (unix_timestamp() - 3600)"
-            );
-        query.parse();
-        StoreQueryResult result = query.store(ip);
+        StoreQueryResult result = conn.prepare(m_strikesQuery).store(ip);
         const int strikes = result[0][0];
         const int lastTime = result[0][1].is_null() ? 0 : result[0][1];
         // Note: The following arbitrary constants are directly from the
@@ -103,14 +111,7 @@ SECRET_PAIR VBulletinAuthenticator::getSecret(ScopedConnection &conn,
         }
     }
     
-    Query query = conn->query(
-            "SELECT password, salt "
-            "FROM " + m_database + ".user "
-            "WHERE username = %0q "
-                "AND NOT usergroupid IN (3, 8)"
-        );
-    query.parse();
-    StoreQueryResult result = query.store(user);
+    StoreQueryResult result = conn.prepare(m_secretQuery).store(user);
     if (result.empty()) {
         return SECRET_PAIR();
     }
@@ -125,22 +126,11 @@ bool VBulletinAuthenticator::finishAuthentication(ScopedConnection &conn,
         std::string &user, const std::string &ip, const bool success) {
     if (!success) {
         // Give a strike to the IP.
-        Query query = conn->query(
-                "INSERT INTO " + m_database + ".strikes "
-                    "(striketime, strikeip, username) "
-                 "VALUES (unix_timestamp(), %0q, %1q)"
-             );
-        query.parse();
-        query.execute(ip, user);
+        conn.prepare(m_strikeQuery).execute(ip, user);
         return false;
     }
 
-    Query query = conn->query(
-            "SELECT username, userid FROM " + m_database + ".user "
-            "WHERE username = %0q"
-        );
-    query.parse();
-    StoreQueryResult result = query.store(user);
+    StoreQueryResult result = conn.prepare(m_userQuery).store(user);
     if (result.empty()) {
         // This will happen if the forum account is renamed or deleted at the
         // "right" time.
@@ -149,12 +139,11 @@ bool VBulletinAuthenticator::finishAuthentication(ScopedConnection &conn,
     result[0][0].to_string(user);
     const int foreignId = result[0][1];
     
-    Query q2 = conn->query(
+    Query &q2 = conn.prepare(
             "INSERT INTO users (name, foreign_id, activity, ip) "
             "VALUES (%0q, %1q, now(), %2q) "
             "ON DUPLICATE KEY UPDATE name=%0q, activity=now()"
         );
-    q2.parse();
     q2.execute(user, foreignId, ip);
     return true;
 }
@@ -191,11 +180,10 @@ SaltAuthenticator::SaltAuthenticator():
 
 SECRET_PAIR SaltAuthenticator::getSecret(ScopedConnection &conn,
         const string &user, const string &) {
-    Query query = conn->query(
+    Query &query = conn.prepare(
             "SELECT password, salt FROM users "
             "WHERE name = %0q"
         );
-    query.parse();
     StoreQueryResult result = query.store(user);
     if (result.empty()) {
         return SECRET_PAIR();
@@ -213,11 +201,10 @@ bool SaltAuthenticator::registerUser(ScopedConnection &conn,
     boost::to_lower(hexPassword);
     string secret = DatabaseRegistry::getMd5HexHash(hexPassword + salt);
     boost::to_lower(secret);
-    Query query = conn->query(
+    Query &query = conn.prepare(
             "INSERT INTO users (name, password, salt, activity, ip) "
             "VALUES (%0q, %1q, %2q, now(), %3q)"
         );
-    query.parse();
     query.execute(user, secret, salt, ip);
     return true;
 }
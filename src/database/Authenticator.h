@@ -105,6 +105,8 @@ public:
     std::string getRegistrationInfo() const { return m_registrationInfo; }
 private:
     const std::string m_database, m_loginInfo, m_registrationInfo;
+    const std::string m_strikesQuery, m_secretQuery;
+    const std::string m_strikeQuery, m_userQuery;
 };
 
 }} // namespace shoddybattle::database
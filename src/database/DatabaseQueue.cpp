@@ -0,0 +1,258 @@
+/*
+ * File:   DatabaseQueue.cpp
+ * Author: Catherine
+ *
+ * Created on October 19, 2026, 11:55 PM
+ *
+ * This file is a part of Shoddy Battle.
+ * Copyright (C) 2009  Catherine Fitzpatrick and Benjamin Gwin
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program; if not, visit the Free Software Foundation, Inc.
+ * online at http://gnu.org.
+ */
+
+#include <boost/bind.hpp>
+#include <boost/scoped_ptr.hpp>
+#include "DatabaseQueue.h"
+#include "DatabaseRegistry.h"
+#include "../main/Log.h"
+
+using namespace std;
+using namespace boost;
+
+namespace shoddybattle { namespace database {
+
+namespace {
+
+const char *CLASS_NAMES[] = { "auth", "channel", "admin", "write" };
+
+} // anonymous namespace
+
+/**
+ * The state of a query that has a completion handler. Whichever of the
+ * worker starting the query and the timer gets there first claims it; if the
+ * timer does, the query is cancelled and the failure handler is posted.
+ */
+struct DatabaseQueue::PENDING {
+    boost::mutex guard;
+    bool done;
+    asio::io_service *service;
+    HANDLER completion;
+    HANDLER failure;
+    scoped_ptr<asio::deadline_timer> timer;
+};
+
+DatabaseQueue::DatabaseQueue(const int threads, const int capacity):
+        m_capacity(capacity),
+        m_stopping(false) {
+    const METRICS zero = { 0, 0, 0, 0, 0 };
+    for (int i = 0; i < QUERY_CLASS_COUNT; ++i) {
+        m_timeout[i] = 0;
+        m_metrics[i] = zero;
+    }
+    for (int i = 0; i < threads; ++i) {
+        m_threads.create_thread(boost::bind(&DatabaseQueue::work, this));
+    }
+}
+
+DatabaseQueue::~DatabaseQueue() {
+    {
+        lock_guard<boost::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_condition.notify_all();
+    m_threads.join_all();
+}
+
+void DatabaseQueue::setTimeout(const QUERY_CLASS type,
+        const int milliseconds) {
+    lock_guard<boost::mutex> lock(m_mutex);
+    m_timeout[type] = milliseconds;
+}
+
+/**
+ * Claim a pending query for the worker or the timer. Returns false if the
+ * other one already has.
+ */
+bool DatabaseQueue::finish(PENDING_PTR pending) {
+    lock_guard<boost::mutex> lock(pending->guard);
+    if (pending->done)
+        return false;
+    pending->done = true;
+    if (pending->timer) {
+        system::error_code ec;
+        pending->timer->cancel(ec);
+    }
+    return true;
+}
+
+void DatabaseQueue::expire(PENDING_PTR pending,
+        const system::error_code &error) {
+    if (error == asio::error::operation_aborted)
+        return;
+    if (finish(pending)) {
+        pending->failure();
+    }
+}
+
+void DatabaseQueue::post(const QUERY_CLASS type, HANDLER query,
+        asio::io_service &service, HANDLER completion, HANDLER failure) {
+    PENDING_PTR pending(new PENDING());
+    pending->done = false;
+    pending->service = &service;
+    pending->completion = completion;
+    pending->failure = failure;
+
+    unique_lock<boost::mutex> lock(m_mutex);
+    if (int(m_queue.size()) >= m_capacity) {
+        ++m_metrics[type].rejected;
+        lock.unlock();
+        service.post(failure);
+        return;
+    }
+    if (m_timeout[type] > 0) {
+        pending->timer.reset(new asio::deadline_timer(service,
+                posix_time::milliseconds(m_timeout[type])));
+        pending->timer->async_wait(boost::bind(&DatabaseQueue::expire,
+                pending, _1));
+    }
+    const ENTRY entry = { type, query, pending, string() };
+    push(entry);
+    lock.unlock();
+    m_condition.notify_one();
+}
+
+void DatabaseQueue::post(const QUERY_CLASS type, HANDLER query,
+        const string &key) {
+    // The capacity is not checked here: dropping a write would lose it, and
+    // the queue is only over capacity for as long as the database is behind.
+    const ENTRY entry = { type, query, PENDING_PTR(), key };
+    {
+        lock_guard<boost::mutex> lock(m_mutex);
+        push(entry);
+    }
+    m_condition.notify_one();
+}
+
+/**
+ * Add an entry to the queue. The queue mutex must be held.
+ */
+void DatabaseQueue::push(const ENTRY &entry) {
+    m_queue.push_back(entry);
+    METRICS &metrics = m_metrics[entry.type];
+    if (++metrics.depth > metrics.maxDepth) {
+        metrics.maxDepth = metrics.depth;
+    }
+}
+
+/**
+ * Take the first entry off the queue whose key is not held by a running
+ * query, and hold its key. Because the queue is searched in order, an entry
+ * never starts before an earlier one with the same key. Returns false if
+ * every entry is waiting for a key. The queue mutex must be held.
+ */
+bool DatabaseQueue::next(ENTRY &entry) {
+    deque<ENTRY>::iterator i = m_queue.begin();
+    for (; i != m_queue.end(); ++i) {
+        if (i->key.empty() || (m_running.find(i->key) == m_running.end()))
+            break;
+    }
+    if (i == m_queue.end())
+        return false;
+    entry = *i;
+    m_queue.erase(i);
+    if (!entry.key.empty()) {
+        m_running.insert(entry.key);
+    }
+    return true;
+}
+
+void DatabaseQueue::work() {
+    DatabaseRegistry::startThread();
+    unique_lock<boost::mutex> lock(m_mutex);
+    while (true) {
+        ENTRY entry;
+        while (!next(entry) && !(m_queue.empty() && m_stopping)) {
+            m_condition.wait(lock);
+        }
+        if (!entry.query)
+            break;
+        lock.unlock();
+
+        const PENDING_PTR &pending = entry.pending;
+        bool failed = false;
+        if (pending && !finish(pending)) {
+            // The query timed out in the queue; the timer has already posted
+            // the failure handler, so the query is not run at all.
+            failed = true;
+        } else {
+            try {
+                entry.query();
+            } catch (std::exception &e) {
+                Log::out() << "Error in a " << CLASS_NAMES[entry.type]
+                        << " query: " << e.what() << endl;
+                failed = true;
+            }
+            if (pending) {
+                pending->service->post(failed ?
+                        pending->failure : pending->completion);
+            }
+        }
+
+        lock.lock();
+        if (!entry.key.empty()) {
+            m_running.erase(entry.key);
+            // Another worker may be waiting for this key.
+            m_condition.notify_all();
+        }
+        METRICS &metrics = m_metrics[entry.type];
+        --metrics.depth;
+        if (failed) {
+            ++metrics.failed;
+        } else {
+            ++metrics.completed;
+        }
+    }
+}
+
+DatabaseQueue::METRICS DatabaseQueue::getMetrics(
+        const QUERY_CLASS type) const {
+    lock_guard<boost::mutex> lock(m_mutex);
+    return m_metrics[type];
+}
+
+void DatabaseQueue::report() {
+    METRICS metrics[QUERY_CLASS_COUNT];
+    {
+        lock_guard<boost::mutex> lock(m_mutex);
+        for (int i = 0; i < QUERY_CLASS_COUNT; ++i) {
+            METRICS &m = m_metrics[i];
+            metrics[i] = m;
+            m.maxDepth = m.depth;
+            m.completed = m.failed = m.rejected = 0;
+        }
+    }
+    for (int i = 0; i < QUERY_CLASS_COUNT; ++i) {
+        const METRICS &m = metrics[i];
+        if ((m.maxDepth == 0) && (m.completed == 0) && (m.failed == 0)
+                && (m.rejected == 0))
+            continue;
+        Log::out() << "Database queue (" << CLASS_NAMES[i] << "): "
+                << m.depth << " queued, at most " << m.maxDepth << "; "
+                << m.completed << " completed, " << m.failed << " failed, "
+                << m.rejected << " rejected" << endl;
+    }
+}
+
+}} // namespace shoddybattle::database
@@ -0,0 +1,143 @@
+/*
+ * File:   DatabaseQueue.h
+ * Author: Catherine
+ *
+ * Created on October 19, 2026, 11:55 PM
+ *
+ * This file is a part of Shoddy Battle.
+ * Copyright (C) 2009  Catherine Fitzpatrick and Benjamin Gwin
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program; if not, visit the Free Software Foundation, Inc.
+ * online at http://gnu.org.
+ */
+
+#ifndef _DATABASE_QUEUE_H_
+#define _DATABASE_QUEUE_H_
+
+#include <deque>
+#include <set>
+#include <string>
+#include <boost/asio.hpp>
+#include <boost/function.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread.hpp>
+#include <boost/utility.hpp>
+
+namespace shoddybattle { namespace database {
+
+/**
+ * A fixed number of threads that run database queries on behalf of the
+ * network threads, so that a slow query never holds up a network thread.
+ * When a query finishes, its completion handler is posted back to the
+ * io_service of the connection that asked for it.
+ *
+ * Queries without handlers are writes that nobody waits for. They are never
+ * dropped or timed out, and writes that share a key run in the order they
+ * were posted.
+ */
+class DatabaseQueue : boost::noncopyable {
+public:
+    enum QUERY_CLASS {
+        QUERY_AUTH = 0,         // logging in and registering
+        QUERY_CHANNEL = 1,      // joining channels and changing modes
+        QUERY_ADMIN = 2,        // bans and user details
+        QUERY_WRITE = 3,        // personal messages and ladder results
+        QUERY_CLASS_COUNT = 4
+    };
+
+    typedef boost::function<void ()> HANDLER;
+
+    struct METRICS {
+        int depth;          // queries waiting or running
+        int maxDepth;       // since the last report
+        int completed;
+        int failed;         // timed out in the queue or threw an exception
+        int rejected;       // the queue was full
+    };
+
+    DatabaseQueue(const int threads, const int capacity);
+
+    /**
+     * Finish the queries that are already queued, then stop the threads.
+     */
+    ~DatabaseQueue();
+
+    /**
+     * Set how long a query of a class with handlers may wait in the queue.
+     * A query which has not started by then is cancelled; one which has
+     * started always runs to the end and reports how it went. Zero, the
+     * default, means no limit.
+     */
+    void setTimeout(const QUERY_CLASS type, const int milliseconds);
+
+    /**
+     * Run a query on one of the database threads, and then post the
+     * completion handler to an io_service. If the queue is full, the query
+     * throws an exception, or the query has not started by the time the
+     * timeout for its class runs out, the failure handler is posted instead.
+     * Exactly one of the two handlers is called.
+     */
+    void post(const QUERY_CLASS type, HANDLER query,
+            boost::asio::io_service &service,
+            HANDLER completion, HANDLER failure);
+
+    /**
+     * Run a query whose result is not needed. It is queued even if the
+     * queue is full, and does not time out. If a key is given, the query
+     * does not start until every earlier query with the same key has
+     * finished.
+     */
+    void post(const QUERY_CLASS type, HANDLER query,
+            const std::string &key = std::string());
+
+    METRICS getMetrics(const QUERY_CLASS type) const;
+
+    /**
+     * Log the metrics of every class that has been used since the last
+     * report, and start counting again.
+     */
+    void report();
+
+private:
+    struct PENDING;
+    typedef boost::shared_ptr<PENDING> PENDING_PTR;
+
+    struct ENTRY {
+        QUERY_CLASS type;
+        HANDLER query;
+        PENDING_PTR pending;
+        std::string key;
+    };
+
+    static void expire(PENDING_PTR pending,
+            const boost::system::error_code &error);
+    static bool finish(PENDING_PTR pending);
+    void push(const ENTRY &entry);
+    bool next(ENTRY &entry);
+    void work();
+
+    mutable boost::mutex m_mutex;
+    boost::condition_variable m_condition;
+    std::deque<ENTRY> m_queue;
+    std::set<std::string> m_running;    // keys of the queries running
+    const int m_capacity;
+    bool m_stopping;
+    int m_timeout[QUERY_CLASS_COUNT];
+    METRICS m_metrics[QUERY_CLASS_COUNT];
+    boost::thread_group m_threads;
+};
+
+}} // namespace shoddybattle::database
+
+#endif
@@ -27,17 +27,23 @@
 #include "Authenticator.h"
 #include <boost/thread/mutex.hpp>
 #include <boost/thread/locks.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/bind.hpp>
 #include <boost/random.hpp>
+#include <boost/unordered_map.hpp>
 #include <mysql++/mysql++.h>
 #include <mysql++/ssqls.h>
 #include <string>
 #include <sstream>
 #include <ctime>
+#include <algorithm>
 #include "../matchmaking/glicko2.h"
 #include "sha2.h"
 #include "md5.h"
 #include "rijndael.h"
 #include "DatabaseRegistry.h"
+#include "LadderCache.h"
+#include "SessionCache.h"
 #include "../matchmaking/MetagameList.h"
 
 /**
@@ -59,6 +65,33 @@ const double SYSTEM_CONSTANT = 1.2;
 const char *TABLE_STATS_PREFIX = "ladder_stats_";
 const char *TABLE_MATCHES_PREFIX = "ladder_matches_";
 
+/** Number of rows written by each statement when a period is closed. **/
+const int PERIOD_BATCH_SIZE = 500;
+
+/**
+ * A pooled connection that keeps every template query it has parsed, so that
+ * each statement is parsed once per connection rather than once per call.
+ * Statements are looked up by the address of their text. The text is compared
+ * as well, in case the address has been reused for a different statement.
+ */
+class ShoddyConnection : public Connection {
+public:
+    ShoddyConnection(): Connection(false) { }
+    Query &prepare(const char *statement) {
+        STATEMENT_MAP::iterator i = m_statements.find(statement);
+        if ((i != m_statements.end()) && (i->second.first == statement))
+            return *i->second.second;
+        shared_ptr<Query> query(new Query(this->query(statement)));
+        query->parse();
+        m_statements[statement] = make_pair(string(statement), query);
+        return *query;
+    }
+private:
+    typedef unordered_map<const char *,
+            pair<string, shared_ptr<Query> > > STATEMENT_MAP;
+    STATEMENT_MAP m_statements;
+};
+
 class ShoddyConnectionPool : public ConnectionPool {
 public:
     ShoddyConnectionPool() {
@@ -81,7 +114,7 @@ public:
     }
 protected:
     Connection *create() {
-        Connection *conn = new Connection(false);
+        Connection *conn = new ShoddyConnection();
         conn->connect(m_db.c_str(),
                 m_server.c_str(),
                 m_user.c_str(),
@@ -112,13 +145,42 @@ ScopedConnection::~ScopedConnection() {
     m_pool.release(m_conn);
 }
 
+Query &ScopedConnection::prepare(const char *statement) {
+    return static_cast<ShoddyConnection *>(m_conn)->prepare(statement);
+}
+
+Query &ScopedConnection::prepare(const string &statement) {
+    return prepare(statement.c_str());
+}
+
+/**
+ * A ladder's cache, and the statements that write single rows to its tables.
+ * The statements are built when the ladder is first read, so the table names
+ * are not concatenated for every match.
+ */
+struct Ladder : LadderCache {
+    const string insertMatch;
+    const string insertPlayer;
+    Ladder(const string &id):
+            insertMatch(string("insert into ") + TABLE_MATCHES_PREFIX + id
+                + " values (%0q, %1q, %2q, %3q)"),
+            insertPlayer(string("insert into ") + TABLE_STATS_PREFIX + id
+                + " values (%0q, %1q, %2q, %3q, 0, 0, 0, 0)") { }
+};
+
+typedef shared_ptr<Ladder> LADDER_PTR;
+
 struct DatabaseRegistry::DatabaseRegistryImpl {
     typedef variate_generator<mt11213b &,
             uniform_int<> > GENERATOR;
+    typedef map<string, LADDER_PTR> LADDER_MAP;
     ShoddyConnectionPool pool;
     mt11213b rand;     // used for challenge-response
     mutex randMutex;
     shared_ptr<Authenticator> authenticator;
+    LADDER_MAP ladders;
+    mutex ladderMutex;
+    SessionCache sessions;
     DatabaseRegistryImpl() {
         rand = mt11213b(time(NULL));
         authenticator = shared_ptr<Authenticator>(new DefaultAuthenticator());
@@ -129,8 +191,178 @@ struct DatabaseRegistry::DatabaseRegistryImpl {
         GENERATOR r(rand, range);
         return r();
     }
+    LADDER_PTR getLadder(const string &id) {
+        lock_guard<mutex> lock(ladderMutex);
+        LADDER_MAP::const_iterator i = ladders.find(id);
+        if (i == ladders.end())
+            return LADDER_PTR();
+        return i->second;
+    }
+    LADDER_PTR getLadder(ScopedConnection &conn, const string &id);
+    void getLadderIds(vector<string> &ids);
+    void writePeriod(ScopedConnection &conn, const string &ladder,
+            const LadderCache::STATS_LIST &stats, const int period,
+            const time_t start);
+    void closePeriod(ScopedConnection &conn, const string &id,
+            LADDER_PTR ladder, const time_t start);
 };
 
+/**
+ * Get the cache for a ladder, reading it from the database if it has not
+ * been read yet.
+ */
+LADDER_PTR DatabaseRegistry::DatabaseRegistryImpl::getLadder(
+        ScopedConnection &conn, const string &id) {
+    LADDER_PTR ladder = getLadder(id);
+    if (ladder)
+        return ladder;
+
+    ladder = LADDER_PTR(new Ladder(id));
+    int period = 0;
+    time_t start = 0;
+    {
+        Query q = conn->query(
+                "select period, started from ladder_periods where ladder=%0q");
+        q.parse();
+        StoreQueryResult res = q.store(id);
+        if (!res.empty()) {
+            period = res[0][0];
+            if (!res[0][1].is_null()) {
+                start = DateTime(res[0][1]);
+            }
+        }
+        if (start == 0) {
+            // The first period of a new ladder (or of one from before the
+            // start was recorded) starts now.
+            start = time(NULL);
+            Query &query = conn.prepare(
+                    "INSERT INTO ladder_periods (ladder, period, started) "
+                    "VALUES (%0q, %1q, %2q) ON DUPLICATE KEY UPDATE "
+                    "started=%2q");
+            query.execute(id, period, DateTime(start));
+        }
+        ladder->setPeriod(period);
+        ladder->setPeriodStart(start);
+    }
+    {
+        Query q = conn->query("select user, rating, deviation, volatility, ");
+        q << "updated_rating, updated_deviation, updated_volatility, ";
+        q << "estimate, users.name from " << TABLE_STATS_PREFIX << id;
+        q << " left join users on users.id=user";
+        q.parse();
+        StoreQueryResult res = q.store();
+        StoreQueryResult::iterator i = res.begin();
+        for (; i != res.end(); ++i) {
+            Row &row = *i;
+            const int user = row[0];
+            LadderCache::STATS stats;
+            stats.live.rating = row[1];
+            stats.live.deviation = row[2];
+            stats.live.volatility = row[3];
+            stats.updated.rating = row[4];
+            stats.updated.deviation = row[5];
+            stats.updated.volatility = row[6];
+            stats.estimate = row[7];
+            ladder->setStats(user, stats);
+            if (!row[8].is_null()) {
+                string name;
+                row[8].to_string(name);
+                ladder->setName(user, name);
+            }
+        }
+    }
+    {
+        Query q = conn->query("select player1, player2, victor from ");
+        q << TABLE_MATCHES_PREFIX << id << " where period=" << period;
+        q.parse();
+        StoreQueryResult res = q.store();
+        StoreQueryResult::iterator i = res.begin();
+        for (; i != res.end(); ++i) {
+            Row &row = *i;
+            const int player0 = row[0];
+            const int player1 = row[1];
+            const int victor = row[2];
+            ladder->addMatch(player0, player1, victor);
+        }
+    }
+
+    // Another thread may have read the ladder at the same time.
+    lock_guard<mutex> lock(ladderMutex);
+    LADDER_PTR &entry = ladders[id];
+    if (!entry) {
+        entry = ladder;
+    }
+    return entry;
+}
+
+void DatabaseRegistry::DatabaseRegistryImpl::getLadderIds(
+        vector<string> &ids) {
+    lock_guard<mutex> lock(ladderMutex);
+    LADDER_MAP::const_iterator i = ladders.begin();
+    for (; i != ladders.end(); ++i) {
+        ids.push_back(i->first);
+    }
+}
+
+/**
+ * Write the stats from the end of a rating period, a batch of players at a
+ * time, and record the number and start time of the next period. This is
+ * done in a single transaction so that a period is never rated twice.
+ */
+void DatabaseRegistry::DatabaseRegistryImpl::writePeriod(
+        ScopedConnection &conn, const string &ladder,
+        const LadderCache::STATS_LIST &stats, const int period,
+        const time_t start) {
+    Transaction transaction(*conn);
+    LadderCache::STATS_LIST::const_iterator i = stats.begin();
+    while (i != stats.end()) {
+        Query q = conn->query("insert into ");
+        q << TABLE_STATS_PREFIX << ladder << " (user, rating, deviation, ";
+        q << "volatility, estimate, updated_rating, updated_deviation, ";
+        q << "updated_volatility) values ";
+        for (int j = 0; (j < PERIOD_BATCH_SIZE) && (i != stats.end());
+                ++j, ++i) {
+            const glicko2::PLAYER &p = i->second.live;
+            if (j != 0) {
+                q << ",";
+            }
+            q << "(" << i->first << "," << p.rating << "," << p.deviation
+                    << "," << p.volatility << "," << i->second.estimate
+                    << "," << p.rating << "," << p.deviation
+                    << "," << p.volatility << ")";
+        }
+        q << " on duplicate key update "
+                "rating=values(rating), "
+                "deviation=values(deviation), "
+                "volatility=values(volatility), "
+                "estimate=values(estimate), "
+                "updated_rating=values(updated_rating), "
+                "updated_deviation=values(updated_deviation), "
+                "updated_volatility=values(updated_volatility)";
+        q.parse();
+        q.execute();
+    }
+    conn.prepare(
+            "INSERT INTO ladder_periods (ladder, period, started) "
+            "VALUES (%0q, %1q, %2q) "
+            "ON DUPLICATE KEY UPDATE period=%1q, started=%2q").execute(
+                ladder, period + 1, DateTime(start));
+    transaction.commit();
+}
+
+/**
+ * Rate the current period of a ladder and start the next one at the given
+ * time. The ladder's period mutex must be held.
+ */
+void DatabaseRegistry::DatabaseRegistryImpl::closePeriod(
+        ScopedConnection &conn, const string &id, LADDER_PTR ladder,
+        const time_t start) {
+    LadderCache::STATS_LIST stats;
+    ladder->ratePeriod(SYSTEM_CONSTANT, thread::hardware_concurrency(), stats);
+    writePeriod(conn, id, stats, ladder->getPeriod(), start);
+    ladder->finishPeriod(stats, start);
+}
+
 DatabaseRegistry::DatabaseRegistry():
         m_impl(new DatabaseRegistryImpl()) { }
 
@@ -143,6 +375,14 @@ void DatabaseRegistry::setAuthenticator(
     m_impl->authenticator = authenticator;
 }
 
+void DatabaseRegistry::setSessionTimeout(const int seconds) {
+    m_impl->sessions.setTimeout(seconds);
+}
+
+void DatabaseRegistry::expireSessions() {
+    m_impl->sessions.expire();
+}
+
 bool DatabaseRegistry::startThread() {
     return Connection::thread_start();
 }
@@ -216,6 +456,25 @@ void createBansTable(ScopedConnection &conn) {
     query.execute();
 }
 
+void createLadderPeriodsTable(ScopedConnection &conn) {
+    Query query = conn->query(
+            "CREATE TABLE IF NOT EXISTS ladder_periods ("
+                "ladder varchar(100) primary key,"
+                "period int(11),"
+                "started datetime)");
+    query.parse();
+    query.execute();
+
+    // Tables created before the start of a period was recorded.
+    Query columns = conn->query(
+            "SHOW COLUMNS FROM ladder_periods LIKE 'started'");
+    if (columns.store().empty()) {
+        Query alter = conn->query(
+                "ALTER TABLE ladder_periods ADD COLUMN started datetime");
+        alter.execute();
+    }
+}
+
 } //anonymous namespace
 
 void DatabaseRegistry::createDefaultDatabase() {
@@ -225,6 +484,7 @@ void DatabaseRegistry::createDefaultDatabase() {
     createUsersTable(conn);
     createChannelUsersTable(conn);
     createBansTable(conn);
+    createLadderPeriodsTable(conn);
 }
 
 static const char *HEX_TABLE = "0123456789ABCDEF";
@@ -276,10 +536,13 @@ string DatabaseRegistry::getMd5HexHash(const string &message) {
     return getHexString(digest, 16);
 }
 
+bool DatabaseRegistry::isBanExpired(const int date) {
+    return (date != 0) && (date < time(NULL));
+}
+
 bool DatabaseRegistry::userExists(const string name) {
     ScopedConnection conn(m_impl->pool);
-    Query query = conn->query("select count(id) from users where name = %0q");
-    query.parse();
+    Query &query = conn.prepare("select count(id) from users where name = %0q");
     StoreQueryResult res = query.store(name);
     int count = res[0][0];
     return (count != 0);
@@ -304,45 +567,65 @@ void DatabaseRegistry::getChannelInfo(DatabaseRegistry::CHANNEL_INFO &info) {
 	
 void DatabaseRegistry::setChannelFlags(const int channel, const int flags) {
     ScopedConnection conn(m_impl->pool);
-    Query query = conn->query("update channels set flags=");
-    query << flags << " where id=" << channel;
-    query.execute();
+    Query &query = conn.prepare(
+            "update channels set flags=%0q where id=%1q");
+    query.execute(flags, channel);
 }
 
 void DatabaseRegistry::setUserFlags(const int channel, const int idx,
         const int flags) {
     ScopedConnection conn(m_impl->pool);
-    Query query = conn->query(
+    Query &query = conn.prepare(
             "INSERT INTO channel_users (channel_id, user_id, flags) "
             "VALUES (%0q, %1q, %2q) "
             "ON DUPLICATE KEY UPDATE flags=%2q");
-    query.parse();
     query.execute(channel, idx, flags);
+    m_impl->sessions.updateFlags(channel, idx, flags);
 }
 
 int DatabaseRegistry::getUserFlags(const int channel, const string &user) {
+    int flags;
+    if (m_impl->sessions.getFlags(channel, user, flags))
+        return flags;
+    const SessionCache::TICKET ticket = m_impl->sessions.getTicket();
     ScopedConnection conn(m_impl->pool);
-    Query query = conn->query(
-            "SELECT flags FROM channel_users "
-            "WHERE channel_id=%0q "
-                "AND user_id=(SELECT id FROM users WHERE name=%1q)");
-    query.parse();
+    // The user's id is read as well, so that the flags can be found in the
+    // cache by id.
+    Query &query = conn.prepare(
+            "SELECT users.id, channel_users.flags FROM users "
+                "LEFT JOIN channel_users "
+                    "ON channel_users.user_id=users.id "
+                        "AND channel_users.channel_id=%0q "
+            "WHERE users.name=%1q");
     StoreQueryResult result = query.store(channel, user);
     if (result.empty())
         return 0;
-    return result[0][0];
+    const int id = result[0][0];
+    flags = result[0][1].is_null() ? 0 : int(result[0][1]);
+    m_impl->sessions.storeFlags(ticket, channel, user, id, flags);
+    return flags;
 }
 
 int DatabaseRegistry::getUserFlags(const int channel, const int idx) {
+    int flags;
+    if (m_impl->sessions.getFlags(channel, idx, flags))
+        return flags;
+    const SessionCache::TICKET ticket = m_impl->sessions.getTicket();
     ScopedConnection conn(m_impl->pool);
-    Query query = conn->query(
-            "SELECT flags FROM channel_users "
-            "WHERE channel_id=%0q AND user_id=%1q");
-    query.parse();
+    Query &query = conn.prepare(
+            "SELECT users.name, channel_users.flags FROM users "
+                "LEFT JOIN channel_users "
+                    "ON channel_users.user_id=users.id "
+                        "AND channel_users.channel_id=%0q "
+            "WHERE users.id=%1q");
     StoreQueryResult result = query.store(channel, idx);
     if (result.empty())
         return 0;
-    return result[0][0];
+    string user;
+    result[0][0].to_string(user);
+    flags = result[0][1].is_null() ? 0 : int(result[0][1]);
+    m_impl->sessions.storeFlags(ticket, channel, user, idx, flags);
+    return flags;
 }
 
 int DatabaseRegistry::getMaxLevel(const int channel, const string &user) {
@@ -350,13 +633,12 @@ int DatabaseRegistry::getMaxLevel(const int channel, const string &user) {
     //       because the maximum level is not the numerically highest value
     //       of flags.
     ScopedConnection conn(m_impl->pool);
-    Query query = conn->query(
+    Query &query = conn.prepare(
             "SELECT MAX(flags) FROM channel_users "
             "WHERE channel_id=%0q "
                 "AND user_id IN (SELECT id FROM users WHERE ip=("
                     "SELECT ip FROM users WHERE name=%1q"
                 "))");
-    query.parse();
     StoreQueryResult res = query.store(channel, user);
     if (res.empty()) {
         return 0;
@@ -365,24 +647,64 @@ int DatabaseRegistry::getMaxLevel(const int channel, const string &user) {
 }
 
 double DatabaseRegistry::getRatingEstimate(const int id, const std::string &ladder) {
-    const string table = TABLE_STATS_PREFIX + ladder;
     ScopedConnection conn(m_impl->pool);
-    Query query = conn->query("select estimate from %0 where user = %1");
-    query.parse();
-    StoreQueryResult result = query.store(table, id);
-    if (result.empty())
+    LadderCache::STATS stats;
+    if (!m_impl->getLadder(conn, ladder)->getStats(id, stats))
         return -1;
 
-    return result[0][0];
+    return stats.estimate;
 }
 
 DatabaseRegistry::ESTIMATE_LIST DatabaseRegistry::getEstimates(const int id,
         const std::vector<GenerationPtr> &metagames) {
     ESTIMATE_LIST list;
-    // TODO: Think on the format of ladder stats. Until then, return blank
+    int ladder = 0;
+    vector<GenerationPtr>::const_iterator i = metagames.begin();
+    for (; i != metagames.end(); ++i) {
+        const vector<MetagamePtr> &ladders = (*i)->getMetagames();
+        vector<MetagamePtr>::const_iterator j = ladders.begin();
+        for (; j != ladders.end(); ++j, ++ladder) {
+            LADDER_PTR cache = m_impl->getLadder((*j)->getId());
+            LadderCache::STATS stats;
+            if (cache && cache->getStats(id, stats)) {
+                list.push_back(ESTIMATE_ELEMENT(ladder, stats.estimate));
+            }
+        }
+    }
     return list;
 }
 
+int DatabaseRegistry::getStandings(const string &ladder, const int position,
+        const int count, STANDING_LIST &standings) {
+    LADDER_PTR cache = m_impl->getLadder(ladder);
+    if (!cache)
+        return -1;
+    cache->getStandings(position, count, standings);
+    return cache->getSize();
+}
+
+int DatabaseRegistry::getStandingsAround(const string &ladder,
+        const string &user, const int count, STANDING_LIST &standings) {
+    LADDER_PTR cache = m_impl->getLadder(ladder);
+    if (!cache)
+        return -1;
+    const int position = cache->getPosition(user);
+    if (position != -1) {
+        cache->getStandings(max(0, position - count / 2), count, standings);
+    }
+    return cache->getSize();
+}
+
+int DatabaseRegistry::getStandingsNear(const string &ladder,
+        const double rating, const int count, STANDING_LIST &standings) {
+    LADDER_PTR cache = m_impl->getLadder(ladder);
+    if (!cache)
+        return -1;
+    const int position = cache->getPosition(rating);
+    cache->getStandings(max(0, position - count / 2), count, standings);
+    return cache->getSize();
+}
+
 void DatabaseRegistry::initialiseLadder(const std::string &id) {
     const string table1 = TABLE_STATS_PREFIX + id;
     const string table2 = TABLE_MATCHES_PREFIX + id;
@@ -391,8 +713,22 @@ void DatabaseRegistry::initialiseLadder(const std::string &id) {
         Query query = conn->query("show tables like %0q");
         query.parse();
         StoreQueryResult result = query.store(table1);
-        if (!result.empty())
+        if (!result.empty()) {
+            // Ladders created before there were rating periods have all of
+            // their matches put in the first period.
+            Query q = conn->query("show columns from ");
+            q << table2 << " like 'period'";
+            q.parse();
+            if (q.store().empty()) {
+                Query alter = conn->query("alter table ");
+                alter << table2 << " add column period int(11) not null ";
+                alter << "default 0, add index (period)";
+                alter.parse();
+                alter.execute();
+            }
+            m_impl->getLadder(conn, id);
             return;
+        }
     }
     {
         Query query = conn->query("create table ");
@@ -406,98 +742,78 @@ void DatabaseRegistry::initialiseLadder(const std::string &id) {
     {
         Query query = conn->query("create table ");
         query << table2 << " (player1 int(11), player2 int(11), ";
-        query << "victor int(4))";
+        query << "victor int(4), period int(11) not null default 0, ";
+        query << "index (period))";
         query.parse();
         query.execute();
     }
+    m_impl->getLadder(conn, id);
 }
 
-void DatabaseRegistry::updatePlayerStats(const string &ladder,
-        const int id) {
-    const string table1 = TABLE_STATS_PREFIX + ladder;
-    const string table2 = TABLE_MATCHES_PREFIX + ladder;
-    vector<glicko2::MATCH> matches;
+void DatabaseRegistry::joinLadder(const string &ladder, const int id,
+        const string &name) {
     ScopedConnection conn(m_impl->pool);
-    StoreQueryResult res;
-    {
-        Query q = conn->query("select * from ");
-        q << table2 << " where player1=" << id << " or player2=" << id;
-        q.parse();
-        res = q.store();
-    }
-    StoreQueryResult::iterator i = res.begin();
-    for (; i != res.end(); ++i) {
-        Row &row = *i;
-        const int player0 = row[0];
-        const int player1 = row[1];
-        const int v = row[2];
-        const int score = (v == -1) ? -1 : (int(row[v]) == id);
-        const int opponent = (player0 == id) ? player1 : player0;
-        Query q = conn->query("select rating, deviation from ");
-        q << table1 << " where user=" << opponent;
-        q.parse();
-        StoreQueryResult res2 = q.store();
-        if (!res2.empty()) {
-            Row &r2 = res2[0];
-            const double rating = r2[0];
-            const double deviation = r2[1];
-            glicko2::MATCH match = { score, rating, deviation };
-            matches.push_back(match);
-        }
-    }
-    {
-        Query q = conn->query("select rating, deviation, volatility from ");
-        q << table1 << " where user=" << id;
-        q.parse();
-        res = q.store();
-    }
-    if (res.empty())
+    LADDER_PTR cache = m_impl->getLadder(conn, ladder);
+    if (cache->hasPlayer(id))
         return;
-    Row &r = res[0];
-    const double rating = r[0];
-    const double deviation = r[1];
-    const double volatility = r[2];
-    glicko2::PLAYER player = { rating, deviation, volatility };
-    glicko2::updatePlayer(player, matches, SYSTEM_CONSTANT);
-    const double estimate = glicko2::getRatingEstimate(player.rating,
-            player.deviation);
-    Query q = conn->query("update ");
-    q << table1 << " set updated_rating=" << player.rating
-            << ", updated_deviation=" << player.deviation
-            << ", updated_volatility=" << player.volatility
-            << ", estimate=" << estimate << " where user=" << id;
-    q.parse();
-    q.execute();
-}
-
-void DatabaseRegistry::joinLadder(const string &ladder, const int id) {
-    const string table = TABLE_STATS_PREFIX + ladder;
-    ScopedConnection conn(m_impl->pool);
-    {
-        Query query = conn->query("select user from ");
-        query << table << " where user=" << id;
-        query.parse();
-        StoreQueryResult result = query.store();
-        if (!result.empty())
-            return;
-    }
-    Query query = conn->query("insert into ");
-    query << table << " values (" << id << "," << INITIAL_RATING << ","
-            << INITIAL_DEVIATION << "," << INITIAL_VOLATILITY
-            << ",0,0,0,0)";
-    query.parse();
-    query.execute();
+    cache->setName(id, name);
+    Query &query = conn.prepare(cache->insertPlayer);
+    query.execute(id, INITIAL_RATING, INITIAL_DEVIATION, INITIAL_VOLATILITY);
+    const glicko2::PLAYER initial =
+            { INITIAL_RATING, INITIAL_DEVIATION, INITIAL_VOLATILITY };
+    const glicko2::PLAYER zero = { 0, 0, 0 };
+    LadderCache::STATS stats = { initial, zero, 0 };
+    cache->setStats(id, stats);
 }
 
 void DatabaseRegistry::postLadderMatch(const string &ladder,
         const int player0, const int player1, int victor) {
-    const string table = TABLE_MATCHES_PREFIX + ladder;
     ScopedConnection conn(m_impl->pool);
-    Query query = conn->query("insert into ");
-    query << table << " values (" << player0 << "," << player1
-            << "," << victor << ")";
-    query.parse();
-    query.execute();
+    LADDER_PTR cache = m_impl->getLadder(conn, ladder);
+    lock_guard<mutex> lock(cache->getPeriodMutex());
+    Query &query = conn.prepare(cache->insertMatch);
+    query.execute(player0, player1, victor, cache->getPeriod());
+    cache->addMatch(player0, player1, victor);
+}
+
+void DatabaseRegistry::closeRatingPeriod(const string &ladder) {
+    ScopedConnection conn(m_impl->pool);
+    LADDER_PTR cache = m_impl->getLadder(conn, ladder);
+    lock_guard<mutex> lock(cache->getPeriodMutex());
+    m_impl->closePeriod(conn, ladder, cache, time(NULL));
+}
+
+void DatabaseRegistry::closeRatingPeriods() {
+    vector<string> ladders;
+    m_impl->getLadderIds(ladders);
+    for_each(ladders.begin(), ladders.end(),
+            boost::bind(&DatabaseRegistry::closeRatingPeriod, this, _1));
+}
+
+int DatabaseRegistry::closeDueRatingPeriods(const int length,
+        time_t &next) {
+    const time_t now = time(NULL);
+    next = now + length;
+    vector<string> ladders;
+    m_impl->getLadderIds(ladders);
+    int closed = 0;
+    ScopedConnection conn(m_impl->pool);
+    vector<string>::const_iterator i = ladders.begin();
+    for (; i != ladders.end(); ++i) {
+        LADDER_PTR cache = m_impl->getLadder(conn, *i);
+        lock_guard<mutex> lock(cache->getPeriodMutex());
+        // Each period that ended while the server was down is closed in
+        // turn, so that inactive players lose the same certainty that they
+        // would have if the server had been up.
+        time_t end = cache->getPeriodStart() + length;
+        while (end <= now) {
+            m_impl->closePeriod(conn, *i, cache, end);
+            ++closed;
+            end += length;
+        }
+        next = min(next, end);
+    }
+    return closed;
 }
 
 DatabaseRegistry::AUTH_PAIR DatabaseRegistry::isResponseValid(
@@ -533,8 +849,8 @@ DatabaseRegistry::AUTH_PAIR DatabaseRegistry::isResponseValid(
 
     int id = -1;
     if (match) {
-        Query query = conn->query("select id from users where name = %0q");
-        query.parse();
+        Query &query =
+                conn.prepare("select id from users where name = %0q");
         StoreQueryResult result = query.store(name);
         if (result.empty()) {
             // It should be impossible to get here.
@@ -589,8 +905,12 @@ bool DatabaseRegistry::registerUser(const string name,
 
 int DatabaseRegistry::getGlobalBan(const std::string &user,
         const std::string &ip) {
+    int date;
+    if (m_impl->sessions.getGlobalBan(user, ip, date))
+        return date;
+    const SessionCache::TICKET ticket = m_impl->sessions.getTicket();
     ScopedConnection conn(m_impl->pool);
-    Query query = conn->query(
+    Query &query = conn.prepare(
             "SELECT expiry "
             "FROM bans "
             "WHERE channel_id=-1 "
@@ -603,18 +923,23 @@ int DatabaseRegistry::getGlobalBan(const std::string &user,
                 ") "
             "ORDER BY expiry DESC "
             "LIMIT 0, 1");
-    query.parse();
     StoreQueryResult res = query.store(user, ip);
-    if (res.empty()) {
-        return 0;
-    }
-    return (int)DateTime(res[0][0]);
+    date = res.empty() ? 0 : (int)DateTime(res[0][0]);
+    m_impl->sessions.storeGlobalBan(ticket, user, ip, date);
+    return date;
 }
 
 void DatabaseRegistry::getBan(const int channel, const string &user,
         int &date, int &flags) {
+    SessionCache::BAN ban;
+    if (m_impl->sessions.getBan(channel, user, ban)) {
+        date = ban.first;
+        flags = ban.second;
+        return;
+    }
+    const SessionCache::TICKET ticket = m_impl->sessions.getTicket();
     ScopedConnection conn(m_impl->pool);
-    Query query = conn->query(
+    Query &query = conn.prepare(
             "SELECT expiry, IF(channel_users.flags, channel_users.flags, 0) "
             "FROM bans "
                 "LEFT JOIN channel_users "
@@ -622,25 +947,26 @@ void DatabaseRegistry::getBan(const int channel, const string &user,
                         "AND channel_users.channel_id=bans.channel_id "
             "WHERE bans.channel_id=%0q "
                 "AND bans.user_id=(SELECT id FROM users WHERE name=%1q)");
-    query.parse();
     StoreQueryResult res = query.store(channel, user);
     if (res.empty()) {
         date = flags = 0;
-        return;
+    } else {
+        date = (int)DateTime(res[0][0]);
+        flags = (int)res[0][1];
     }
-    date = (int)DateTime(res[0][0]);
-    flags = (int)res[0][1];
+    m_impl->sessions.storeBan(ticket, channel, user,
+            SessionCache::BAN(date, flags));
 }
 
 void DatabaseRegistry::removeBan(const int channel, const string &user) {
     ScopedConnection conn(m_impl->pool);
-    Query query = conn->query(
+    Query &query = conn.prepare(
             "DELETE FROM bans WHERE channel_id=%0q AND user_id=("
                     "SELECT id FROM users WHERE name=%1q"
                 ")"
             );
-    query.parse();
     query.execute(channel, user);
+    m_impl->sessions.updateBan(channel, user, SessionCache::BAN(0, 0));
 }
 
 bool DatabaseRegistry::setBan(const int channel, const string &user,
@@ -649,65 +975,80 @@ bool DatabaseRegistry::setBan(const int channel, const string &user,
         // No ban to set.
         return false;
     }
-    ScopedConnection conn(m_impl->pool);
-    Query query = conn->query(
-            "INSERT INTO bans "
-                "(channel_id, user_id, mod_id, expiry, ip_ban) "
-            "VALUES (%0q, (SELECT id FROM users WHERE name=%1q), %2q, "
-                "%3q, %4q) "
-            "ON DUPLICATE KEY UPDATE mod_id=%2q, expiry=%3q, ip_ban=%4q");
-    query.parse();
-    query.execute(channel, user, modId, DateTime(date), ipBan);
+    {
+        ScopedConnection conn(m_impl->pool);
+        Query &query = conn.prepare(
+                "INSERT INTO bans "
+                    "(channel_id, user_id, mod_id, expiry, ip_ban) "
+                "VALUES (%0q, (SELECT id FROM users WHERE name=%1q), %2q, "
+                    "%3q, %4q) "
+                "ON DUPLICATE KEY UPDATE "
+                    "mod_id=%2q, expiry=%3q, ip_ban=%4q");
+        query.execute(channel, user, modId, DateTime(date), ipBan);
+    }
+    // The moderator is normally on the channel, so their flags are cached.
+    const int flags = getUserFlags(channel, modId);
+    m_impl->sessions.updateBan(channel, user,
+            SessionCache::BAN(int(date), flags));
     return true;
 }
 
 void DatabaseRegistry::updateIp(const string &user, const string &ip) {
     ScopedConnection conn(m_impl->pool);
-    Query query = conn->query("update users set ip= %0q where name= %1q");
-    query.parse();
+    Query &query = conn.prepare("update users set ip= %0q where name= %1q");
     query.execute(ip, user);
+    m_impl->sessions.updateIp(user, ip);
 }
 
 string DatabaseRegistry::getIp(const string &user) {
+    string ip;
+    if (m_impl->sessions.getIp(user, ip))
+        return ip;
+    const SessionCache::TICKET ticket = m_impl->sessions.getTicket();
     ScopedConnection conn(m_impl->pool);
-    Query query = conn->query("select ip from users where name= %0q");
-    query.parse();
+    Query &query = conn.prepare("select ip from users where name= %0q");
     StoreQueryResult res = query.store(user);
-    if (res.empty()) {
-        return string();
-    } else {
-        string ip;
+    if (!res.empty()) {
         res[0][0].to_string(ip);
-        return ip;
     }
+    m_impl->sessions.storeIp(ticket, user, ip);
+    return ip;
 }
 
 const vector<string> DatabaseRegistry::getAliases(const string &user) {
-    ScopedConnection conn(m_impl->pool);
-    Query query = conn->query("select name from users where ip=");
-    query << "(select ip from users where name= %0q)";
-    query.parse();
-    StoreQueryResult res = query.store(user);
+    // The address is looked up separately so that it can come from the
+    // cache, and so that the aliases are cached against it.
+    const string ip = getIp(user);
     vector<string> ret;
+    if (ip.empty() || m_impl->sessions.getAliases(user, ip, ret))
+        return ret;
+    const SessionCache::TICKET ticket = m_impl->sessions.getTicket();
+    ScopedConnection conn(m_impl->pool);
+    Query &query = conn.prepare("select name from users where ip= %0q");
+    StoreQueryResult res = query.store(ip);
     const int size = res.num_rows();
     for (int i = 0; i < size; ++i) {
         string alias;
         res[i][0].to_string(alias);
         ret.push_back(alias);
     }
+    m_impl->sessions.storeAliases(ticket, user, ip, ret);
     return ret;
 }
 
 const DatabaseRegistry::BAN_LIST DatabaseRegistry::getBans(const string &user) {
+    const string ip = getIp(user);
+    DatabaseRegistry::BAN_LIST bans;
+    if (ip.empty() || m_impl->sessions.getBans(user, ip, bans))
+        return bans;
+    const SessionCache::TICKET ticket = m_impl->sessions.getTicket();
     ScopedConnection conn(m_impl->pool);
-    Query query = conn->query(
+    Query &query = conn.prepare(
             "SELECT bans.channel_id, users.name, bans.expiry, bans.ip_ban "
             "FROM bans "
                 "JOIN users ON users.id=bans.user_id "
-            "WHERE users.ip=(SELECT ip FROM users WHERE name=%0q)");
-    query.parse();
-    StoreQueryResult res = query.store(user);
-    DatabaseRegistry::BAN_LIST bans;
+            "WHERE users.ip=%0q");
+    StoreQueryResult res = query.store(ip);
     const int count = res.num_rows();
     for (int i = 0; i < count; ++i) {
         Row r = res[i];
@@ -717,26 +1058,31 @@ const DatabaseRegistry::BAN_LIST DatabaseRegistry::getBans(const string &user) {
         const bool ipBan = (bool)r[3];
         bans.push_back(BAN_ELEMENT(id, name, date, ipBan));
     }
+    m_impl->sessions.storeBans(ticket, user, ip, bans);
     return bans;
 }
 
 void DatabaseRegistry::setPersonalMessage(const string &user, const string &msg) {
     ScopedConnection conn(m_impl->pool);
-    Query query = conn->query("update users set message= %0q where name= %1q");
-    query.parse();
+    Query &query = conn.prepare(
+            "update users set message= %0q where name= %1q");
     query.execute(msg, user);
+    m_impl->sessions.updateMessage(user, msg);
 }
 
 void DatabaseRegistry::loadPersonalMessage(const string &user, string &msg) {
+    if (m_impl->sessions.getMessage(user, msg))
+        return;
+    const SessionCache::TICKET ticket = m_impl->sessions.getTicket();
     ScopedConnection conn(m_impl->pool);
-    Query query = conn->query("select message from users where name= %0q");
-    query.parse();
+    Query &query = conn.prepare("select message from users where name= %0q");
     StoreQueryResult res = query.store(user);
     if (res.empty() || res[0][0].is_null()) {
         msg = "";
     } else {
         res[0][0].to_string(msg);
     }
+    m_impl->sessions.storeMessage(ticket, user, msg);
 }
 
 }} // namespace shoddybattle::database
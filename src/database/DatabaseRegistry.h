@@ -27,6 +27,7 @@
 
 #include <string>
 #include <map>
+#include <ctime>
 #include <vector>
 #include <boost/tuple/tuple.hpp>
 #include <boost/shared_ptr.hpp>
@@ -35,6 +36,7 @@
 namespace mysqlpp {
 class ConnectionPool;
 class Connection;
+class Query;
 }
 
 namespace shoddybattle { namespace database {
@@ -47,6 +49,17 @@ public:
     mysqlpp::Connection *operator->() {
         return m_conn;
     }
+    mysqlpp::Connection &operator*() {
+        return *m_conn;
+    }
+
+    /**
+     * Get a parsed template query for a statement. The query is parsed the
+     * first time the statement is run on this connection and reused after
+     * that, so the statement should be a constant.
+     */
+    mysqlpp::Query &prepare(const char *statement);
+    mysqlpp::Query &prepare(const std::string &statement);
 private:
     mysqlpp::Connection *m_conn;
     mysqlpp::ConnectionPool &m_pool;
@@ -67,6 +80,8 @@ public:
     typedef std::vector<BAN_ELEMENT> BAN_LIST;
     typedef boost::tuple<int, double> ESTIMATE_ELEMENT;
     typedef std::vector<ESTIMATE_ELEMENT> ESTIMATE_LIST;
+    typedef boost::tuple<int, std::string, double> STANDING_ELEMENT;
+    typedef std::vector<STANDING_ELEMENT> STANDING_LIST;
 
     DatabaseRegistry();
 
@@ -76,12 +91,29 @@ public:
     static std::string getShaHexHash(const std::string &);
     static std::string getMd5HexHash(const std::string &);
 
+    /**
+     * Whether a ban date read by getBan or getGlobalBan has passed. A date
+     * of zero means that there is no ban, so there is nothing to remove.
+     */
+    static bool isBanExpired(const int date);
+
     /**
      * This needs to be called by every thread that is going to be making
      * use of the DatabaseRegistry.
      */
     static bool startThread();
 
+    /**
+     * Set the number of seconds that what has been read about a user is
+     * kept before it is read again. Zero disables the cache.
+     */
+    void setSessionTimeout(const int seconds);
+
+    /**
+     * Forget the users whose cached data has all timed out.
+     */
+    void expireSessions();
+
     /**
      * Connect to a database.
      */
@@ -199,22 +231,71 @@ public:
     double getRatingEstimate(const int id, const std::string &ladder);
 
     /**
-     * Get a user's ladder estimates
+     * Get a user's estimate on each ladder that they are on. Each ladder is
+     * identified by its position in the list of every generation's
+     * metagames.
      */
     ESTIMATE_LIST getEstimates(const int id, 
             const std::vector<GenerationPtr> &metagames);
 
+    /**
+     * Get up to count players from the standings of a ladder, starting at a
+     * position (counting from zero). Each element holds a player's rank,
+     * name and estimate. The standings come from memory, not the database.
+     * Returns the number of players on the ladder, or -1 if there is no such
+     * ladder.
+     */
+    int getStandings(const std::string &ladder, const int position,
+            const int count, STANDING_LIST &standings);
+
+    /**
+     * Get up to count players from the standings of a ladder, centred on a
+     * user. If the user is not on the ladder, no players are returned.
+     */
+    int getStandingsAround(const std::string &ladder, const std::string &user,
+            const int count, STANDING_LIST &standings);
+
+    /**
+     * Get up to count players from the standings of a ladder, centred on the
+     * place that a player with a given rating would take.
+     */
+    int getStandingsNear(const std::string &ladder, const double rating,
+            const int count, STANDING_LIST &standings);
+
     /**
      * Initialise the tables required for a ladder.
      */
     void initialiseLadder(const std::string &id);
 
+    /**
+     * Record the result of a ladder match in the current rating period.
+     * Nobody's rating changes until the period is closed.
+     */
     void postLadderMatch(const std::string &ladder, const int player0,
             const int player1, int victor);
 
-    void joinLadder(const std::string &, const int);
+    void joinLadder(const std::string &ladder, const int id,
+            const std::string &name);
 
-    void updatePlayerStats(const std::string &ladder, const int id);
+    /**
+     * Rate every player on a ladder on the matches of the current period,
+     * and start a new period now.
+     */
+    void closeRatingPeriod(const std::string &ladder);
+
+    /**
+     * Close the current rating period of every ladder.
+     */
+    void closeRatingPeriods();
+
+    /**
+     * Close every rating period that started at least length seconds ago,
+     * by the wall clock, including any that ended while the server was not
+     * running. The next period starts where the closed one ended. Returns
+     * the number of periods closed, and sets next to the time at which the
+     * next one is due.
+     */
+    int closeDueRatingPeriods(const int length, time_t &next);
     
     void setPersonalMessage(const std::string &user, const std::string &message);
     
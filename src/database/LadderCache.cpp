@@ -0,0 +1,212 @@
+/*
+ * File:   LadderCache.cpp
+ * Author: Catherine
+ *
+ * Created on October 19, 2026, 11:40 PM
+ *
+ * This file is a part of Shoddy Battle.
+ * Copyright (C) 2009  Catherine Fitzpatrick and Benjamin Gwin
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program; if not, visit the Free Software Foundation, Inc.
+ * online at http://gnu.org.
+ */
+
+#include <algorithm>
+#include <boost/bind.hpp>
+#include <boost/ref.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/locks.hpp>
+#include <boost/algorithm/string.hpp>
+#include "LadderCache.h"
+
+using namespace std;
+using namespace boost;
+
+namespace shoddybattle { namespace database {
+
+/**
+ * Store a player's stats and move them to their new place in the standings.
+ * The caller holds m_mutex.
+ */
+void LadderCache::putStats(const int id, const STATS &stats) {
+    STATS_MAP::iterator i = m_stats.find(id);
+    if (i == m_stats.end()) {
+        m_stats[id] = stats;
+    } else {
+        m_index.erase(id, i->second.estimate);
+        i->second = stats;
+    }
+    m_index.insert(id, stats.estimate);
+}
+
+void LadderCache::setStats(const int id, const STATS &stats) {
+    lock_guard<mutex> lock(m_mutex);
+    putStats(id, stats);
+}
+
+bool LadderCache::getStats(const int id, STATS &stats) const {
+    lock_guard<mutex> lock(m_mutex);
+    STATS_MAP::const_iterator i = m_stats.find(id);
+    if (i == m_stats.end())
+        return false;
+    stats = i->second;
+    return true;
+}
+
+bool LadderCache::hasPlayer(const int id) const {
+    lock_guard<mutex> lock(m_mutex);
+    return (m_stats.find(id) != m_stats.end());
+}
+
+void LadderCache::setName(const int id, const string &name) {
+    lock_guard<mutex> lock(m_mutex);
+    m_names[id] = name;
+    m_ids[to_lower_copy(name)] = id;
+}
+
+int LadderCache::getSize() const {
+    lock_guard<mutex> lock(m_mutex);
+    return m_index.size();
+}
+
+int LadderCache::getPosition(const string &name) const {
+    lock_guard<mutex> lock(m_mutex);
+    ID_MAP::const_iterator i = m_ids.find(to_lower_copy(name));
+    if (i == m_ids.end())
+        return -1;
+    STATS_MAP::const_iterator j = m_stats.find(i->second);
+    if (j == m_stats.end())
+        return -1;
+    return m_index.getPosition(i->second, j->second.estimate);
+}
+
+int LadderCache::getPosition(const double rating) const {
+    lock_guard<mutex> lock(m_mutex);
+    return m_index.getPosition(rating);
+}
+
+void LadderCache::getStandings(const int position, const int count,
+        DatabaseRegistry::STANDING_LIST &standings) const {
+    vector<LadderIndex::ENTRY> entries;
+    lock_guard<mutex> lock(m_mutex);
+    m_index.getRange(position, count, entries);
+    const int size = entries.size();
+    for (int i = 0; i < size; ++i) {
+        const LadderIndex::ENTRY &entry = entries[i];
+        NAME_MAP::const_iterator name = m_names.find(entry.id);
+        standings.push_back(DatabaseRegistry::STANDING_ELEMENT(
+                position + i + 1,
+                (name == m_names.end()) ? string() : name->second,
+                entry.estimate));
+    }
+}
+
+void LadderCache::addMatch(const int player0, const int player1,
+        const int victor) {
+    const int score = (victor == -1) ? -1 : (victor == 0);
+    const RESULT result0 = { player1, score };
+    const RESULT result1 = { player0, (score == -1) ? -1 : (1 - score) };
+    lock_guard<mutex> lock(m_mutex);
+    m_matches[player0].push_back(result0);
+    m_matches[player1].push_back(result1);
+}
+
+int LadderCache::getPeriod() const {
+    lock_guard<mutex> lock(m_mutex);
+    return m_period;
+}
+
+void LadderCache::setPeriod(const int period) {
+    lock_guard<mutex> lock(m_mutex);
+    m_period = period;
+}
+
+time_t LadderCache::getPeriodStart() const {
+    lock_guard<mutex> lock(m_mutex);
+    return m_periodStart;
+}
+
+void LadderCache::setPeriodStart(const time_t start) {
+    lock_guard<mutex> lock(m_mutex);
+    m_periodStart = start;
+}
+
+void LadderCache::ratePlayers(const STATS_MAP &players,
+        const MATCH_MAP &matches, const double system,
+        STATS_LIST::iterator begin, STATS_LIST::iterator end) {
+    vector<glicko2::MATCH> period;
+    for (; begin != end; ++begin) {
+        STATS &stats = begin->second;
+        period.clear();
+        MATCH_MAP::const_iterator i = matches.find(begin->first);
+        if (i != matches.end()) {
+            const vector<RESULT> &results = i->second;
+            vector<RESULT>::const_iterator j = results.begin();
+            for (; j != results.end(); ++j) {
+                STATS_MAP::const_iterator opponent = players.find(j->opponent);
+                if (opponent == players.end())
+                    continue;
+                // Every match is rated against the opponent's stats from the
+                // start of the period.
+                const glicko2::PLAYER &live = opponent->second.live;
+                glicko2::MATCH match =
+                        { j->score, live.rating, live.deviation };
+                period.push_back(match);
+            }
+        }
+        glicko2::PLAYER player = stats.live;
+        glicko2::updatePlayer(player, period, system);
+        stats.live = stats.updated = player;
+        stats.estimate =
+                glicko2::getRatingEstimate(player.rating, player.deviation);
+    }
+}
+
+void LadderCache::ratePeriod(const double system, const int threads,
+        STATS_LIST &stats) const {
+    STATS_MAP players;
+    MATCH_MAP matches;
+    {
+        lock_guard<mutex> lock(m_mutex);
+        players = m_stats;
+        matches = m_matches;
+    }
+    stats.assign(players.begin(), players.end());
+
+    const int count = stats.size();
+    const int parts = max(1, min(threads, count / 64));
+    thread_group group;
+    STATS_LIST::iterator begin = stats.begin();
+    for (int i = 0; i < parts; ++i) {
+        STATS_LIST::iterator end = stats.begin() + count * (i + 1) / parts;
+        group.create_thread(boost::bind(&LadderCache::ratePlayers,
+                boost::cref(players), boost::cref(matches), system,
+                begin, end));
+        begin = end;
+    }
+    group.join_all();
+}
+
+void LadderCache::finishPeriod(const STATS_LIST &stats, const time_t start) {
+    lock_guard<mutex> lock(m_mutex);
+    STATS_LIST::const_iterator i = stats.begin();
+    for (; i != stats.end(); ++i) {
+        putStats(i->first, i->second);
+    }
+    m_matches.clear();
+    ++m_period;
+    m_periodStart = start;
+}
+
+}} // namespace shoddybattle::database
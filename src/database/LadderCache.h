@@ -0,0 +1,163 @@
+/*
+ * File:   LadderCache.h
+ * Author: Catherine
+ *
+ * Created on October 19, 2026, 11:40 PM
+ *
+ * This file is a part of Shoddy Battle.
+ * Copyright (C) 2009  Catherine Fitzpatrick and Benjamin Gwin
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program; if not, visit the Free Software Foundation, Inc.
+ * online at http://gnu.org.
+ */
+
+#ifndef _LADDER_CACHE_H_
+#define _LADDER_CACHE_H_
+
+#include <string>
+#include <vector>
+#include <utility>
+#include <ctime>
+#include <boost/thread/mutex.hpp>
+#include <boost/unordered_map.hpp>
+#include "../matchmaking/glicko2.h"
+#include "DatabaseRegistry.h"
+#include "LadderIndex.h"
+
+namespace shoddybattle { namespace database {
+
+/**
+ * The stats of one ladder and the matches played in its current rating
+ * period. The ladder is read from the database once, and then kept up to date
+ * as matches are posted, so that closing a period does not need to read
+ * anything back from the database. The players are also kept in order of
+ * their estimates, so that the standings can be read without the database.
+ */
+class LadderCache {
+public:
+    struct STATS {
+        glicko2::PLAYER live;
+        glicko2::PLAYER updated;
+        double estimate;
+    };
+
+    typedef std::vector<std::pair<int, STATS> > STATS_LIST;
+
+    LadderCache(): m_period(0), m_periodStart(0) { }
+
+    /**
+     * Add a player's stats, replacing any that were already present.
+     */
+    void setStats(const int id, const STATS &stats);
+
+    bool getStats(const int id, STATS &stats) const;
+
+    bool hasPlayer(const int id) const;
+
+    /**
+     * Set the name that a player is listed under in the standings.
+     */
+    void setName(const int id, const std::string &name);
+
+    /**
+     * Get the number of players on the ladder.
+     */
+    int getSize() const;
+
+    /**
+     * Get the position of a player in the standings, counting from zero, or
+     * -1 if the player is not on the ladder.
+     */
+    int getPosition(const std::string &name) const;
+
+    /**
+     * Get the position that a player with a given rating would take.
+     */
+    int getPosition(const double rating) const;
+
+    /**
+     * Get up to count players from the standings, starting at a position.
+     */
+    void getStandings(const int position, const int count,
+            DatabaseRegistry::STANDING_LIST &standings) const;
+
+    int getPeriod() const;
+    void setPeriod(const int period);
+
+    /**
+     * The wall clock time at which the current period started.
+     */
+    time_t getPeriodStart() const;
+    void setPeriodStart(const time_t start);
+
+    /**
+     * Record a match in the current period. The victor is 0 or 1, or -1 for
+     * a draw.
+     */
+    void addMatch(const int player0, const int player1, const int victor);
+
+    /**
+     * Rate every player on the matches of the current period, splitting the
+     * work across a number of threads. The cache itself is not changed until
+     * finishPeriod is called. Matches against opponents who are not on the
+     * ladder are ignored.
+     */
+    void ratePeriod(const double system, const int threads,
+            STATS_LIST &stats) const;
+
+    /**
+     * Store the stats computed by ratePeriod and start the next period,
+     * which is taken to have started at the given time.
+     */
+    void finishPeriod(const STATS_LIST &stats, const time_t start);
+
+    /**
+     * Held while a match is being posted or a period is being closed, so
+     * that a match cannot be recorded in a period that has been rated.
+     */
+    boost::mutex &getPeriodMutex() {
+        return m_periodMutex;
+    }
+
+private:
+    struct RESULT {
+        int opponent;
+        int score;
+    };
+
+    typedef boost::unordered_map<int, STATS> STATS_MAP;
+    typedef boost::unordered_map<int, std::vector<RESULT> > MATCH_MAP;
+    typedef boost::unordered_map<int, std::string> NAME_MAP;
+    typedef boost::unordered_map<std::string, int> ID_MAP;
+
+    void putStats(const int id, const STATS &stats);
+
+    static void ratePlayers(const STATS_MAP &players, const MATCH_MAP &matches,
+            const double system, STATS_LIST::iterator begin,
+            STATS_LIST::iterator end);
+
+    mutable boost::mutex m_mutex;
+    boost::mutex m_periodMutex;
+    STATS_MAP m_stats;
+    MATCH_MAP m_matches;
+    LadderIndex m_index;
+    NAME_MAP m_names;
+    ID_MAP m_ids;       // keyed by lower case name
+    int m_period;
+    time_t m_periodStart;
+};
+
+}} // namespace shoddybattle::database
+
+#endif
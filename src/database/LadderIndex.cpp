@@ -0,0 +1,248 @@
+/*
+ * File:   LadderIndex.cpp
+ * Author: Catherine
+ *
+ * Created on October 19, 2026, 12:45 AM
+ *
+ * This file is a part of Shoddy Battle.
+ * Copyright (C) 2009  Catherine Fitzpatrick and Benjamin Gwin
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program; if not, visit the Free Software Foundation, Inc.
+ * online at http://gnu.org.
+ */
+
+#include "LadderIndex.h"
+
+using namespace std;
+
+namespace shoddybattle { namespace database {
+
+struct LadderIndex::NODE {
+    ENTRY entry;
+    unsigned int priority;
+    int size;
+    NODE *left;
+    NODE *right;
+};
+
+LadderIndex::~LadderIndex() {
+    destroy(m_root);
+}
+
+void LadderIndex::destroy(NODE *node) {
+    if (!node)
+        return;
+    destroy(node->left);
+    destroy(node->right);
+    delete node;
+}
+
+int LadderIndex::size(const NODE *node) {
+    return node ? node->size : 0;
+}
+
+int LadderIndex::size() const {
+    return size(m_root);
+}
+
+void LadderIndex::update(NODE *node) {
+    node->size = size(node->left) + size(node->right) + 1;
+}
+
+/**
+ * xorshift; the priorities only need to be spread out, not unpredictable.
+ */
+unsigned int LadderIndex::getPriority() {
+    m_seed ^= m_seed << 13;
+    m_seed ^= m_seed >> 17;
+    m_seed ^= m_seed << 5;
+    return m_seed;
+}
+
+/**
+ * Split a tree into the entries that precede an entry and the rest.
+ */
+void LadderIndex::split(NODE *node, const ENTRY &entry, NODE *&left,
+        NODE *&right) {
+    if (!node) {
+        left = right = NULL;
+    } else if (precedes(node->entry, entry)) {
+        split(node->right, entry, node->right, right);
+        left = node;
+        update(node);
+    } else {
+        split(node->left, entry, left, node->left);
+        right = node;
+        update(node);
+    }
+}
+
+/**
+ * Join two trees, where every entry in the left tree precedes every entry in
+ * the right tree.
+ */
+LadderIndex::NODE *LadderIndex::merge(NODE *left, NODE *right) {
+    if (!left)
+        return right;
+    if (!right)
+        return left;
+    if (left->priority > right->priority) {
+        left->right = merge(left->right, right);
+        update(left);
+        return left;
+    }
+    right->left = merge(left, right->left);
+    update(right);
+    return right;
+}
+
+LadderIndex::NODE *LadderIndex::eraseFirst(NODE *node) {
+    if (!node->left) {
+        NODE *right = node->right;
+        delete node;
+        return right;
+    }
+    node->left = eraseFirst(node->left);
+    update(node);
+    return node;
+}
+
+void LadderIndex::insert(const int id, const double estimate) {
+    NODE *node = new NODE();
+    node->entry.id = id;
+    node->entry.estimate = estimate;
+    node->priority = getPriority();
+    node->size = 1;
+    node->left = node->right = NULL;
+    NODE *left, *right;
+    split(m_root, node->entry, left, right);
+    m_root = merge(merge(left, node), right);
+}
+
+void LadderIndex::erase(const int id, const double estimate) {
+    const ENTRY entry = { id, estimate };
+    NODE *left, *right;
+    split(m_root, entry, left, right);
+    // The entry, if it is present, is the first one in the right tree.
+    const NODE *first = right;
+    while (first && first->left) {
+        first = first->left;
+    }
+    if (first && (first->entry.id == id)) {
+        right = eraseFirst(right);
+    }
+    m_root = merge(left, right);
+}
+
+int LadderIndex::getPosition(const int id, const double estimate) const {
+    const ENTRY entry = { id, estimate };
+    int position = 0;
+    const NODE *node = m_root;
+    while (node) {
+        if (precedes(entry, node->entry)) {
+            node = node->left;
+        } else if (precedes(node->entry, entry)) {
+            position += size(node->left) + 1;
+            node = node->right;
+        } else {
+            return position + size(node->left);
+        }
+    }
+    return -1;
+}
+
+int LadderIndex::getPosition(const double rating) const {
+    int position = 0;
+    const NODE *node = m_root;
+    while (node) {
+        if (node->entry.estimate > rating) {
+            position += size(node->left) + 1;
+            node = node->right;
+        } else {
+            node = node->left;
+        }
+    }
+    return position;
+}
+
+/**
+ * Append the entries of a subtree whose positions are in [begin, end), where
+ * base is the position of the first entry in the subtree. Subtrees outside
+ * the range are not visited.
+ */
+void LadderIndex::collect(const NODE *node, int base, const int begin,
+        const int end, vector<ENTRY> &entries) {
+    while (node && (base < end) && (base + node->size > begin)) {
+        const int position = base + size(node->left);
+        collect(node->left, base, begin, end, entries);
+        if ((position >= begin) && (position < end)) {
+            entries.push_back(node->entry);
+        }
+        base = position + 1;
+        node = node->right;
+    }
+}
+
+void LadderIndex::getRange(const int position, const int count,
+        vector<ENTRY> &entries) const {
+    // position and count come from clients, so position + count may not fit
+    // in an int.
+    const int total = size(m_root);
+    if ((position < 0) || (position >= total) || (count <= 0))
+        return;
+    const int end = (count > total - position) ? total : (position + count);
+    collect(m_root, 0, position, end, entries);
+}
+
+}} // namespace shoddybattle::database
+
+#if 0
+
+#include <iostream>
+#include <cstdlib>
+#include <boost/date_time/posix_time/posix_time.hpp>
+
+using namespace shoddybattle::database;
+using namespace boost::posix_time;
+
+/**
+ * Time the index against the sorted vector that ORDER BY estimate amounts
+ * to, for a ladder where every player's estimate changes.
+ */
+int main() {
+    const int PLAYERS = 100000;
+    std::vector<double> estimates(PLAYERS);
+    LadderIndex index;
+    for (int i = 0; i < PLAYERS; ++i) {
+        estimates[i] = 1000 + rand() % 1000;
+        index.insert(i, estimates[i]);
+    }
+    ptime start = microsec_clock::universal_time();
+    for (int i = 0; i < PLAYERS; ++i) {
+        index.erase(i, estimates[i]);
+        estimates[i] = 1000 + rand() % 1000;
+        index.insert(i, estimates[i]);
+    }
+    ptime mid = microsec_clock::universal_time();
+    long total = 0;
+    for (int i = 0; i < PLAYERS; ++i) {
+        total += index.getPosition(i, estimates[i]);
+    }
+    ptime end = microsec_clock::universal_time();
+    std::cout << "update: " << (mid - start) << std::endl;
+    std::cout << "rank:   " << (end - mid) << " (" << total << ")"
+            << std::endl;
+}
+
+#endif
@@ -0,0 +1,108 @@
+/*
+ * File:   LadderIndex.h
+ * Author: Catherine
+ *
+ * Created on October 19, 2026, 12:45 AM
+ *
+ * This file is a part of Shoddy Battle.
+ * Copyright (C) 2009  Catherine Fitzpatrick and Benjamin Gwin
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program; if not, visit the Free Software Foundation, Inc.
+ * online at http://gnu.org.
+ */
+
+#ifndef _LADDER_INDEX_H_
+#define _LADDER_INDEX_H_
+
+#include <vector>
+#include <boost/noncopyable.hpp>
+
+namespace shoddybattle { namespace database {
+
+/**
+ * The players on a ladder in order of their rating estimate, highest first,
+ * with ties broken by id. This is a treap in which every node knows the size
+ * of its subtree, so finding a player's position and finding the player at a
+ * position both take O(log n) time, and a range of k players takes
+ * O(log n + k) time.
+ *
+ * A LadderIndex is not thread safe.
+ */
+class LadderIndex : boost::noncopyable {
+public:
+    struct ENTRY {
+        int id;
+        double estimate;
+    };
+
+    LadderIndex(): m_root(NULL), m_seed(2463534242u) { }
+    ~LadderIndex();
+
+    int size() const;
+
+    /**
+     * Add a player. The player must not already be present.
+     */
+    void insert(const int id, const double estimate);
+
+    /**
+     * Remove a player, who must be present with this estimate.
+     */
+    void erase(const int id, const double estimate);
+
+    /**
+     * Get the position of a player, counting from zero, or -1 if the player
+     * is not present with this estimate.
+     */
+    int getPosition(const int id, const double estimate) const;
+
+    /**
+     * Get the number of players with an estimate higher than a rating, which
+     * is the position that a player with that rating would take.
+     */
+    int getPosition(const double rating) const;
+
+    /**
+     * Get up to count players, starting from a position.
+     */
+    void getRange(const int position, const int count,
+            std::vector<ENTRY> &entries) const;
+
+private:
+    struct NODE;
+
+    static bool precedes(const ENTRY &a, const ENTRY &b) {
+        return (a.estimate > b.estimate)
+                || ((a.estimate == b.estimate) && (a.id < b.id));
+    }
+
+    static int size(const NODE *node);
+    static void update(NODE *node);
+    static void split(NODE *node, const ENTRY &entry, NODE *&left,
+            NODE *&right);
+    static NODE *merge(NODE *left, NODE *right);
+    static NODE *eraseFirst(NODE *node);
+    static void collect(const NODE *node, int base, const int begin,
+            const int end, std::vector<ENTRY> &entries);
+    static void destroy(NODE *node);
+
+    unsigned int getPriority();
+
+    NODE *m_root;
+    unsigned int m_seed;
+};
+
+}} // namespace shoddybattle::database
+
+#endif
@@ -0,0 +1,398 @@
+/*
+ * File:   SessionCache.cpp
+ * Author: Catherine
+ *
+ * Created on October 19, 2026, 12:20 AM
+ *
+ * This file is a part of Shoddy Battle.
+ * Copyright (C) 2009  Catherine Fitzpatrick and Benjamin Gwin
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program; if not, visit the Free Software Foundation, Inc.
+ * online at http://gnu.org.
+ */
+
+#include <boost/thread/locks.hpp>
+#include <boost/algorithm/string.hpp>
+#include "SessionCache.h"
+
+using namespace std;
+using namespace boost;
+
+namespace shoddybattle { namespace database {
+
+namespace {
+
+bool mentions(const vector<string> &names, const string &user) {
+    vector<string>::const_iterator i = names.begin();
+    for (; i != names.end(); ++i) {
+        if (iequals(*i, user))
+            return true;
+    }
+    return false;
+}
+
+bool mentions(const DatabaseRegistry::BAN_LIST &bans, const string &user) {
+    DatabaseRegistry::BAN_LIST::const_iterator i = bans.begin();
+    for (; i != bans.end(); ++i) {
+        if (iequals(i->get<1>(), user))
+            return true;
+    }
+    return false;
+}
+
+} // anonymous namespace
+
+void SessionCache::setTimeout(const int seconds) {
+    lock_guard<mutex> lock(m_mutex);
+    m_timeout = seconds;
+    ++m_writes;
+}
+
+SessionCache::TICKET SessionCache::getTicket() {
+    lock_guard<mutex> lock(m_mutex);
+    return m_writes;
+}
+
+SessionCache::SESSION *SessionCache::find(const string &user) {
+    SESSION_MAP::iterator i = m_sessions.find(to_lower_copy(user));
+    if (i == m_sessions.end())
+        return NULL;
+    return &i->second;
+}
+
+SessionCache::SESSION *SessionCache::find(const int id) {
+    ID_MAP::const_iterator i = m_ids.find(id);
+    if (i == m_ids.end())
+        return NULL;
+    return find(i->second);
+}
+
+/**
+ * Forget which user has an id, unless it has since been given to another.
+ */
+void SessionCache::removeId(const int id, const string &key) {
+    ID_MAP::iterator i = m_ids.find(id);
+    if ((i != m_ids.end()) && (i->second == key)) {
+        m_ids.erase(i);
+    }
+}
+
+SessionCache::SESSION &SessionCache::get(const string &user,
+        const time_t now) {
+    SESSION &session = m_sessions[to_lower_copy(user)];
+    session.loaded = now;
+    return session;
+}
+
+bool SessionCache::getFlags(const int channel, const string &user,
+        int &flags) {
+    lock_guard<mutex> lock(m_mutex);
+    SESSION *session = find(user);
+    if (!session)
+        return false;
+    map<int, ENTRY<int> >::const_iterator i = session->flags.find(channel);
+    if ((i == session->flags.end())
+            || !i->second.isFresh(time(NULL), m_timeout))
+        return false;
+    flags = i->second.value;
+    return true;
+}
+
+bool SessionCache::getFlags(const int channel, const int id, int &flags) {
+    lock_guard<mutex> lock(m_mutex);
+    SESSION *session = find(id);
+    if (!session)
+        return false;
+    map<int, ENTRY<int> >::const_iterator i = session->flags.find(channel);
+    if ((i == session->flags.end())
+            || !i->second.isFresh(time(NULL), m_timeout))
+        return false;
+    flags = i->second.value;
+    return true;
+}
+
+void SessionCache::storeFlags(const TICKET ticket, const int channel,
+        const string &user, const int id, const int flags) {
+    lock_guard<mutex> lock(m_mutex);
+    if (!isCurrent(ticket))
+        return;
+    const time_t now = time(NULL);
+    SESSION &session = get(user, now);
+    if (session.id != id) {
+        removeId(session.id, to_lower_copy(user));
+        session.id = id;
+        m_ids[id] = to_lower_copy(user);
+    }
+    session.flags[channel].set(flags, now);
+}
+
+void SessionCache::updateFlags(const int channel, const int id,
+        const int flags) {
+    lock_guard<mutex> lock(m_mutex);
+    ++m_writes;
+    const time_t now = time(NULL);
+    // Every flags entry has its user's id, so if there is no user with this
+    // id then there is nothing to update.
+    SESSION *session = find(id);
+    if (session) {
+        session->loaded = now;
+        session->flags[channel].set(flags, now);
+    }
+    // Bans on the channel carry the flags of whoever set them.
+    SESSION_MAP::iterator i = m_sessions.begin();
+    for (; i != m_sessions.end(); ++i) {
+        i->second.bans.erase(channel);
+    }
+}
+
+bool SessionCache::getBan(const int channel, const string &user, BAN &ban) {
+    lock_guard<mutex> lock(m_mutex);
+    SESSION *session = find(user);
+    if (!session)
+        return false;
+    map<int, ENTRY<BAN> >::const_iterator i = session->bans.find(channel);
+    if ((i == session->bans.end())
+            || !i->second.isFresh(time(NULL), m_timeout))
+        return false;
+    ban = i->second.value;
+    return true;
+}
+
+void SessionCache::storeBan(const TICKET ticket, const int channel,
+        const string &user, const BAN &ban) {
+    lock_guard<mutex> lock(m_mutex);
+    if (!isCurrent(ticket))
+        return;
+    const time_t now = time(NULL);
+    get(user, now).bans[channel].set(ban, now);
+}
+
+void SessionCache::updateBan(const int channel, const string &user,
+        const BAN &ban) {
+    lock_guard<mutex> lock(m_mutex);
+    ++m_writes;
+    const time_t now = time(NULL);
+    get(user, now).bans[channel].set(ban, now);
+    // A user's ban list includes the bans of everybody sharing the user's ip
+    // address, and a global ban can be an ip ban, so these are dropped for
+    // everybody.
+    SESSION_MAP::iterator i = m_sessions.begin();
+    for (; i != m_sessions.end(); ++i) {
+        i->second.banList.loaded = 0;
+        if (channel == -1) {
+            i->second.globalBan.loaded = 0;
+        }
+    }
+}
+
+bool SessionCache::getGlobalBan(const string &user, const string &ip,
+        int &date) {
+    lock_guard<mutex> lock(m_mutex);
+    SESSION *session = find(user);
+    if (!session || !session->globalBan.isFresh(time(NULL), m_timeout)
+            || (session->globalBan.value.first != ip))
+        return false;
+    date = session->globalBan.value.second;
+    return true;
+}
+
+void SessionCache::storeGlobalBan(const TICKET ticket, const string &user,
+        const string &ip, const int date) {
+    lock_guard<mutex> lock(m_mutex);
+    if (!isCurrent(ticket))
+        return;
+    const time_t now = time(NULL);
+    get(user, now).globalBan.set(make_pair(ip, date), now);
+}
+
+bool SessionCache::getIp(const string &user, string &ip) {
+    lock_guard<mutex> lock(m_mutex);
+    SESSION *session = find(user);
+    if (!session || !session->ip.isFresh(time(NULL), m_timeout))
+        return false;
+    ip = session->ip.value;
+    return true;
+}
+
+void SessionCache::storeIp(const TICKET ticket, const string &user,
+        const string &ip) {
+    lock_guard<mutex> lock(m_mutex);
+    if (!isCurrent(ticket))
+        return;
+    const time_t now = time(NULL);
+    get(user, now).ip.set(ip, now);
+}
+
+void SessionCache::updateIp(const string &user, const string &ip) {
+    lock_guard<mutex> lock(m_mutex);
+    ++m_writes;
+    const time_t now = time(NULL);
+    SESSION &session = get(user, now);
+    const bool known = session.ip.isFresh(now, m_timeout);
+    const string old = session.ip.value;
+    session.ip.set(ip, now);
+    if (known && (old == ip))
+        return;
+
+    // The user has left the users at the old address and joined those at
+    // the new one. If the old address is not known, anything that names the
+    // user has to go.
+    SESSION_MAP::iterator i = m_sessions.begin();
+    for (; i != m_sessions.end(); ++i) {
+        SESSION &s = i->second;
+        const ALIASES &aliases = s.aliases.value;
+        if ((aliases.first == ip) || (known && (aliases.first == old))
+                || mentions(aliases.second, user)) {
+            s.aliases.loaded = 0;
+        }
+        const BANS &bans = s.banList.value;
+        if ((bans.first == ip) || (known && (bans.first == old))
+                || mentions(bans.second, user)) {
+            s.banList.loaded = 0;
+        }
+        const pair<string, int> &ban = s.globalBan.value;
+        if ((ban.first == ip)
+                || (known ? (ban.first == old) : (ban.second != 0))) {
+            s.globalBan.loaded = 0;
+        }
+    }
+}
+
+bool SessionCache::getAliases(const string &user, const string &ip,
+        vector<string> &aliases) {
+    lock_guard<mutex> lock(m_mutex);
+    SESSION *session = find(user);
+    if (!session || !session->aliases.isFresh(time(NULL), m_timeout)
+            || (session->aliases.value.first != ip))
+        return false;
+    aliases = session->aliases.value.second;
+    return true;
+}
+
+void SessionCache::storeAliases(const TICKET ticket, const string &user,
+        const string &ip, const vector<string> &aliases) {
+    lock_guard<mutex> lock(m_mutex);
+    if (!isCurrent(ticket))
+        return;
+    const time_t now = time(NULL);
+    get(user, now).aliases.set(make_pair(ip, aliases), now);
+}
+
+bool SessionCache::getBans(const string &user, const string &ip,
+        DatabaseRegistry::BAN_LIST &bans) {
+    lock_guard<mutex> lock(m_mutex);
+    SESSION *session = find(user);
+    if (!session || !session->banList.isFresh(time(NULL), m_timeout)
+            || (session->banList.value.first != ip))
+        return false;
+    bans = session->banList.value.second;
+    return true;
+}
+
+void SessionCache::storeBans(const TICKET ticket, const string &user,
+        const string &ip, const DatabaseRegistry::BAN_LIST &bans) {
+    lock_guard<mutex> lock(m_mutex);
+    if (!isCurrent(ticket))
+        return;
+    const time_t now = time(NULL);
+    get(user, now).banList.set(make_pair(ip, bans), now);
+}
+
+bool SessionCache::getMessage(const string &user, string &message) {
+    lock_guard<mutex> lock(m_mutex);
+    SESSION *session = find(user);
+    if (!session || !session->message.isFresh(time(NULL), m_timeout))
+        return false;
+    message = session->message.value;
+    return true;
+}
+
+void SessionCache::storeMessage(const TICKET ticket, const string &user,
+        const string &message) {
+    lock_guard<mutex> lock(m_mutex);
+    if (!isCurrent(ticket))
+        return;
+    const time_t now = time(NULL);
+    get(user, now).message.set(message, now);
+}
+
+void SessionCache::updateMessage(const string &user, const string &message) {
+    lock_guard<mutex> lock(m_mutex);
+    ++m_writes;
+    const time_t now = time(NULL);
+    get(user, now).message.set(message, now);
+}
+
+void SessionCache::expire() {
+    lock_guard<mutex> lock(m_mutex);
+    const time_t now = time(NULL);
+    SESSION_MAP::iterator i = m_sessions.begin();
+    while (i != m_sessions.end()) {
+        if (now - i->second.loaded < m_timeout) {
+            ++i;
+            continue;
+        }
+        removeId(i->second.id, i->first);
+        i = m_sessions.erase(i);
+    }
+}
+
+}} // namespace shoddybattle::database
+
+#if 0
+
+#include <iostream>
+#include "DatabaseRegistry.h"
+
+using namespace shoddybattle::database;
+
+/**
+ * Check that joining a channel as a user who has never been banned does not
+ * write anything. Channel::handleBan reads the ban through the cache and only
+ * removes it, which DatabaseRegistry::removeBan records as a write, if it has
+ * expired.
+ */
+int join(SessionCache &cache, const int channel, const std::string &user) {
+    SessionCache::BAN ban;
+    if (!cache.getBan(channel, user, ban))
+        return -1;
+    if (DatabaseRegistry::isBanExpired(ban.first)) {
+        cache.updateBan(channel, user, SessionCache::BAN(0, 0));
+    }
+    return ban.first;
+}
+
+int main() {
+    SessionCache cache;
+    // What getBan stores after reading a user with no ban.
+    cache.storeBan(cache.getTicket(), 1, "clean", SessionCache::BAN(0, 0));
+    cache.storeBan(cache.getTicket(), 1, "expired",
+            SessionCache::BAN(time(NULL) - 60, 0));
+
+    const SessionCache::TICKET before = cache.getTicket();
+    for (int i = 0; i < 1000; ++i) {
+        if (join(cache, 1, "clean") != 0) {
+            std::cout << "clean user not cached" << std::endl;
+            return 1;
+        }
+    }
+    const SessionCache::TICKET clean = cache.getTicket() - before;
+    join(cache, 1, "expired");
+    const SessionCache::TICKET expired = cache.getTicket() - before - clean;
+    std::cout << "writes for 1000 clean joins: " << clean << std::endl;
+    std::cout << "writes for an expired ban: " << expired << std::endl;
+    return ((clean == 0) && (expired == 1)) ? 0 : 1;
+}
+
+#endif
@@ -0,0 +1,171 @@
+/*
+ * File:   SessionCache.h
+ * Author: Catherine
+ *
+ * Created on October 19, 2026, 12:20 AM
+ *
+ * This file is a part of Shoddy Battle.
+ * Copyright (C) 2009  Catherine Fitzpatrick and Benjamin Gwin
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program; if not, visit the Free Software Foundation, Inc.
+ * online at http://gnu.org.
+ */
+
+#ifndef _SESSION_CACHE_H_
+#define _SESSION_CACHE_H_
+
+#include <ctime>
+#include <map>
+#include <string>
+#include <vector>
+#include <utility>
+#include <boost/thread/mutex.hpp>
+#include <boost/unordered_map.hpp>
+#include <boost/noncopyable.hpp>
+#include "DatabaseRegistry.h"
+
+namespace shoddybattle { namespace database {
+
+/**
+ * What the registry has read from the database about each user: channel
+ * flags, bans, ip address, aliases and personal message. A value is read
+ * once and used until it is older than the timeout, so that logging in and
+ * joining channels again do not go back to the database. Writes made through
+ * the registry update the cache as well; the timeout picks up changes made
+ * to the database by anything else.
+ *
+ * Users are identified by name, without regard to case, as they are in the
+ * database.
+ */
+class SessionCache : boost::noncopyable {
+public:
+    typedef unsigned long TICKET;
+
+    /** The expiry date of a ban and the flags of the user who set it. **/
+    typedef std::pair<int, int> BAN;
+
+    SessionCache(): m_timeout(300), m_writes(0) { }
+
+    /**
+     * Set the number of seconds that a value is used for. Zero disables the
+     * cache.
+     */
+    void setTimeout(const int seconds);
+
+    /**
+     * Get a ticket to pass to one of the store methods below once a value
+     * has been read from the database. The value is not stored if the cache
+     * has been written since the ticket was issued, since it may have been
+     * read before the write.
+     */
+    TICKET getTicket();
+
+    bool getFlags(const int channel, const std::string &user, int &flags);
+    bool getFlags(const int channel, const int id, int &flags);
+    void storeFlags(const TICKET ticket, const int channel,
+            const std::string &user, const int id, const int flags);
+    void updateFlags(const int channel, const int id, const int flags);
+
+    bool getBan(const int channel, const std::string &user, BAN &ban);
+    void storeBan(const TICKET ticket, const int channel,
+            const std::string &user, const BAN &ban);
+    void updateBan(const int channel, const std::string &user,
+            const BAN &ban);
+
+    bool getGlobalBan(const std::string &user, const std::string &ip,
+            int &date);
+    void storeGlobalBan(const TICKET ticket, const std::string &user,
+            const std::string &ip, const int date);
+
+    bool getIp(const std::string &user, std::string &ip);
+    void storeIp(const TICKET ticket, const std::string &user,
+            const std::string &ip);
+    void updateIp(const std::string &user, const std::string &ip);
+
+    /**
+     * Aliases and bans are looked up by ip address, so they are only valid
+     * while the user's ip address is the one they were read for.
+     */
+    bool getAliases(const std::string &user, const std::string &ip,
+            std::vector<std::string> &aliases);
+    void storeAliases(const TICKET ticket, const std::string &user,
+            const std::string &ip, const std::vector<std::string> &aliases);
+
+    bool getBans(const std::string &user, const std::string &ip,
+            DatabaseRegistry::BAN_LIST &bans);
+    void storeBans(const TICKET ticket, const std::string &user,
+            const std::string &ip, const DatabaseRegistry::BAN_LIST &bans);
+
+    bool getMessage(const std::string &user, std::string &message);
+    void storeMessage(const TICKET ticket, const std::string &user,
+            const std::string &message);
+    void updateMessage(const std::string &user, const std::string &message);
+
+    /**
+     * Remove the users that have nothing left that can be used.
+     */
+    void expire();
+
+private:
+    template <class T>
+    struct ENTRY {
+        T value;
+        time_t loaded;
+        ENTRY(): loaded(0) { }
+        bool isFresh(const time_t now, const int timeout) const {
+            return (now - loaded < timeout);
+        }
+        void set(const T &v, const time_t now) {
+            value = v;
+            loaded = now;
+        }
+    };
+
+    typedef std::pair<std::string, std::vector<std::string> > ALIASES;
+    typedef std::pair<std::string, DatabaseRegistry::BAN_LIST> BANS;
+
+    struct SESSION {
+        int id;
+        time_t loaded;      // when the newest value was read
+        std::map<int, ENTRY<int> > flags;
+        std::map<int, ENTRY<BAN> > bans;
+        ENTRY<std::pair<std::string, int> > globalBan;
+        ENTRY<std::string> ip;
+        ENTRY<ALIASES> aliases;
+        ENTRY<BANS> banList;
+        ENTRY<std::string> message;
+        SESSION(): id(-1), loaded(0) { }
+    };
+
+    typedef boost::unordered_map<std::string, SESSION> SESSION_MAP;
+    typedef boost::unordered_map<int, std::string> ID_MAP;
+
+    SESSION *find(const std::string &user);
+    SESSION *find(const int id);
+    SESSION &get(const std::string &user, const time_t now);
+    void removeId(const int id, const std::string &key);
+    bool isCurrent(const TICKET ticket) const {
+        return (m_timeout > 0) && (ticket == m_writes);
+    }
+
+    boost::mutex m_mutex;
+    SESSION_MAP m_sessions;
+    ID_MAP m_ids;
+    int m_timeout;
+    TICKET m_writes;
+};
+
+}} // namespace shoddybattle::database
+
+#endif
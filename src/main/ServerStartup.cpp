@@ -0,0 +1,52 @@
+/*
+ * File:   ServerStartup.cpp
+ * Author: Catherine
+ *
+ * Created on October 19, 2026, 2:10 AM
+ *
+ * This file is a part of Shoddy Battle.
+ * Copyright (C) 2009  Catherine Fitzpatrick and Benjamin Gwin
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program; if not, visit the Free Software Foundation, Inc.
+ * online at http://gnu.org.
+ */
+
+#include "ServerStartup.h"
+
+namespace shoddybattle {
+
+void ServerStartup::addTo(StartupGraph &graph) const {
+    // The scripts and the database do not depend on each other, so they are
+    // loaded at the same time. The metagames are read first because Xerces
+    // must not be initialised by two threads at once.
+    const int metagames = graph.add("metagames", this->metagames);
+    const int scripts = graph.add("scripts", this->scripts);
+    const int database = graph.add("database", this->database);
+    const int welcome = graph.add("welcome message", this->welcome);
+    const int channels = graph.add("channels", this->channels);
+    const int bans = graph.add("metagame bans", this->bans);
+    const int matchmaking = graph.add("matchmaking", this->matchmaking);
+    const int clauses = graph.add("clauses", this->clauses);
+    graph.depend(scripts, metagames);
+    graph.depend(welcome, database);
+    graph.depend(channels, database);
+    graph.depend(bans, scripts);
+    graph.depend(matchmaking, bans);
+    graph.depend(matchmaking, database);
+    // The matchmaking thread reads the clauses resolved for each metagame.
+    graph.depend(matchmaking, clauses);
+    graph.depend(clauses, bans);
+}
+
+}
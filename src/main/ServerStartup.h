@@ -0,0 +1,52 @@
+/*
+ * File:   ServerStartup.h
+ * Author: Catherine
+ *
+ * Created on October 19, 2026, 2:10 AM
+ *
+ * This file is a part of Shoddy Battle.
+ * Copyright (C) 2009  Catherine Fitzpatrick and Benjamin Gwin
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program; if not, visit the Free Software Foundation, Inc.
+ * online at http://gnu.org.
+ */
+
+#ifndef _SERVER_STARTUP_H_
+#define _SERVER_STARTUP_H_
+
+#include "StartupGraph.h"
+
+namespace shoddybattle {
+
+/**
+ * The steps of starting the server. addTo() adds them to a StartupGraph
+ * along with the order they have to run in, which is kept here rather than
+ * in main() so that it can be tested without a server.
+ */
+struct ServerStartup {
+    StartupGraph::STAGE metagames;
+    StartupGraph::STAGE scripts;
+    StartupGraph::STAGE database;
+    StartupGraph::STAGE welcome;
+    StartupGraph::STAGE channels;
+    StartupGraph::STAGE bans;
+    StartupGraph::STAGE clauses;
+    StartupGraph::STAGE matchmaking;
+
+    void addTo(StartupGraph &graph) const;
+};
+
+}
+
+#endif
@@ -0,0 +1,137 @@
+/*
+ * File:   StartupGraph.cpp
+ * Author: Catherine
+ *
+ * Created on October 19, 2026, 11:20 PM
+ *
+ * This file is a part of Shoddy Battle.
+ * Copyright (C) 2009  Catherine Fitzpatrick and Benjamin Gwin
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program; if not, visit the Free Software Foundation, Inc.
+ * online at http://gnu.org.
+ */
+
+#include <stdexcept>
+#include <boost/bind.hpp>
+#include "StartupGraph.h"
+#include "Log.h"
+
+using namespace std;
+using namespace boost;
+using namespace boost::posix_time;
+
+namespace shoddybattle {
+
+int StartupGraph::add(const string &name, STAGE stage) {
+    NODE node;
+    node.name = name;
+    node.stage = stage;
+    node.waiting = 0;
+    m_nodes.push_back(node);
+    return m_nodes.size() - 1;
+}
+
+void StartupGraph::depend(const int stage, const int on) {
+    m_nodes[on].dependents.push_back(stage);
+    ++m_nodes[stage].waiting;
+}
+
+void StartupGraph::run(const int threads, STAGE threadInit) {
+    m_ready.clear();
+    const int count = m_nodes.size();
+    for (int i = 0; i < count; ++i) {
+        if (m_nodes[i].waiting == 0) {
+            m_ready.push_back(i);
+        }
+    }
+    m_running = 0;
+    m_error.clear();
+    m_start = microsec_clock::universal_time();
+    thread_group group;
+    for (int i = 0; i < threads; ++i) {
+        group.create_thread(boost::bind(&StartupGraph::work, this,
+                threadInit));
+    }
+    group.join_all();
+    m_end = microsec_clock::universal_time();
+
+    if (!m_error.empty()) {
+        throw runtime_error(m_error);
+    }
+    for (int i = 0; i < count; ++i) {
+        if (m_nodes[i].waiting != 0) {
+            throw runtime_error("startup: " + m_nodes[i].name
+                    + " waits on a step that waits on it");
+        }
+    }
+}
+
+void StartupGraph::work(STAGE threadInit) {
+    if (threadInit) {
+        threadInit();
+    }
+    unique_lock<mutex> lock(m_mutex);
+    while (true) {
+        while (m_ready.empty() && (m_running != 0) && m_error.empty()) {
+            m_condition.wait(lock);
+        }
+        if (m_ready.empty() || !m_error.empty())
+            break;
+
+        const int idx = m_ready.back();
+        m_ready.pop_back();
+        ++m_running;
+        NODE &node = m_nodes[idx];
+        node.start = microsec_clock::universal_time();
+        lock.unlock();
+
+        string error;
+        try {
+            node.stage();
+        } catch (std::exception &e) {
+            error = node.name + ": " + e.what();
+        } catch (...) {
+            error = node.name + ": unknown exception";
+        }
+
+        lock.lock();
+        node.end = microsec_clock::universal_time();
+        --m_running;
+        if (!error.empty() && m_error.empty()) {
+            m_error = error;
+        }
+        vector<int>::const_iterator i = node.dependents.begin();
+        for (; i != node.dependents.end(); ++i) {
+            if (--m_nodes[*i].waiting == 0) {
+                m_ready.push_back(*i);
+            }
+        }
+        m_condition.notify_all();
+    }
+}
+
+void StartupGraph::report() const {
+    Log::out() << "Startup took " << (m_end - m_start).total_milliseconds()
+            << " ms:" << endl;
+    vector<NODE>::const_iterator i = m_nodes.begin();
+    for (; i != m_nodes.end(); ++i) {
+        if (i->start.is_not_a_date_time() || i->end.is_not_a_date_time())
+            continue;
+        Log::out() << "    " << i->name << ": "
+                << (i->end - i->start).total_milliseconds() << " ms, from "
+                << (i->start - m_start).total_milliseconds() << " ms" << endl;
+    }
+}
+
+}
@@ -0,0 +1,93 @@
+/*
+ * File:   StartupGraph.h
+ * Author: Catherine
+ *
+ * Created on October 19, 2026, 11:20 PM
+ *
+ * This file is a part of Shoddy Battle.
+ * Copyright (C) 2009  Catherine Fitzpatrick and Benjamin Gwin
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program; if not, visit the Free Software Foundation, Inc.
+ * online at http://gnu.org.
+ */
+
+#ifndef _STARTUP_GRAPH_H_
+#define _STARTUP_GRAPH_H_
+
+#include <string>
+#include <vector>
+#include <boost/function.hpp>
+#include <boost/thread.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+
+namespace shoddybattle {
+
+/**
+ * The steps of starting the server, and which steps each one has to wait
+ * for. Steps that do not depend on each other run at the same time on a
+ * small pool of threads, and the time each step took is written to the log.
+ */
+class StartupGraph : boost::noncopyable {
+public:
+    typedef boost::function<void ()> STAGE;
+
+    /**
+     * Add a step; returns its index, for use with depend().
+     */
+    int add(const std::string &name, STAGE stage);
+
+    /**
+     * Make a step wait until another step has finished.
+     */
+    void depend(const int stage, const int on);
+
+    /**
+     * Run every step, using up to the given number of threads. Each thread
+     * calls threadInit before running any step. If a step throws, no more
+     * steps are started, and run throws a runtime_error naming the step once
+     * the running steps have finished.
+     */
+    void run(const int threads, STAGE threadInit = STAGE());
+
+    /**
+     * Write the time each step took to the log.
+     */
+    void report() const;
+
+private:
+    struct NODE {
+        std::string name;
+        STAGE stage;
+        std::vector<int> dependents;
+        int waiting;        // dependencies that have not finished
+        boost::posix_time::ptime start;
+        boost::posix_time::ptime end;
+    };
+
+    void work(STAGE threadInit);
+
+    std::vector<NODE> m_nodes;
+    std::vector<int> m_ready;
+    int m_running;          // steps that are running
+    std::string m_error;
+    boost::mutex m_mutex;
+    boost::condition_variable m_condition;
+    boost::posix_time::ptime m_start;
+    boost::posix_time::ptime m_end;
+};
+
+}
+
+#endif
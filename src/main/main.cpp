@@ -25,6 +25,7 @@
 #if 1
 
 #include <fstream>
+#include <iterator>
 #include <vector>
 #include <csignal>
 #include <boost/program_options.hpp>
@@ -33,12 +34,15 @@
 #include <boost/filesystem.hpp>
 #include <libdaemon/daemon.h>
 #include "../shoddybattle/PokemonSpecies.h"
+#include "../shoddybattle/ReplayBattle.h"
 #include "../scripting/ScriptMachine.h"
 #include "../database/DatabaseRegistry.h"
 #include "../database/Authenticator.h"
 #include "../network/NetworkBattle.h"
 #include "Log.h"
 #include "LogFile.h"
+#include "StartupGraph.h"
+#include "ServerStartup.h"
 
 using namespace std;
 using namespace shoddybattle;
@@ -53,12 +57,71 @@ const char *getPidFileName() {
     return pidFile.c_str();
 }
 
+void loadScripts(ScriptMachine *machine) {
+    machine->acquireContext()->runFile("resources/main.js");
+    machine->finalise();
+}
+
+void connectDatabase(database::DatabaseRegistry *registry,
+        const string &name, const string &host, const string &user,
+        const string &password, const int port,
+        boost::shared_ptr<database::Authenticator> auth) {
+    registry->connect(name, host, user, password, port);
+    if (auth) {
+        registry->setAuthenticator(auth);
+    }
+    registry->createDefaultDatabase();
+}
+
+/**
+ * Replay a set of battle records and report whether each one still plays out
+ * exactly as it did originally. This does not start the server.
+ */
+int replayBattles(const vector<string> &files) {
+    ScriptMachine machine;
+    machine.acquireContext()->runFile("resources/main.js");
+    machine.finalise();
+    vector<GenerationPtr> generations;
+    Generation::readGenerations("resources/metagames.xml", generations);
+    for_each(generations.begin(), generations.end(),
+            boost::bind(&Generation::initialiseMetagames, _1,
+                machine.getSpeciesDatabase()));
+
+    int failures = 0;
+    vector<string>::const_iterator i = files.begin();
+    for (; i != files.end(); ++i) {
+        ifstream file(i->c_str(), ios::binary);
+        vector<unsigned char> data((istreambuf_iterator<char>(file)),
+                istreambuf_iterator<char>());
+        BattleRecord record;
+        if (!record.read(data)
+                || (record.generation >= (int)generations.size())) {
+            Log::out() << *i << ": not a battle record" << endl;
+            ++failures;
+            continue;
+        }
+        ReplayBattle battle(record);
+        const bool same = battle.run(&machine,
+                generations[record.generation].get());
+        Log::out() << *i << ": " << (same ? "same" : "DIFFERENT")
+                << " (" << battle.getStepCount() << "/"
+                << record.steps.size() << " steps, "
+                << battle.getDigest().getCount() << " events)" << endl;
+        if (!same) {
+            ++failures;
+        }
+    }
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
 int initialise(int argc, char **argv, bool &daemon) {
     string configFile;
     int port, databasePort, workerThreads, serverUid, userLimit;
+    int ratingPeriod, cacheTimeout;
     string serverName, welcomeFile, welcomeMessage;
     string databaseName, databaseHost, databaseUser, databasePassword;
     string authParameter, loginParameter, registerParameter;
+    vector<string> replayFiles;
 
     po::options_description generic("Options");
     generic.add_options()
@@ -123,6 +186,17 @@ int initialise(int argc, char **argv, bool &daemon) {
                 po::value<string>(&databasePassword)->default_value(
                     ""),
                 "MySQL password")
+            ("mysql.cache",
+                po::value<int>(&cacheTimeout)->default_value(
+                    300),
+                "seconds to keep user data read from MySQL (0 to disable)")
+            ("ladder.period",
+                po::value<int>(&ratingPeriod)->default_value(
+                    24),
+                "length of a ladder rating period in hours (0 to disable)")
+            ("battle.replay",
+                po::value<vector<string> >(&replayFiles)->multitoken(),
+                "replay battle records and check that they are unchanged")
     ;
 
     po::options_description hidden("Hidden options");
@@ -173,6 +247,10 @@ int initialise(int argc, char **argv, bool &daemon) {
         po::notify(vm);
     }
 
+    if (vm.count("battle.replay")) {
+        return replayBattles(replayFiles);
+    }
+
     if (vm.count("server.uid")) {
         if (seteuid(serverUid)) {
             // Failed to set the UID.
@@ -284,37 +362,44 @@ int initialise(int argc, char **argv, bool &daemon) {
 
     network::Server server(port, userLimit);
     server.installSignalHandlers();
-    server.readMetagames("resources/metagames.xml");
 
     ScriptMachine *machine = server.getMachine();
-    machine->acquireContext()->runFile("resources/main.js");
-    machine->finalise();
-
     database::DatabaseRegistry *registry = server.getRegistry();
-    registry->connect(databaseName, databaseHost,
-            databaseUser, databasePassword, databasePort);
-    registry->startThread();
+    registry->setSessionTimeout(cacheTimeout);
 
+    boost::shared_ptr<database::Authenticator> auth;
     if (vm.count("auth.salt")) {
-        registry->setAuthenticator(boost::shared_ptr<database::Authenticator>(
-                new database::SaltAuthenticator()));
+        auth.reset(new database::SaltAuthenticator());
     }
 
     if (vm.count("auth.vbulletin")) {
-        registry->setAuthenticator(boost::shared_ptr<database::Authenticator>(
-                new database::VBulletinAuthenticator(loginParameter,
-                        registerParameter, authParameter)));
+        auth.reset(new database::VBulletinAuthenticator(loginParameter,
+                registerParameter, authParameter));
     }
 
-    registry->createDefaultDatabase();
-    
-    server.initialiseWelcomeMessage(serverName, welcomeMessage);
-    server.initialiseChannels();
-    server.initialiseMetagames();
-    server.initialiseMatchmaking();
-    server.initialiseClauses();
+    ServerStartup stages;
+    stages.metagames = boost::bind(&network::Server::readMetagames, &server,
+            "resources/metagames.xml");
+    stages.scripts = boost::bind(loadScripts, machine);
+    stages.database = boost::bind(connectDatabase, registry, databaseName,
+            databaseHost, databaseUser, databasePassword, databasePort, auth);
+    stages.welcome = boost::bind(&network::Server::initialiseWelcomeMessage,
+            &server, serverName, welcomeMessage);
+    stages.channels = boost::bind(&network::Server::initialiseChannels,
+            &server);
+    stages.bans = boost::bind(&network::Server::initialiseMetagames, &server);
+    stages.clauses = boost::bind(&network::Server::initialiseClauses, &server);
+    stages.matchmaking = boost::bind(&network::Server::initialiseMatchmaking,
+            &server);
+    StartupGraph startup;
+    stages.addTo(startup);
+    startup.run(4, &database::DatabaseRegistry::startThread);
+    startup.report();
+    registry->startThread();
 
+    server.initialiseRatingPeriods(ratingPeriod);
     network::NetworkBattle::startTimerThread();
+    network::NetworkBattle::startLogThread();
 
     vector<boost::shared_ptr<boost::thread> > threads;
     for (int i = 0; i < workerThreads; ++i) {
@@ -0,0 +1,85 @@
+/*
+ * File:   DamageFormula.h
+ * Author: Catherine
+ *
+ * Created on October 19, 2026, 1:50 AM
+ *
+ * This file is a part of Shoddy Battle.
+ * Copyright (C) 2009  Catherine Fitzpatrick and Benjamin Gwin
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program; if not, visit the Free Software Foundation, Inc.
+ * online at http://gnu.org.
+ */
+
+#ifndef _DAMAGE_FORMULA_H_
+#define _DAMAGE_FORMULA_H_
+
+#include <vector>
+
+#include "Fraction.h"
+#include "Modifiers.h"
+
+namespace shoddybattle {
+
+/**
+ * Apply the random roll to count pre-roll damage values, one for each roll
+ * starting at lower. Each stage runs over the whole array at once so that
+ * the compiler is free to vectorise it.
+ */
+inline void applyRoll(int *damage, const int count, const int lower) {
+    for (int i = 0; i < count; ++i) {
+        damage[i] *= (lower + i) * 100;
+    }
+    for (int i = 0; i < count; ++i) {
+        damage[i] /= 255;
+    }
+    for (int i = 0; i < count; ++i) {
+        damage[i] /= 100;
+    }
+}
+
+/**
+ * Multiply count damage values by a fraction.
+ */
+inline void applyFraction(int *damage, const int count, const Fraction f) {
+    if (f.isOne())
+        return;
+    for (int i = 0; i < count; ++i) {
+        damage[i] = f.apply(damage[i]);
+    }
+}
+
+/**
+ * Apply everything after the random roll: STAB, type effectiveness and
+ * "Mod3", truncating after each multiplication.
+ */
+inline void applyPostRoll(int *damage, const int count, const double stab,
+        const std::vector<double> &factors, const PriorityMap &mod3) {
+    applyFraction(damage, count, toFraction(stab));
+    std::vector<double>::const_iterator j = factors.begin();
+    for (; j != factors.end(); ++j) {
+        applyFraction(damage, count, toFraction(*j));
+    }
+    PriorityMap::const_iterator k = mod3.begin();
+    for (; k != mod3.end(); ++k) {
+        applyFraction(damage, count, k->second);
+    }
+    for (int i = 0; i < count; ++i) {
+        if (damage[i] < 1) damage[i] = 1;
+    }
+}
+
+}
+
+#endif
@@ -0,0 +1,97 @@
+/*
+ * File:   Fraction.h
+ * Author: Catherine
+ *
+ * Created on October 19, 2026, 8:45 PM
+ *
+ * This file is a part of Shoddy Battle.
+ * Copyright (C) 2009  Catherine Fitzpatrick and Benjamin Gwin
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program; if not, visit the Free Software Foundation, Inc.
+ * online at http://gnu.org.
+ */
+
+#ifndef _FRACTION_H_
+#define _FRACTION_H_
+
+#include <cmath>
+
+namespace shoddybattle {
+
+/**
+ * A multiplier from the damage or stat formulae as an exact fraction. The
+ * games apply each multiplier by multiplying and then dividing, truncating
+ * the result; applying a Fraction does the same in integer arithmetic, so the
+ * result does not depend on floating point rounding.
+ *
+ * A multiplier that is not a simple fraction (see toFraction) has a zero
+ * denominator and is kept as the double it was supplied as. Applying it
+ * multiplies in floating point, exactly as the engine always has.
+ */
+struct Fraction {
+    int num;
+    int den;
+    double value;   // only used if den is zero
+
+    /**
+     * Multiply a value by this fraction, truncating towards zero.
+     */
+    int apply(const int x) const {
+        if (den == 0) {
+            return int(x * value);
+        }
+        return int((long long)x * num / den);
+    }
+
+    /**
+     * Get the double that this multiplier was supplied as.
+     */
+    double toDouble() const {
+        return den ? (double(num) / den) : value;
+    }
+
+    bool isOne() const {
+        return den ? (num == den) : (value == 1.0);
+    }
+};
+
+inline Fraction makeFraction(const int num, const int den) {
+    const Fraction ret = { num, den, 0.0 };
+    return ret;
+}
+
+/**
+ * Convert a multiplier supplied by a script to a fraction. Every multiplier
+ * in use is a whole number of halves, thirds, quarters, fifths, sevenths or
+ * hundredths, and the fraction is only used if it converts back to exactly
+ * the same double. Anything else is kept as a double, so that it is applied
+ * exactly as it was before multipliers became fractions.
+ */
+inline Fraction toFraction(const double x) {
+    static const int DENOMINATORS[] = { 1, 2, 3, 4, 5, 7, 10, 25, 50, 100 };
+    static const int COUNT = sizeof(DENOMINATORS) / sizeof(int);
+    for (int i = 0; i < COUNT; ++i) {
+        const int den = DENOMINATORS[i];
+        const Fraction f = makeFraction(int(floor(x * den + 0.5)), den);
+        if (f.toDouble() == x) {
+            return f;
+        }
+    }
+    const Fraction ret = { 0, 0, x };
+    return ret;
+}
+
+}
+
+#endif
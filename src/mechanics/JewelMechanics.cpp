@@ -27,6 +27,8 @@
 #include "JewelMechanics.h"
 #include "PokemonNature.h"
 #include "PokemonType.h"
+#include "Fraction.h"
+#include "DamageFormula.h"
 #include "../shoddybattle/Pokemon.h"
 #include "../shoddybattle/BattleField.h"
 #include "../moves/PokemonMove.h"
@@ -49,11 +51,23 @@ typedef mt11213b GENERATOR;
 
 struct JewelMechanicsImpl {
     GENERATOR rand;
+    unsigned int seed;
 };
 
 JewelMechanics::JewelMechanics() {
     m_impl = new JewelMechanicsImpl();
-    m_impl->rand = GENERATOR(time(NULL));
+    m_impl->seed = time(NULL);
+    m_impl->rand = GENERATOR(m_impl->seed);
+}
+
+JewelMechanics::JewelMechanics(const unsigned int seed) {
+    m_impl = new JewelMechanicsImpl();
+    m_impl->seed = seed;
+    m_impl->rand = GENERATOR(seed);
+}
+
+unsigned int JewelMechanics::getSeed() const {
+    return m_impl->seed;
 }
 
 JewelMechanics::~JewelMechanics() {
@@ -78,7 +92,7 @@ unsigned int JewelMechanics::calculateStat(
             return common + 10 + p.getLevel();
         }
     }
-    return (int)((common + 5) * p.getNature()->getEffect(i));
+    return p.getNature()->getMultiplier(i).apply(common + 5);
 }
 
 bool JewelMechanics::getCoinFlip(double p) const {
@@ -88,15 +102,6 @@ bool JewelMechanics::getCoinFlip(double p) const {
     return coin();
 }
 
-template <class T>
-inline void multiplyBy(T &value, PRIORITY_MAP &elements) {
-    PRIORITY_MAP::const_iterator i = elements.begin();
-    for (; i != elements.end(); ++i) {
-        double val = i->second;
-        value *= val;
-    }
-}
-
 bool JewelMechanics::attemptHit(BattleField &field, MoveObject &move,
         Pokemon &user, Pokemon &target) const {
     ScriptContext *cx = field.getContext();
@@ -133,15 +138,18 @@ bool JewelMechanics::attemptHit(BattleField &field, MoveObject &move,
     return ((getRandomInt(0, 99) + 1) <= accuracy);
 }
 
-bool JewelMechanics::isCriticalHit(BattleField &field, MoveObject &move,
+/**
+ * Get the chance that a move will be a critical hit, or 0.0 if it cannot be.
+ */
+double JewelMechanics::getCriticalChance(BattleField &field, MoveObject &move,
         Pokemon &user, Pokemon &target) const {
     ScriptContext *cx = field.getContext();
     ScriptValue v = target.sendMessage("informAttemptCritical", 0, NULL);
     if (!v.failed() && v.getBool()) {
-        return false;
+        return 0.0;
     }
     if (move.getFlag(cx, F_NO_CRITICAL)) {
-        return false;
+        return 0.0;
     }
     int term = 0;
     if (move.getFlag(cx, F_HIGH_CRITICAL)) {
@@ -151,21 +159,16 @@ bool JewelMechanics::isCriticalHit(BattleField &field, MoveObject &move,
     if (term > 4) {
         term = 4;
     }
-    return getCoinFlip(CRITICAL_TABLE[term]);
+    return CRITICAL_TABLE[term];
 }
 
-inline int multiplyOut(PRIORITY_MAP &elements) {
-    PRIORITY_MAP::const_iterator i = elements.begin();
-    double value = i->second;
-    ++i;
-    for (; i != elements.end(); ++i) {
-        value = floor(value * i->second);
+bool JewelMechanics::isCriticalHit(BattleField &field, MoveObject &move,
+        Pokemon &user, Pokemon &target) const {
+    const double chance = getCriticalChance(field, move, user, target);
+    if (chance == 0.0) {
+        return false;
     }
-    return int(value);
-}
-
-inline void multiplyBy(int &damage, const int position, MODIFIERS &mods) {
-    multiplyBy(damage, mods[position]);
+    return getCoinFlip(chance);
 }
 
 int JewelMechanics::getRandomInt(const int lower, const int upper) const {
@@ -177,18 +180,25 @@ int JewelMechanics::getRandomInt(const int lower, const int upper) const {
 double JewelMechanics::getEffectiveness(BattleField &field,
         const PokemonType *type,
         Pokemon *user, Pokemon *target, vector<double> *factors) const {
-    set<const PokemonType *> immunities, vulnerabilities;
-    field.getImmunities(user, target, immunities, vulnerabilities);
-    if (immunities.find(type) != immunities.end()) {
+    TYPE_SET immunities = 0, vulnerabilities = 0;
+    const bool transforms =
+            field.getImmunities(user, target, immunities, vulnerabilities);
+    if (immunities & type->getBit()) {
         return 0.0;
     }
-    const bool immune = (vulnerabilities.find(type) == vulnerabilities.end());
-    double effectiveness = 1.0;
+    const bool immune = !(vulnerabilities & type->getBit());
     const TYPE_ARRAY &types = target->getTypes();
-    
+
+    if (!transforms && immune && !factors && (types.size() == 2)) {
+        // The common case: nothing in play alters type effectiveness.
+        return type->getMultiplier(*types[0], *types[1]);
+    }
+
+    double effectiveness = 1.0;
     for (TYPE_ARRAY::const_iterator i = types.begin(); i != types.end(); ++i) {
         double factor;
-        if (!field.getTransformedEffectiveness(type, *i, target, factor)) {
+        if (!transforms || !field.getTransformedEffectiveness(
+                type, *i, target, factor)) {
             factor = type->getMultiplier(**i);
         }
         
@@ -203,12 +213,14 @@ double JewelMechanics::getEffectiveness(BattleField &field,
 }
 
 /**
- * Calculate damage.
+ * Calculate the part of the damage formula which comes before the random
+ * roll, i.e. everything up to and including "Mod2". The modifiers in play are
+ * left in mods so that the caller can apply "Mod3" afterwards.
  */
-int JewelMechanics::calculateDamage(BattleField &field, MoveObject &move,
+int JewelMechanics::getPreRollDamage(BattleField &field, MoveObject &move,
         Pokemon &user, Pokemon &target, const int targets,
-        const bool weight) const {
-    
+        const bool critical, MODIFIERS &mods) const {
+
     ScriptContext *cx = field.getContext();
 
     MOVE_CLASS cls = move.getMoveClass(cx);
@@ -217,12 +229,10 @@ int JewelMechanics::calculateDamage(BattleField &field, MoveObject &move,
     STAT stat0 = (cls == MC_PHYSICAL) ? S_ATTACK : S_SPATTACK;
     STAT stat1 = (cls == MC_PHYSICAL) ? S_DEFENCE : S_SPDEFENCE;
 
-    const bool critical = isCriticalHit(field, move, user, target);
-    MODIFIERS mods;
     field.getModifiers(user, target, move, critical, targets, mods);
 
     if (targets > 1) {
-        mods[1][2] = 0.75;
+        mods[1][2] = makeFraction(3, 4);
     }
 
     PRIORITY_MAP statMod;
@@ -252,9 +262,9 @@ int JewelMechanics::calculateDamage(BattleField &field, MoveObject &move,
     statMod[0] = getStatMultiplier(stat1, level);
     multiplyBy(defence, statMod);
 
-    mods[0][0] = move.getPower(cx); // base power
+    mods[0][0] = makeFraction(move.getPower(cx), 1); // base power
     const int power = multiplyOut(mods[0]);
-    
+
     int damage = user.getLevel() * 2 / 5;
     damage += 2;
     damage *= power;
@@ -272,22 +282,45 @@ int JewelMechanics::calculateDamage(BattleField &field, MoveObject &move,
         damage *= factor;
     }
     multiplyBy(damage, 2, mods); // "Mod2"
+    return damage;
+}
+
+/**
+ * Get the same type attack bonus for a move of a given type.
+ */
+double JewelMechanics::getStab(BattleField &field, const PokemonType *type,
+        Pokemon &user) const {
+    if (!user.isType(type)) {
+        return 1.0;
+    }
+    ScriptValue v = user.sendMessage("informStab", 0, NULL);
+    if (!v.failed()) {
+        return v.getDouble(field.getContext());
+    }
+    return 1.5;
+}
+
+/**
+ * Calculate damage.
+ */
+int JewelMechanics::calculateDamage(BattleField &field, MoveObject &move,
+        Pokemon &user, Pokemon &target, const int targets,
+        const bool weight) const {
+    
+    ScriptContext *cx = field.getContext();
+
+    const bool critical = isCriticalHit(field, move, user, target);
+    MODIFIERS mods;
+    int damage = getPreRollDamage(field, move, user, target, targets,
+            critical, mods);
 
     if (weight) {
-        damage *= getRandomInt(217, 255) * 100;
-        damage /= 255;
-        damage /= 100;
+        applyRoll(&damage, 1, getRandomInt(DamageDistribution::ROLL_MIN,
+                DamageDistribution::ROLL_MAX));
     }
 
     const PokemonType *moveType = move.getType(cx);
-    if (user.isType(moveType)) {
-        ScriptValue v = user.sendMessage("informStab", 0, NULL);
-        double stab = 1.5;
-        if (!v.failed()) {
-            stab = v.getDouble(cx);
-        }
-        damage *= stab;
-    }
+    const double stab = getStab(field, moveType, user);
 
     vector<double> factors;
     const double effectiveness =
@@ -300,11 +333,6 @@ int JewelMechanics::calculateDamage(BattleField &field, MoveObject &move,
         return 0;
     }
 
-    vector<double>::const_iterator i = factors.begin();
-    for (; i != factors.end(); ++i) {
-        damage *= *i;
-    }
-
     if (critical) {
         field.print(TextMessage(4, 9));
         target.sendMessage("informCriticalHit", 0, NULL);
@@ -316,12 +344,76 @@ int JewelMechanics::calculateDamage(BattleField &field, MoveObject &move,
         field.print(TextMessage(4, 7));
     }
 
-    multiplyBy(damage, 3, mods); // "Mod3"
-
-    if (damage < 1) damage = 1;
+    applyPostRoll(&damage, 1, stab, factors, mods[3]);
     return damage;
 }
 
+namespace {
+
+/**
+ * Put a field into query mode for as long as this object exists.
+ */
+class FieldQuery {
+public:
+    FieldQuery(BattleField &field):
+            m_field(field),
+            m_query(field.isQuery()) {
+        m_field.setQuery(true);
+    }
+    ~FieldQuery() {
+        m_field.setQuery(m_query);
+    }
+private:
+    BattleField &m_field;
+    const bool m_query;
+};
+
+} // anonymous namespace
+
+/**
+ * Compute every possible outcome of a hit without rolling any random numbers,
+ * printing anything or informing any effects that a hit took place. Both the
+ * critical and non-critical branches are always filled in, even if the move
+ * cannot critical hit; criticalChance says how likely each one is.
+ *
+ * The scripts in play still run, once for each branch, so the field is in
+ * query mode throughout: nothing is narrated, and a berry that would weaken
+ * the hit is not consumed.
+ */
+void JewelMechanics::getDamageDistribution(BattleField &field,
+        MoveObject &move, Pokemon &user, Pokemon &target, const int targets,
+        DamageDistribution &dist) const {
+    FieldQuery query(field);
+    ScriptContext *cx = field.getContext();
+    const PokemonType *moveType = move.getType(cx);
+
+    dist.criticalChance = getCriticalChance(field, move, user, target);
+
+    vector<double> factors;
+    dist.effectiveness =
+            getEffectiveness(field, moveType, &user, &target, &factors);
+    if (dist.effectiveness == 0.0) {
+        fill(dist.normal, dist.normal + DamageDistribution::ROLL_COUNT, 0);
+        fill(dist.critical, dist.critical + DamageDistribution::ROLL_COUNT, 0);
+        return;
+    }
+
+    const double stab = getStab(field, moveType, user);
+
+    int *branches[] = { dist.normal, dist.critical };
+    for (int i = 0; i < 2; ++i) {
+        MODIFIERS mods;
+        int *damage = branches[i];
+        const int base = getPreRollDamage(field, move, user, target, targets,
+                (i == 1), mods);
+        fill(damage, damage + DamageDistribution::ROLL_COUNT, base);
+        applyRoll(damage, DamageDistribution::ROLL_COUNT,
+                DamageDistribution::ROLL_MIN);
+        applyPostRoll(damage, DamageDistribution::ROLL_COUNT, stab,
+                factors, mods[3]);
+    }
+}
+
 /*inline unsigned short prev(unsigned long long &n) {
     n = (n * 4005161829L) + 171270561L;
     return static_cast<short>(n >> 16);
@@ -405,4 +497,3 @@ bool JewelMechanics::validateHiddenStats(const Pokemon &p) const {
 }
 
 }
-
@@ -34,17 +34,45 @@ class BattleField;
 class MoveObject;
 
 class JewelMechanicsImpl;
+class ModifierSet;
 
 //Maximum values for the various hidden stats
 const int MAX_IV = 31;
 const int MAX_EV = 255;
 const int MAX_EV_TOTAL = 510;
 
+/**
+ * Every possible outcome of a single hit, as computed by
+ * JewelMechanics::getDamageDistribution. A hit made without the random
+ * weight does the same damage as the ROLL_MAX entry.
+ */
+struct DamageDistribution {
+    enum {
+        ROLL_MIN = 217,
+        ROLL_MAX = 255,
+        ROLL_COUNT = ROLL_MAX - ROLL_MIN + 1
+    };
+    // Product of the type effectiveness factors; 0.0 if the target is immune.
+    double effectiveness;
+    // Chance of a critical hit; 0.0 if the move cannot critical hit.
+    double criticalChance;
+    // Damage for each roll from ROLL_MIN to ROLL_MAX.
+    int normal[ROLL_COUNT];
+    int critical[ROLL_COUNT];
+};
+
 class JewelMechanics : public BattleMechanics {
 public:
     
     JewelMechanics();
     ~JewelMechanics();
+
+    /**
+     * Use a particular seed, so that a battle can be replayed exactly.
+     */
+    explicit JewelMechanics(const unsigned int seed);
+    unsigned int getSeed() const;
+
     bool getCoinFlip(double) const;
     unsigned int calculateStat(const Pokemon &p, const STAT i) const;
     int calculateDamage(BattleField &field, MoveObject &move,
@@ -58,7 +86,17 @@ public:
     double getEffectiveness(BattleField &field, const PokemonType *,
             Pokemon *, Pokemon *, std::vector<double> *) const;
     bool validateHiddenStats(const Pokemon &p) const;
+    double getCriticalChance(BattleField &field, MoveObject &move,
+            Pokemon &user, Pokemon &target) const;
+    void getDamageDistribution(BattleField &field, MoveObject &move,
+            Pokemon &user, Pokemon &target, const int targets,
+            DamageDistribution &dist) const;
 private:
+    int getPreRollDamage(BattleField &field, MoveObject &move,
+            Pokemon &user, Pokemon &target, const int targets,
+            const bool critical, ModifierSet &mods) const;
+    double getStab(BattleField &field, const PokemonType *type,
+            Pokemon &user) const;
     JewelMechanicsImpl *m_impl;
 };
 
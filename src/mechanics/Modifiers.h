@@ -0,0 +1,175 @@
+/*
+ * File:   Modifiers.h
+ * Author: Catherine
+ *
+ * Created on October 19, 2026, 10:12 AM
+ *
+ * This file is a part of Shoddy Battle.
+ * Copyright (C) 2009  Catherine Fitzpatrick and Benjamin Gwin
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program; if not, visit the Free Software Foundation, Inc.
+ * online at http://gnu.org.
+ */
+
+#ifndef _MODIFIERS_H_
+#define _MODIFIERS_H_
+
+#include <vector>
+
+#include "Fraction.h"
+
+namespace shoddybattle {
+
+/**
+ * A replacement for std::map<int, double> that keeps its first CAPACITY
+ * entries on the stack. Entries are kept sorted by priority and assigning to
+ * an existing priority overwrites it, so iterating over a PriorityMap visits
+ * exactly the same values in exactly the same order as the old map did.
+ * Values are stored as fractions, converted once when they are set.
+ *
+ * No script in use comes near CAPACITY. If one does go past it, every entry
+ * moves to the heap and the map keeps working.
+ */
+class PriorityMap {
+public:
+    // Plain old data, so that the unused entries are never initialised.
+    struct ENTRY {
+        int first;
+        Fraction second;
+    };
+    typedef const ENTRY *const_iterator;
+    enum { CAPACITY = 16 };
+
+    PriorityMap(): m_size(0) { }
+
+    /**
+     * Get the value at a priority, inserting zero (like std::map would) if
+     * there is no such priority yet.
+     */
+    Fraction &operator[](const int priority) {
+        ENTRY *data = getData();
+        int i = 0;
+        while ((i < m_size) && (data[i].first < priority)) {
+            ++i;
+        }
+        if ((i < m_size) && (data[i].first == priority)) {
+            return data[i].second;
+        }
+        const ENTRY entry = { priority, makeFraction(0, 1) };
+        if (m_overflow.empty() && (m_size < CAPACITY)) {
+            for (int j = m_size; j > i; --j) {
+                m_data[j] = m_data[j - 1];
+            }
+            ++m_size;
+            m_data[i] = entry;
+            return m_data[i].second;
+        }
+        if (m_overflow.empty()) {
+            m_overflow.assign(m_data, m_data + m_size);
+        }
+        m_overflow.insert(m_overflow.begin() + i, entry);
+        ++m_size;
+        return m_overflow[i].second;
+    }
+
+    const_iterator begin() const { return getData(); }
+    const_iterator end() const { return getData() + m_size; }
+    int size() const { return m_size; }
+    bool empty() const { return (m_size == 0); }
+    void clear() {
+        m_size = 0;
+        m_overflow.clear();
+    }
+
+private:
+    ENTRY *getData() {
+        return m_overflow.empty() ? m_data : &m_overflow[0];
+    }
+    const ENTRY *getData() const {
+        return m_overflow.empty() ? m_data : &m_overflow[0];
+    }
+
+    ENTRY m_data[CAPACITY];
+    int m_size;
+    std::vector<ENTRY> m_overflow;  // every entry, once past CAPACITY
+};
+
+/**
+ * The modifiers for each position in the damage formula: base power, Mod1,
+ * Mod2 and Mod3.
+ */
+class ModifierSet {
+public:
+    enum { POSITION_COUNT = 4 };
+
+    PriorityMap &operator[](const int position) {
+        return m_positions[position];
+    }
+
+    /**
+     * Set a modifier supplied by a script. Positions outside of the damage
+     * formula were never read back out of the old map, so they are dropped.
+     */
+    void set(const int position, const int priority, const Fraction value) {
+        if ((position < 0) || (position >= POSITION_COUNT))
+            return;
+        m_positions[position][priority] = value;
+    }
+
+private:
+    PriorityMap m_positions[POSITION_COUNT];
+};
+
+/**
+ * Apply each multiplier in a map to a value, in priority order, truncating
+ * after each one.
+ */
+inline void multiplyBy(int &value, const PriorityMap &elements) {
+    PriorityMap::const_iterator i = elements.begin();
+    for (; i != elements.end(); ++i) {
+        value = i->second.apply(value);
+    }
+}
+
+inline void multiplyBy(int &value, const int position, ModifierSet &mods) {
+    multiplyBy(value, mods[position]);
+}
+
+/**
+ * Multiply the values in a map together, truncating after each step.
+ */
+inline int multiplyOut(const PriorityMap &elements) {
+    PriorityMap::const_iterator i = elements.begin();
+    const Fraction &first = i->second;
+    ++i;
+    if (i == elements.end()) {
+        return first.apply(1);
+    }
+    const Fraction &second = i->second;
+    int value;
+    if ((first.den == 0) || (second.den == 0)) {
+        value = int(floor(first.toDouble() * second.toDouble()));
+    } else {
+        value = int((long long)first.num * second.num
+                / ((long long)first.den * second.den));
+    }
+    for (++i; i != elements.end(); ++i) {
+        value = i->second.apply(value);
+    }
+    return value;
+}
+
+}
+
+#endif
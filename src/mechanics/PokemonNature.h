@@ -27,6 +27,7 @@
 
 #include <string>
 #include "stat.h"
+#include "Fraction.h"
 
 namespace shoddybattle {
 
@@ -70,6 +71,14 @@ public:
         return (i == m_benefit) ? 1.1 : ((i == m_harm) ? 0.9 : 1.0);
     }
 
+    /** Return the effect of this nature on a stat as an exact fraction. **/
+    Fraction getMultiplier(STAT i) const {
+        static const Fraction BENEFIT = makeFraction(11, 10);
+        static const Fraction HARM = makeFraction(9, 10);
+        static const Fraction NEUTRAL = makeFraction(1, 1);
+        return (i == m_benefit) ? BENEFIT : ((i == m_harm) ? HARM : NEUTRAL);
+    }
+
     /** Return which stat this nature benefits. **/
     STAT getBenefits() const {
         return m_benefit;
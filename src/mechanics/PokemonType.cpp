@@ -97,5 +97,33 @@ const double PokemonType::m_multiplier[18][18] = {
         { 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1 }
     };
 
+/**
+ * Combined effectiveness chart for dual-typed targets. C++98 has no way to
+ * build this at compile time, so it is filled in during static
+ * initialisation instead; m_multiplier is constant-initialised, so it is
+ * always ready by then.
+ */
+double PokemonType::m_dualMultiplier[18][18][18];
+
+struct DualMultiplierInitialiser {
+    DualMultiplierInitialiser() {
+        for (int i = 0; i < TYPE_COUNT; ++i) {
+            for (int j = 0; j < TYPE_COUNT; ++j) {
+                for (int k = 0; k < TYPE_COUNT; ++k) {
+                    // Same order of multiplication as the loop in
+                    // JewelMechanics::getEffectiveness.
+                    double value = 1.0;
+                    value *= PokemonType::m_multiplier[i][j];
+                    value *= PokemonType::m_multiplier[i][k];
+                    PokemonType::m_dualMultiplier[i][j][k] = value;
+                }
+            }
+        }
+    }
+};
+
+namespace {
+DualMultiplierInitialiser dualMultiplierInitialiser;
 }
 
+}
@@ -22,6 +22,9 @@
  * online at http://gnu.org.
  */
 
+#ifndef _POKEMON_TYPE_H_
+#define _POKEMON_TYPE_H_
+
 #include <string>
 
 namespace shoddybattle {
@@ -30,6 +33,11 @@ class Text;
 
 const int TYPE_COUNT = 18;
 
+/**
+ * A set of types, with one bit for each type value.
+ */
+typedef unsigned int TYPE_SET;
+
 class PokemonType {
 public:
     /** Constants for all of the types. */
@@ -56,6 +64,23 @@ public:
         return m_multiplier[m_type][type.m_type];
     }
 
+    /**
+     * Get the combined multiplier against a pokemon with two types. This is
+     * exactly getMultiplier(type1) * getMultiplier(type2), read out of a
+     * table which is built once at startup.
+     */
+    double getMultiplier(const PokemonType &type1,
+            const PokemonType &type2) const {
+        return m_dualMultiplier[m_type][type1.m_type][type2.m_type];
+    }
+
+    /**
+     * Get the bit which represents this type in a TYPE_SET.
+     */
+    TYPE_SET getBit() const {
+        return 1u << m_type;
+    }
+
     static const PokemonType *getByValue(const int idx) {
         return m_list[idx];
     }
@@ -78,6 +103,9 @@ private:
     std::string m_name; // "Canonical name" - not to be displayed to the user
     static const PokemonType *m_list[TYPE_COUNT];
     static const double m_multiplier[TYPE_COUNT][TYPE_COUNT];
+    static double m_dualMultiplier[TYPE_COUNT][TYPE_COUNT][TYPE_COUNT];
+
+    friend struct DualMultiplierInitialiser;
 
     PokemonType(int type, const std::string &name):
             m_type(type), m_name(name) { }
@@ -85,3 +113,4 @@ private:
 
 }
 
+#endif
@@ -28,15 +28,22 @@ namespace shoddybattle {
 
 namespace {
 
-const double STAT_MULTIPLIER[] = { 4.0, 3.5, 3.0, 2.5, 2.0, 1.5, 1.0,
-        2.0/3.0, 0.5, 0.4, 1.0/3.0, 2.0/7.0, 0.25 };
-
-const double ACCURACY_MULTIPLIER[] = { 3.0, 2.66, 2.5, 2.0, 1.66, 1.33, 1.0,
-        0.75, 0.6, 0.5, 0.43, 0.36, 0.33 };
+const Fraction STAT_MULTIPLIER[] = { makeFraction(4, 1), makeFraction(7, 2),
+        makeFraction(3, 1), makeFraction(5, 2), makeFraction(2, 1),
+        makeFraction(3, 2), makeFraction(1, 1), makeFraction(2, 3),
+        makeFraction(1, 2), makeFraction(2, 5), makeFraction(1, 3),
+        makeFraction(2, 7), makeFraction(1, 4) };
+
+// 3.0, 2.66, 2.5, 2.0, 1.66, 1.33, 1.0, 0.75, 0.6, 0.5, 0.43, 0.36, 0.33
+const Fraction ACCURACY_MULTIPLIER[] = { makeFraction(3, 1),
+        makeFraction(133, 50), makeFraction(5, 2), makeFraction(2, 1),
+        makeFraction(83, 50), makeFraction(133, 100), makeFraction(1, 1),
+        makeFraction(3, 4), makeFraction(3, 5), makeFraction(1, 2),
+        makeFraction(43, 100), makeFraction(9, 25), makeFraction(33, 100) };
 
 } // anonymous namespace
 
-double getStatMultiplier(const STAT i, const int level) {
+Fraction getStatMultiplier(const STAT i, const int level) {
     if ((i != S_EVASION) && (i != S_ACCURACY)) {
         return STAT_MULTIPLIER[6 - level];
     }
@@ -25,6 +25,8 @@
 #ifndef _STAT_H_
 #define _STAT_H_
 
+#include "Fraction.h"
+
 namespace shoddybattle {
 
 /**
@@ -86,7 +88,7 @@ inline bool isTargeted(const TARGET t) {
             (t == T_USER_OR_ALLY));
 }
 
-double getStatMultiplier(const STAT i, const int level);
+Fraction getStatMultiplier(const STAT i, const int level);
 
 class StatException {
     
@@ -37,6 +37,7 @@
 #include "../mechanics/PokemonType.h"
 #include "../scripting/ScriptMachine.h"
 #include "../main/Log.h"
+#include "../shoddybattle/DataImage.h"
 
 using namespace std;
 using namespace xercesc;
@@ -155,8 +156,18 @@ bool hasChildElement(DOMElement *node, const string child) {
     return (list->getLength() != 0);
 }
 
-void getMove(DOMElement *node, MoveTemplateImpl *pMove,
-        ScriptContextPtr cx) {
+/**
+ * A move as read from the XML, with the source of its script functions.
+ */
+struct MOVE_SOURCE {
+    MoveTemplateImpl move;
+    string init;
+    string use;
+    string attemptHit;
+};
+
+void getMove(DOMElement *node, MOVE_SOURCE *source) {
+    MoveTemplateImpl *pMove = &source->move;
     DOMNamedNodeMap *attributes = node->getAttributes();
     XMLCh tempStr[20];
 
@@ -276,8 +287,16 @@ void getMove(DOMElement *node, MoveTemplateImpl *pMove,
     }
     pMove->targetClass = tc;
 
+    source->init = getElementText(node, "init", true);
+    source->use = getElementText(node, "use", true);
+    source->attemptHit = getElementText(node, "attemptHit", true);
+}
+
+void compileMove(MOVE_SOURCE *source, ScriptContextPtr cx) {
+    MoveTemplateImpl *pMove = &source->move;
+
     // init function
-    string body = getElementText(node, "init", true);
+    string body = source->init;
     if (!body.empty()) {
         string error = pMove->name + "::init";
         vector<string> args;
@@ -285,7 +304,7 @@ void getMove(DOMElement *node, MoveTemplateImpl *pMove,
     }
 
     // use function
-    body = getElementText(node, "use", true);
+    body = source->use;
     if (!body.empty()) {
         string error = pMove->name + "::use";
         vector<string> args;
@@ -297,7 +316,7 @@ void getMove(DOMElement *node, MoveTemplateImpl *pMove,
     }
 
     // attemptHit function
-    body = getElementText(node, "attemptHit", true);
+    body = source->attemptHit;
     if (!body.empty()) {
         string error = pMove->name + "::attemptHit";
         vector<string> args;
@@ -317,7 +336,10 @@ MoveTemplate::~MoveTemplate() {
     delete m_pImpl;
 }
 
-void MoveDatabase::loadMoves(const string file) {
+/**
+ * Parse a move XML file.
+ */
+void parseMoves(const string &file, vector<MOVE_SOURCE> &list) {
     XMLPlatformUtils::Initialize();
     XercesDOMParser parser;
     //parser.setDoSchema(true);
@@ -334,18 +356,83 @@ void MoveDatabase::loadMoves(const string file) {
 
     XMLCh tempStr[12];
     XMLString::transcode("move", tempStr, 11);
-    DOMNodeList *list = root->getElementsByTagName(tempStr);
+    DOMNodeList *nodes = root->getElementsByTagName(tempStr);
+
+    int length = nodes->getLength();
+    list.resize(length);
+    for (int i = 0; i < length; ++i) {
+        DOMElement *item = (DOMElement *)nodes->item(i);
+        getMove(item, &list[i]);
+    }
+}
+
+const unsigned char MOVE_IMAGE = 'M';
+
+void writeMoveImage(const vector<MOVE_SOURCE> &list,
+        vector<unsigned char> &data) {
+    ImageWriter out(data);
+    out << (int32_t)list.size();
+    vector<MOVE_SOURCE>::const_iterator i = list.begin();
+    for (; i != list.end(); ++i) {
+        const MoveTemplateImpl &p = i->move;
+        out << p.name << (int32_t)p.id << (int32_t)p.power;
+        out << (int32_t)p.moveClass << (int32_t)p.targetClass;
+        out << (int32_t)p.pp << (int32_t)p.priority;
+        out << (int32_t)p.flags.to_ulong() << p.accuracy;
+        out << (int32_t)(p.type ? p.type->getTypeValue() : -1);
+        out << i->init << i->use << i->attemptHit;
+    }
+}
+
+bool readMoveImage(const DataImage &image, vector<MOVE_SOURCE> &list) {
+    ImageReader in(image.getData(), image.getSize());
+    int32_t count;
+    in >> count;
+    for (int i = 0; (i < count) && !in.hasError(); ++i) {
+        list.push_back(MOVE_SOURCE());
+        MOVE_SOURCE &source = list.back();
+        MoveTemplateImpl &p = source.move;
+        int32_t id, power, moveClass, targetClass, pp, priority, flags, type;
+        in >> p.name >> id >> power >> moveClass >> targetClass;
+        in >> pp >> priority >> flags >> p.accuracy >> type;
+        in >> source.init >> source.use >> source.attemptHit;
+        p.id = id;
+        p.power = power;
+        p.moveClass = (MOVE_CLASS)moveClass;
+        p.targetClass = (TARGET)targetClass;
+        p.pp = pp;
+        p.priority = priority;
+        p.flags = bitset<FLAG_COUNT>((unsigned long)(uint32_t)flags);
+        if (type >= TYPE_COUNT)
+            return false;
+        p.type = (type < 0) ? NULL : PokemonType::getByValue(type);
+    }
+    return !in.hasError() && in.atEnd();
+}
+
+void MoveDatabase::loadMoves(const string file) {
+    vector<MOVE_SOURCE> list;
+    DataImage image(file, MOVE_IMAGE);
+    if (!image.isValid() || !readMoveImage(image, list)) {
+        list.clear();
+        parseMoves(file, list);
+        vector<unsigned char> data;
+        writeMoveImage(list, data);
+        if (!DataImage::write(file, MOVE_IMAGE, data)) {
+            Log::out() << "Warning: Could not compile " << file << endl;
+        }
+    }
 
     ScriptContextPtr cx = m_machine.acquireContext();
 
     Log::out() << "Unimplemented moves:" << endl;
 
     int implemented = 0;
-    int length = list->getLength();
+    int length = list.size();
     for (int i = 0; i < length; ++i) {
-        DOMElement *item = (DOMElement *)list->item(i);
-        MoveTemplateImpl *move = new MoveTemplateImpl();
-        shoddybattle::getMove(item, move, cx);
+        MOVE_SOURCE &source = list[i];
+        compileMove(&source, cx);
+        MoveTemplateImpl *move = new MoveTemplateImpl(source.move);
 
         if (!move->flags[F_UNIMPLEMENTED]) {
             ++implemented;
@@ -355,7 +442,14 @@ void MoveDatabase::loadMoves(const string file) {
 
         MoveTemplate *pMove = new MoveTemplate(move);
         m_data.insert(MOVE_DATABASE::value_type(move->name, pMove));
-        m_intData.insert(INT_MOVE_DATABASE::value_type(move->id, move->name));
+        if (move->id >= 0) {
+            if (static_cast<size_t>(move->id) >= m_byId.size()) {
+                m_byId.resize(move->id + 1, NULL);
+            }
+            if (!m_byId[move->id]) {
+                m_byId[move->id] = pMove;
+            }
+        }
     }
     Log::out() << implemented << " / " << length << " moves implemented." << endl;
 }
@@ -27,8 +27,10 @@
 
 #include <string>
 #include <map>
+#include <vector>
 #include <bitset>
 #include <boost/shared_ptr.hpp>
+#include <boost/unordered_map.hpp>
 #include "../mechanics/stat.h"
 
 namespace shoddybattle {
@@ -93,8 +95,7 @@ private:
     MoveTemplate &operator=(const MoveTemplate &);
 };
 
-typedef std::map<std::string, MoveTemplate *> MOVE_DATABASE;
-typedef std::map<int, std::string> INT_MOVE_DATABASE;
+typedef boost::unordered_map<std::string, MoveTemplate *> MOVE_DATABASE;
 
 class MoveDatabase {
 public:
@@ -106,31 +107,42 @@ public:
     void loadMoves(const std::string file);
 
     /**
-     * Get a move by ID.
+     * Get the name of a move by ID.
      */
     std::string getMove(const int id) const {
-        return m_intData[id];
+        const MoveTemplate *move = getMoveById(id);
+        return move ? move->getName() : std::string();
+    }
+
+    /**
+     * Get a move by ID.
+     */
+    const MoveTemplate *getMoveById(const int id) const {
+        if ((id < 0) || (static_cast<size_t>(id) >= m_byId.size()))
+            return NULL;
+        return m_byId[id];
     }
 
     /**
-     * Get the number of moves.
+     * Get the number of move IDs.
      */
     int getMoveCount() const {
-        return m_intData.size();
+        return m_byId.size();
     }
 
     /**
      * Get a move by name.
      */
-    const MoveTemplate *getMove(const std::string name) const {
-        return m_data[name];
+    const MoveTemplate *getMove(const std::string &name) const {
+        MOVE_DATABASE::const_iterator i = m_data.find(name);
+        return (i == m_data.end()) ? NULL : i->second;
     }
 
     ~MoveDatabase();
 
 private:
-    mutable MOVE_DATABASE m_data;
-    mutable INT_MOVE_DATABASE m_intData;
+    MOVE_DATABASE m_data;
+    std::vector<const MoveTemplate *> m_byId;
     ScriptMachine &m_machine;
     MoveDatabase(const MoveDatabase &);
     MoveDatabase &operator=(const MoveDatabase &);
@@ -28,6 +28,7 @@
 #include <boost/thread/locks.hpp>
 #include <boost/algorithm/string.hpp>
 #include <boost/integer_traits.hpp>
+#include <boost/lexical_cast.hpp>
 #include <fstream>
 #include <queue>
 #include <exception>
@@ -35,6 +36,7 @@
 #include "network.h"
 #include "../main/LogFile.h"
 #include "../database/DatabaseRegistry.h"
+#include "../database/DatabaseQueue.h"
 
 using namespace std;
 using namespace boost;
@@ -325,18 +327,25 @@ int32_t Channel::getId() const {
 }
 
 bool Channel::join(ClientPtr client) {
+    // Look up the client's auto flags and bans on this channel before taking
+    // the lock, because they may come from the database.
+    Channel::FLAGS flags = handleJoin(client);
+    const int ban = handleBan(client);
+    if (ban != 0) {
+        // user is banned from this channel
+        client->informBanned(ban);
+        return false;
+    }
+    return join(client, flags);
+}
+
+bool Channel::join(ClientPtr client, FLAGS flags) {
     upgrade_lock<shared_mutex> lock(m_impl->mutex, boost::defer_lock_t());
     lock.lock();
     if (m_impl->clients.find(client) != m_impl->clients.end()) {
         // already in channel
         return false;
     }
-    // look up the client's auto flags on this channel
-    Channel::FLAGS flags = handleJoin(client);
-    if (handleBan(client)) {
-        // user is banned from this channel
-        return false;
-    }
     // tell the client all about the channel
     client->sendMessage(ChannelInfo(shared_from_this()));
     // upgrade to exclusive ownership of the mutex
@@ -361,18 +370,18 @@ bool Channel::join(ClientPtr client) {
     return true;
 }
 
-bool Channel::handleBan(ClientPtr client) {
+int Channel::handleBan(ClientPtr client) {
     int ban, flags;
     database::DatabaseRegistry *registry = m_impl->server->getRegistry();
     registry->getBan(m_impl->id, client->getName(), ban,
             flags);
-    if (ban < time(NULL)) {
+    // Most users have never been banned, so their joins must not write.
+    if (database::DatabaseRegistry::isBanExpired(ban)) {
         // ban expired; remove it
         registry->removeBan(m_impl->id, client->getName());
-        return false;
+        return 0;
     }
-    client->informBanned(ban);
-    return true;
+    return ban;
 }
 
 void Channel::part(ClientPtr client) {
@@ -400,13 +409,23 @@ void Channel::part(ClientPtr client) {
     }
 }
 
+// The writes to a channel's flags are keyed by channel, so that they reach
+// the database in the order the modes were changed.
 void Channel::commitStatusFlags(ClientPtr client, FLAGS flags) {
-    m_impl->server->getRegistry()->setUserFlags(m_impl->id, client->getId(),
-            flags.to_ulong());
+    Server *server = m_impl->server;
+    server->getDatabaseQueue()->post(database::DatabaseQueue::QUERY_CHANNEL,
+            boost::bind(&database::DatabaseRegistry::setUserFlags,
+                server->getRegistry(), m_impl->id, client->getId(),
+                int(flags.to_ulong())),
+            "channel " + lexical_cast<string>(m_impl->id));
 }
 
 void Channel::commitChannelFlags(CHANNEL_FLAGS flags) {
-    m_impl->server->getRegistry()->setChannelFlags(m_impl->id, flags.to_ulong());
+    Server *server = m_impl->server;
+    server->getDatabaseQueue()->post(database::DatabaseQueue::QUERY_CHANNEL,
+            boost::bind(&database::DatabaseRegistry::setChannelFlags,
+                server->getRegistry(), m_impl->id, int(flags.to_ulong())),
+            "channel " + lexical_cast<string>(m_impl->id));
 }
 
 Channel::FLAGS Channel::handleJoin(ClientPtr client) {
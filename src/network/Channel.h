@@ -127,6 +127,12 @@ public:
 
     virtual FLAGS handleJoin(ClientPtr client);
 
+    /**
+     * Get the expiry of the client's ban on this channel, or zero if the
+     * client is not banned. Like handleJoin, this may query the database.
+     */
+    virtual int handleBan(ClientPtr client);
+
     virtual void handlePart(ClientPtr client);
     
     virtual void handleFinalise() { }
@@ -135,6 +141,12 @@ public:
 
     virtual bool join(ClientPtr client);
 
+    /**
+     * Add a client whose flags and bans have already been looked up. This
+     * does not touch the database.
+     */
+    virtual bool join(ClientPtr client, FLAGS flags);
+
     virtual void part(ClientPtr client);
 
     virtual void writeLog(const std::string &);
@@ -151,7 +163,6 @@ private:
     class ChannelMessage;
     class ChannelJoinPart;
     class ChannelImpl;
-    virtual bool handleBan(ClientPtr client);
 
     boost::shared_ptr<ChannelImpl> m_impl;
 };
@@ -24,6 +24,7 @@
 
 #include <vector>
 #include <cmath>
+#include <cassert>
 #include <ctime>
 #include <fstream>
 #include <boost/regex.hpp>
@@ -34,11 +35,14 @@
 #include <boost/enable_shared_from_this.hpp>
 #include <boost/date_time/gregorian/gregorian.hpp>
 #include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/date_time/c_local_time_adjustor.hpp>
 #include "NetworkBattle.h"
 #include "ThreadedQueue.h"
+#include "WorkerPool.h"
 #include "network.h"
 #include "Channel.h"
 #include "../mechanics/JewelMechanics.h"
+#include "../shoddybattle/BattleRecord.h"
 #include "../mechanics/PokemonNature.h"
 #include "../scripting/ScriptMachine.h"
 #include "../text/Text.h"
@@ -119,27 +123,47 @@ class BattleLogMessage;
 
 namespace {
 
+/**
+ * How a logged field is encoded in an OutMessage.
+ */
+enum LOG_KIND {
+    LK_BYTE,
+    LK_INT16,
+    LK_INT32,
+    LK_STRING,
+    LK_STRING_ARRAY     // byte count followed by that many strings
+};
+
+template <class T> struct LogKind;
+template <> struct LogKind<unsigned char> { enum { VALUE = LK_BYTE }; };
+template <> struct LogKind<int16_t> { enum { VALUE = LK_INT16 }; };
+template <> struct LogKind<int32_t> { enum { VALUE = LK_INT32 }; };
+template <> struct LogKind<string> { enum { VALUE = LK_STRING }; };
+
+/**
+ * A field of a battle event that appears in the battle log. The value is not
+ * copied anywhere; it is read back out of the encoded message when the log
+ * is rendered.
+ */
+struct LogField {
+    const char *name;
+    unsigned char kind;
+    uint16_t offset;    // from the start of the message
+};
+
 // An entity that should be written to the battle log. This class intentionally
 // has a very short name. If an entity is not given a name, it will be written
-// only to the network, not to the battle log.
+// only to the network, not to the battle log. The name must be a literal,
+// since the log keeps a pointer to it until the event is rendered.
 template <class T>
 class Entity {
 public:
-    Entity(const T &v, const string &name = string()):
+    Entity(const T &v, const char *name = NULL):
             m_value(v), m_name(name) { }
 protected:
     friend class network::BattleLogMessage;
     const T &m_value;
-    string m_name;
-};
-
-template <class T>
-class ArrayEntity : public Entity<T> {
-public:
-    ArrayEntity(const T &v, const string &name, const int idx):
-            Entity<T>(v, name) {
-        Entity<T>::m_name += "[" + boost::lexical_cast<string>(idx) + "]";
-    }
+    const char *m_name;
 };
 
 // Encode a value for inclusion in the log.
@@ -164,24 +188,81 @@ string getLogValue(const string &v) {
     return "\"" + ret + "\"";
 }
 
+int readInt16(const unsigned char *p) {
+    return static_cast<int16_t>((p[0] << 8) | p[1]);
+}
+
+int readInt32(const unsigned char *p) {
+    return static_cast<int32_t>((p[0] << 24) | (p[1] << 16)
+            | (p[2] << 8) | p[3]);
+}
+
+// Read a string written by OutMessageBuffer and advance past it.
+string readString(const unsigned char *&p) {
+    const int length = (p[0] << 8) | p[1];
+    string ret(reinterpret_cast<const char *>(p + 2), length);
+    p += length + 2;
+    return ret;
+}
+
+// Render one logged field as it appears in the text log.
+void renderField(string &out, const LogField &field, const unsigned char *p) {
+    p += field.offset;
+    const string name = field.name;
+    switch (field.kind) {
+        case LK_BYTE:
+            out += name + "=" + getLogValue(*p);
+            break;
+        case LK_INT16:
+            out += name + "=" + getLogValue(readInt16(p));
+            break;
+        case LK_INT32:
+            out += name + "=" + getLogValue(readInt32(p));
+            break;
+        case LK_STRING:
+            out += name + "=" + getLogValue(readString(p));
+            break;
+        case LK_STRING_ARRAY: {
+            const int count = *p++;
+            for (int i = 0; i < count; ++i) {
+                if (i != 0) {
+                    out += ", ";
+                }
+                out += name + "[" + getLogValue(i) + "]="
+                        + getLogValue(readString(p));
+            }
+        } break;
+    }
+}
+
 }
 
 /**
- * Battle logs will be written in a text format whose structure is similar to
- * the information contained the raw network messages, so we write both the
- * raw network message and the battle log at the same time using this class.
+ * A battle event. The event is encoded once, as the network message, and the
+ * battle log keeps that same encoding along with the positions of the fields
+ * it wants to show, so the text form of the event is only produced when the
+ * log is rendered.
  */
 class BattleLogMessage {
 public:
-    BattleLogMessage(const OutMessage::TYPE &type, const string &name):
-            m_msg(type) {
-        m_log = "[" + name + "]  ";
-    }
+    // More than the largest event (status_change) has.
+    enum { MAX_FIELDS = 8 };
+
+    BattleLogMessage(const OutMessage::TYPE &type, const char *name):
+            m_msg(type), m_name(name), m_fieldCount(0) { }
     template <class T>
     BattleLogMessage &operator<<(const Entity<T> &val) {
+        addField(val.m_name, LogKind<T>::VALUE);
         m_msg << val.m_value;
-        if (!val.m_name.empty()) {
-            m_log += val.m_name + "=" + getLogValue(val.m_value) + ", ";
+        return *this;
+    }
+    BattleLogMessage &operator<<(const Entity<vector<string> > &val) {
+        addField(val.m_name, LK_STRING_ARRAY);
+        const vector<string> &v = val.m_value;
+        const int count = v.size();
+        m_msg << (unsigned char)count;
+        for (int i = 0; i < count; ++i) {
+            m_msg << v[i];
         }
         return *this;
     }
@@ -191,30 +272,60 @@ public:
     }
     void finalise() {
         m_msg.finalise();
-        m_log = m_log.erase(m_log.size() - 2);
     }
     const OutMessage &getMsg() const {
         return m_msg;
     }
-    const string &getLog() const {
-        return m_log;
+    const char *getName() const {
+        return m_name;
+    }
+    const LogField *getFields() const {
+        return m_fields;
+    }
+    int getFieldCount() const {
+        return m_fieldCount;
     }
 private:
+    void addField(const char *name, const int kind) {
+        if (!name)
+            return;
+        assert(m_fieldCount < MAX_FIELDS);
+        LogField &field = m_fields[m_fieldCount++];
+        field.name = name;
+        field.kind = kind;
+        field.offset = m_msg().size();
+    }
+
     OutMessage m_msg;
-    string m_log;
+    const char *m_name;
+    LogField m_fields[MAX_FIELDS];
+    int m_fieldCount;
 };
 
+/**
+ * The battle log is kept as a stream of events in their network encoding.
+ * Appending an event only copies its bytes; the stream is turned into text
+ * by the log writer thread each time it is flushed.
+ */
 class BattleLog {
 public:
-    BattleLog() {
+    BattleLog(): m_stream(new Stream()) {
         boost::lock_guard<boost::mutex> lock(m_mutex);
         m_date = to_iso_extended_string(gc::day_clock::local_day());
         const string dir = "logs/battles/" + m_date + "/";
-        fs::create_directories(dir);
+        if (dir != m_directory) {
+            fs::create_directories(dir);
+            m_directory = dir;
+        }
         const pt::time_duration t =
                 pt::second_clock::local_time().time_of_day();
         const string prefix = pt::to_simple_string(t);
+        // Battles that start in the same second get consecutive suffixes,
+        // so start probing after the last suffix handed out.
         int suffix = -1;
+        if (prefix == m_lastPrefix) {
+            suffix = m_lastSuffix;
+        }
         string file;
         do {
             ++suffix;
@@ -224,27 +335,142 @@ public:
             }
             file = dir + m_id;
         } while (fs::exists(file));
-        m_file.open(file.c_str());
+        m_lastPrefix = prefix;
+        m_lastSuffix = suffix;
+        m_file.reset(new ofstream(file.c_str()));
+        m_stream->file = m_file;
+        m_path = file;
+    }
+    ~BattleLog() {
+        flush();
     }
     const string getId() const {
         return m_date + "-" + m_id;
     }
     void write(const string &str, const bool timestamp = true) {
-        if (timestamp) {
-            const pt::time_duration t =
-                    pt::second_clock::local_time().time_of_day();
-            m_file << "(" <<  pt::to_simple_string(t) << ") ";
-        }
-        m_file << str << flush;
+        boost::lock_guard<boost::mutex> lock(m_streamMutex);
+        Record record = { time(NULL), timestamp, NULL,
+                static_cast<unsigned int>(m_stream->bytes.size()), 0, 0 };
+        m_stream->bytes.insert(m_stream->bytes.end(), str.begin(), str.end());
+        m_stream->records.push_back(record);
     }
     BattleLog &operator<<(const BattleLogMessage &msg) {
-        write(msg.getLog() + "\n");
+        boost::lock_guard<boost::mutex> lock(m_streamMutex);
+        const OutMessageBuffer &data = msg.getMsg()();
+        Record record = { time(NULL), true, msg.getName(),
+                static_cast<unsigned int>(m_stream->bytes.size()),
+                static_cast<unsigned int>(m_stream->fields.size()),
+                static_cast<unsigned int>(msg.getFieldCount()) };
+        m_stream->bytes.insert(m_stream->bytes.end(), data.begin(),
+                data.end());
+        m_stream->fields.insert(m_stream->fields.end(), msg.getFields(),
+                msg.getFields() + msg.getFieldCount());
+        m_stream->records.push_back(record);
         return *this;
     }
+
+    /**
+     * Hand everything logged so far to the writer thread. The battle flushes
+     * at the end of each turn and whenever it is about to wait for a client.
+     */
+    void flush() {
+        STREAM_PTR stream;
+        {
+            boost::lock_guard<boost::mutex> lock(m_streamMutex);
+            if (m_stream->records.empty())
+                return;
+            stream = m_stream;
+            m_stream = STREAM_PTR(new Stream());
+            m_stream->file = m_file;
+        }
+        if (m_writer) {
+            m_writer->post(stream);
+        } else {
+            render(stream);
+        }
+    }
+
+    /**
+     * Save the record of the battle next to the text log.
+     */
+    void writeRecord(const BattleRecord &record) {
+        vector<unsigned char> data;
+        record.write(data);
+        ofstream file((m_path + ".replay").c_str(), ios::binary);
+        file.write(reinterpret_cast<const char *>(&data[0]), data.size());
+    }
+
+    /**
+     * Start the thread that renders battle logs. Until this is called, logs
+     * are rendered on the thread that flushes them.
+     */
+    static void startWriterThread() {
+        m_writer = new ThreadedQueue<STREAM_PTR>(&BattleLog::render);
+    }
+
 private:
-    string m_date, m_id;
-    ofstream m_file;
+    struct Record {
+        time_t time;
+        bool timestamp;
+        const char *name;       // NULL if this record is raw text
+        unsigned int begin;     // within Stream::bytes
+        unsigned int field;     // within Stream::fields
+        unsigned int fieldCount;
+    };
+
+    struct Stream {
+        boost::shared_ptr<ofstream> file;
+        vector<unsigned char> bytes;
+        vector<LogField> fields;
+        vector<Record> records;
+    };
+    typedef boost::shared_ptr<Stream> STREAM_PTR;
+
+    static void render(STREAM_PTR &stream) {
+        typedef boost::date_time::c_local_adjustor<pt::ptime> local_adj;
+        const vector<Record> &records = stream->records;
+        const int count = records.size();
+        const int size = stream->bytes.size();
+        string out;
+        for (int i = 0; i < count; ++i) {
+            const Record &record = records[i];
+            if (record.timestamp) {
+                const pt::ptime t =
+                        local_adj::utc_to_local(pt::from_time_t(record.time));
+                out += "(" + pt::to_simple_string(t.time_of_day()) + ") ";
+            }
+            const unsigned char *p = &stream->bytes[record.begin];
+            if (!record.name) {
+                const int end = (i + 1 < count) ?
+                        records[i + 1].begin : size;
+                out.append(reinterpret_cast<const char *>(p),
+                        end - record.begin);
+                continue;
+            }
+            out += "[" + string(record.name) + "]";
+            const char *separator = "  ";
+            for (unsigned int j = 0; j < record.fieldCount; ++j) {
+                string field;
+                renderField(field, stream->fields[record.field + j], p);
+                if (!field.empty()) {
+                    out += separator + field;
+                    separator = ", ";
+                }
+            }
+            out += "\n";
+        }
+        *stream->file << out << std::flush;
+    }
+
+    string m_date, m_id, m_path;
+    boost::shared_ptr<ofstream> m_file;
+    STREAM_PTR m_stream;
+    boost::mutex m_streamMutex;
     static boost::mutex m_mutex;
+    static string m_directory;  // the last directory created
+    static string m_lastPrefix;
+    static int m_lastSuffix;
+    static ThreadedQueue<STREAM_PTR> *m_writer;
 };
 
 class BattleChannel : public Channel {
@@ -261,15 +487,16 @@ public:
         // does nothing in a BattleChannel
     }
 
-    bool join(ClientPtr client);
+    bool join(ClientPtr client, FLAGS flags);
 
     FLAGS handleJoin(ClientPtr client);
 
     void handlePart(ClientPtr client);
 
-    bool handleBan() const {
-        // Banned users cannot join a battle.
-        return true;
+    int handleBan(ClientPtr /*client*/) {
+        // Channel bans do not apply to battles, so there is nothing to look
+        // up in the database.
+        return 0;
     }
 
     void handleFinalise() {
@@ -291,6 +518,7 @@ public:
 
     void writeLog(const string &msg) {
         m_log.write("[chat] " + msg + "\n");
+        m_log.flush();
     }
 
 private:
@@ -310,6 +538,10 @@ private:
 };
 
 boost::mutex BattleLog::m_mutex;
+string BattleLog::m_directory;
+string BattleLog::m_lastPrefix;
+int BattleLog::m_lastSuffix = -1;
+ThreadedQueue<BattleLog::STREAM_PTR> *BattleLog::m_writer = NULL;
 
 struct NetworkBattleImpl {
     Server *m_server;
@@ -334,7 +566,9 @@ struct NetworkBattleImpl {
     bool m_terminated;
     TimerPtr m_timer;
     BattleLog *m_log;
-    ThreadedQueue<TURN_PTR> m_queue;
+    BattleRecord m_record;
+    EventDigest m_digest;
+    PooledQueue<TURN_PTR> m_queue;
 
     static TimerList m_timerList;
     static boost::recursive_mutex m_timerMutex;
@@ -408,6 +642,9 @@ struct NetworkBattleImpl {
         m_lock = &lock;
         ScriptContextPtr cx = m_field->getContext()->shared_from_this();
         ScriptContextLock cxLock(cx);
+        m_record.steps.push_back(BattleStep(m_replacement ?
+                BattleStep::S_REPLACEMENT : BattleStep::S_TURN));
+        m_record.steps.back().turns = *ptr;
         if (m_replacement) {
             m_field->processReplacements(*ptr);
         } else {
@@ -416,6 +653,7 @@ struct NetworkBattleImpl {
         if (!m_victory && !requestReplacements()) {
             beginTurn();
         }
+        m_log->flush();
     } // ~NetworkBattle will run here if the battle ended this turn.
 
     Pokemon *requestInactivePokemon(Pokemon *user) {
@@ -426,6 +664,7 @@ struct NetworkBattleImpl {
         m_waiting = m_replacement = true;
         m_requests[party].push_back(user->getSlot());
         requestAction(party);
+        m_log->flush();
 
         ScriptContextPtr cx = m_field->getContext()->shared_from_this();
         
@@ -441,6 +680,18 @@ struct NetworkBattleImpl {
         return ret;
     }
 
+    /**
+     * Answer the pending requestInactivePokemon. The choice is recorded
+     * here, while the lock is held, so that it always comes before a forfeit
+     * which interrupted the selection.
+     */
+    void setSelection(Pokemon *p) {
+        m_selection = p;
+        m_waiting = false;
+        m_record.steps.push_back(BattleStep(BattleStep::S_SELECTION,
+                p ? p->getPosition() : -1));
+    }
+
     void informBeginTurn() {
         BattleLogMessage msg(OutMessage::BATTLE_BEGIN_TURN, "begin_turn");
         msg << m_field;
@@ -516,6 +767,27 @@ struct NetworkBattleImpl {
         }
     }
 
+    void initialiseRecord(Pokemon::ARRAY *teams,
+            vector<StatusObject> &clauses) {
+        BattleRecord &record = m_record;
+        record.seed = m_mech.getSeed();
+        record.generation = m_field->getGeneration()->getIdx();
+        record.partySize = m_field->getPartySize();
+        record.metagame = m_metagame;
+        ScriptContext *cx = m_field->getContext();
+        vector<StatusObject>::iterator i = clauses.begin();
+        for (; i != clauses.end(); ++i) {
+            record.clauses.push_back(i->getName(cx));
+        }
+        for (int j = 0; j < TEAM_COUNT; ++j) {
+            record.trainer[j] = m_trainer[j];
+            Pokemon::ARRAY::const_iterator k = teams[j].begin();
+            for (; k != teams[j].end(); ++k) {
+                record.teams[j].push_back(PokemonRecord(**k));
+            }
+        }
+    }
+
     void writeLogHeader() {
         ostringstream ret;
         string trainer0 = m_trainer[0];
@@ -856,10 +1128,21 @@ struct NetworkBattleImpl {
         while (m_waiting) {
             // One client is in the middle of selecting a pokemon for a move
             // like U-turn or Baton Pass. To allow the battle to exit nicely,
-            // we have to pick a pokemon for the client.
+            // we have to pick a pokemon for the client. The first legal one
+            // is used rather than a random one, so that the replay does not
+            // have to know that this pick did not come from the player.
             const int party = m_selection->getParty();
-            m_selection = m_field->getRandomInactivePokemon(m_selection);
-            m_waiting = false;
+            vector<bool> switches;
+            m_field->getLegalSwitches(m_selection, switches);
+            Pokemon *choice = NULL;
+            const int count = switches.size();
+            for (int i = 0; i < count; ++i) {
+                if (switches[i]) {
+                    choice = m_field->getTeam(party)[i].get();
+                    break;
+                }
+            }
+            setSelection(choice);
             m_requests[party].clear();
             m_turns[party].clear();
             m_condition.notify_one();
@@ -870,7 +1153,9 @@ struct NetworkBattleImpl {
 
         ScriptContextPtr cx = m_field->getContext()->shared_from_this();
         ScriptContextLock cxLock(cx);
+        m_record.steps.push_back(BattleStep(BattleStep::S_FORFEIT, party));
         m_field->informVictory(1 - party);
+        m_log->flush();
     }
 
     void maybeExecuteTurn() {
@@ -909,6 +1194,8 @@ BattleChannelPtr BattleChannel::createChannel(Server *server,
 }
 
 Channel::FLAGS BattleChannel::handleJoin(ClientPtr client) {
+    // join() no longer holds the lock while the flags are looked up.
+    boost::lock_guard<boost::recursive_mutex> lock(m_mutex);
     FLAGS ret;
     ChannelPtr p = m_server->getMainChannel();
     if (p) {
@@ -928,7 +1215,7 @@ Channel::FLAGS BattleChannel::handleJoin(ClientPtr client) {
     return ret;
 }
 
-bool BattleChannel::join(ClientPtr client) {
+bool BattleChannel::join(ClientPtr client, FLAGS flags) {
     // We acquire BattleChannel's mutex before Channel's mutex, since we are
     // going to lock both at once.
     boost::lock_guard<boost::recursive_mutex> lock(m_mutex);
@@ -937,7 +1224,7 @@ bool BattleChannel::join(ClientPtr client) {
     if (!m_field)
         return false;
 
-    if (!Channel::join(client)) // locks Channel's mutex
+    if (!Channel::join(client, flags)) // locks Channel's mutex
         return false;
     if (m_field->m_field->getParty(client) == -1) {
         m_field->prepareSpectator(client);
@@ -984,6 +1271,9 @@ void NetworkBattle::terminate() {
     boost::unique_lock<boost::recursive_mutex> lock(m, boost::adopt_lock),
             lock2(m_impl->m_mutex, boost::adopt_lock);
     m_impl->m_terminated = true;
+    m_impl->m_record.digest = m_impl->m_digest.getHash();
+    m_impl->m_record.eventCount = m_impl->m_digest.getCount();
+    m_impl->m_log->writeRecord(m_impl->m_record);
     m_impl->m_channel->informBattleTerminated();
     // There will always be two clients in the vector at this point.
     m_impl->m_clients[0]->terminateBattle(p, m_impl->m_clients[1]);
@@ -1039,6 +1329,7 @@ NetworkBattle::NetworkBattle(Server *server,
     BattleField::initialise(&m_impl->m_mech, generation, server->getMachine(),
             teams, &m_impl->m_trainer[0], partySize, clauses);
     m_impl->writeLogHeader();
+    m_impl->initialiseRecord(teams, clauses);
 }
 
 int32_t NetworkBattle::getId() const {
@@ -1052,6 +1343,7 @@ void NetworkBattle::beginBattle() {
     }
     BattleField::beginBattle();
     m_impl->beginTurn();
+    m_impl->m_log->flush();
     BattleField::getContext()->clearContextThread();
     m_impl->m_server->addChannel(m_impl->m_channel);
 }
@@ -1120,8 +1412,7 @@ void NetworkBattle::handleTurn(const int party, const PokemonTurn &turn) {
         m_impl->requestAction(party);
     } else if (m_impl->m_waiting) {
         // Client has sent in an inactive pokemon for U-turn and friends.
-        m_impl->m_waiting = false;
-        m_impl->m_selection = getTeam(party)[turn.id].get();
+        m_impl->setSelection(getTeam(party)[turn.id].get());
         req.clear();
         pturn.clear();
         lock.unlock();
@@ -1148,17 +1439,13 @@ Pokemon *NetworkBattle::requestInactivePokemon(Pokemon *pokemon) {
 void NetworkBattle::print(const TextMessage &text) {
     if (!isNarrationEnabled())
         return;
+    m_impl->m_digest.print(text);
 
     BattleLogMessage msg(OutMessage::BATTLE_PRINT, "print");
     msg << this;
     msg << Entity<unsigned char>(text.getCategory(), "category");
     msg << Entity<int16_t>(text.getMessage(), "message");
-    const vector<string> &args = text.getArgs();
-    const int count = args.size();
-    msg << Entity<unsigned char>(count);
-    for (int i = 0; i < count; ++i) {
-        msg << ArrayEntity<string>(args[i], "token", i);
-    }
+    msg << Entity<vector<string> >(text.getArgs(), "token");
     msg.finalise();
     *m_impl->m_log << msg;
 
@@ -1173,6 +1460,7 @@ void NetworkBattle::print(const TextMessage &text) {
  */
 void NetworkBattle::informVictory(const int party) {   
     m_impl->m_victory = true;
+    m_impl->m_digest.victory(party);
 
     BattleLogMessage msg(OutMessage::BATTLE_VICTORY, "victory");
     msg << this;
@@ -1202,12 +1490,15 @@ void NetworkBattle::informVictory(const int party) {
  * int16 : move id
  */
 void NetworkBattle::informUseMove(Pokemon *pokemon, MoveObject *move) {
+    const int16_t id = move->getTemplate(getContext())->getId();
+    m_impl->m_digest.useMove(pokemon, id);
+
     BattleLogMessage msg(OutMessage::BATTLE_USE_MOVE, "use_move");
     msg << this;
     msg << Entity<unsigned char>(pokemon->getParty(), "party");
     msg << Entity<unsigned char>(pokemon->getSlot(), "slot");
     msg << Entity<string>(pokemon->getName(), "nickname");
-    msg << Entity<int16_t>(move->getTemplate(getContext())->getId(), "move");
+    msg << Entity<int16_t>(id, "move");
     msg.finalise();
     *m_impl->m_log << msg;
 
@@ -1223,6 +1514,8 @@ void NetworkBattle::informUseMove(Pokemon *pokemon, MoveObject *move) {
  * string : pokemon [nick]name
  */
 void NetworkBattle::informWithdraw(Pokemon *pokemon) {
+    m_impl->m_digest.withdraw(pokemon);
+
     BattleLogMessage msg(OutMessage::BATTLE_WITHDRAW, "withdraw");
     msg << this;
     msg << Entity<unsigned char>(pokemon->getParty(), "party");
@@ -1247,6 +1540,8 @@ void NetworkBattle::informWithdraw(Pokemon *pokemon) {
  * byte   : level
  */
 void NetworkBattle::informSendOut(Pokemon *pokemon) {
+    m_impl->m_digest.sendOut(pokemon);
+
     BattleLogMessage msg(OutMessage::BATTLE_SEND_OUT, "send_out");
     msg << this;
     msg << Entity<unsigned char>(pokemon->getParty(), "party");
@@ -1290,6 +1585,8 @@ public:
 };
 
 void NetworkBattle::informHealthChange(Pokemon *pokemon, const int raw) {
+    m_impl->m_digest.healthChange(pokemon, raw);
+
     const int hp = pokemon->getRawStat(S_HP);
     const int present = pokemon->getHp();
     const int delta = floor(48.0 * (double)raw / (double)hp + 0.5);
@@ -1320,6 +1617,8 @@ void NetworkBattle::informHealthChange(Pokemon *pokemon, const int raw) {
  */
 void NetworkBattle::informSetPp(Pokemon *pokemon,
         const int move, const int pp) {
+    m_impl->m_digest.setPp(pokemon, move, pp);
+
     // Don't bother logging this message.
     OutMessage msg(OutMessage::BATTLE_SET_PP);
     msg << getId();
@@ -1344,6 +1643,8 @@ void NetworkBattle::informSetPp(Pokemon *pokemon,
  */
 void NetworkBattle::informSetMove(Pokemon *pokemon, const int idx,
         const int move, const int pp, const int maxPp) {
+    m_impl->m_digest.setMove(pokemon, idx, move, pp, maxPp);
+
     // Don't bother logging this message.
     OutMessage msg(OutMessage::BATTLE_SET_MOVE);
     msg << getId();
@@ -1367,6 +1668,8 @@ void NetworkBattle::informSetMove(Pokemon *pokemon, const int idx,
  * string : pokemon [nick]name
  */
 void NetworkBattle::informFainted(Pokemon *pokemon) {
+    m_impl->m_digest.fainted(pokemon);
+
     BattleLogMessage msg(OutMessage::BATTLE_FAINTED, "fainted");
     msg << this;
     msg << Entity<unsigned char>(pokemon->getParty(), "party");
@@ -1397,6 +1700,7 @@ void NetworkBattle::informFainted(Pokemon *pokemon) {
 void NetworkBattle::informStatusChange(Pokemon *p, StatusObject *effect,
         const bool applied) {
     ScriptContext *cx = BattleField::getContext();
+    m_impl->m_digest.statusChange(p, effect->getId(cx), applied);
     string text = effect->toString(cx);
     if (text.empty()) {
         return;
@@ -1445,6 +1749,10 @@ void NetworkBattle::startTimerThread() {
             boost::bind(&handleTiming));
 }
 
+void NetworkBattle::startLogThread() {
+    BattleLog::startWriterThread();
+}
+
 bool Timer::tick() {
     time_t now = time(NULL);
     int delta = now - m_lastTime;
@@ -49,6 +49,7 @@ public:
     typedef boost::shared_ptr<NetworkBattle> PTR;
     
     static void startTimerThread();
+    static void startLogThread();
     
     NetworkBattle(Server *server,
             boost::shared_ptr<network::Client> *clients,
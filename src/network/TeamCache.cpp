@@ -0,0 +1,97 @@
+/*
+ * File:   TeamCache.cpp
+ * Author: Catherine
+ *
+ * Created on October 19, 2026, 10:15 PM
+ *
+ * This file is a part of Shoddy Battle.
+ * Copyright (C) 2009  Catherine Fitzpatrick and Benjamin Gwin
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program; if not, visit the Free Software Foundation, Inc.
+ * online at http://gnu.org.
+ */
+
+#include <sstream>
+#include "TeamCache.h"
+#include "../scripting/ScriptMachine.h"
+
+using namespace std;
+using namespace boost;
+
+namespace shoddybattle { namespace network {
+
+string TeamCache::getKey(const vector<StatusObject> &clauses,
+        const set<unsigned int> &bans, const Pokemon::ARRAY &team) {
+    stringstream ss;
+    // The clause objects live as long as the server, so their addresses
+    // identify them.
+    vector<StatusObject>::const_iterator i = clauses.begin();
+    for (; i != clauses.end(); ++i) {
+        ss << i->getObject() << ",";
+    }
+    ss << "|";
+    set<unsigned int>::const_iterator j = bans.begin();
+    for (; j != bans.end(); ++j) {
+        ss << *j << ",";
+    }
+    Pokemon::ARRAY::const_iterator k = team.begin();
+    for (; k != team.end(); ++k) {
+        ss << "|" << (*k)->getSignature();
+    }
+    return ss.str();
+}
+
+bool TeamCache::find(const string &key, Pokemon::ARRAY &team,
+        vector<int> &violations) {
+    lock_guard<mutex> lock(m_mutex);
+    ENTRY_MAP::iterator i = m_entries.find(key);
+    if (i == m_entries.end())
+        return false;
+    ENTRY &entry = i->second;
+    m_ages.splice(m_ages.begin(), m_ages, entry.age);
+    violations.insert(violations.end(),
+            entry.violations.begin(), entry.violations.end());
+    const int size = entry.levels.size();
+    for (int j = 0; j < size; ++j) {
+        team[j]->setLevel(entry.levels[j]);
+    }
+    return true;
+}
+
+void TeamCache::insert(const string &key, const Pokemon::ARRAY &team,
+        const vector<int> &violations) {
+    lock_guard<mutex> lock(m_mutex);
+    if (m_entries.count(key))
+        return;
+    if (m_entries.size() >= size_t(m_capacity)) {
+        m_entries.erase(m_ages.back());
+        m_ages.pop_back();
+    }
+    m_ages.push_front(key);
+    ENTRY &entry = m_entries[key];
+    entry.violations = violations;
+    entry.age = m_ages.begin();
+    Pokemon::ARRAY::const_iterator i = team.begin();
+    for (; i != team.end(); ++i) {
+        entry.levels.push_back((*i)->getLevel());
+    }
+}
+
+void TeamCache::clear() {
+    lock_guard<mutex> lock(m_mutex);
+    m_entries.clear();
+    m_ages.clear();
+}
+
+}} // namespace shoddybattle::network
@@ -0,0 +1,102 @@
+/*
+ * File:   TeamCache.h
+ * Author: Catherine
+ *
+ * Created on October 19, 2026, 10:15 PM
+ *
+ * This file is a part of Shoddy Battle.
+ * Copyright (C) 2009  Catherine Fitzpatrick and Benjamin Gwin
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program; if not, visit the Free Software Foundation, Inc.
+ * online at http://gnu.org.
+ */
+
+#ifndef _TEAM_CACHE_H_
+#define _TEAM_CACHE_H_
+
+#include <string>
+#include <vector>
+#include <set>
+#include <map>
+#include <list>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/locks.hpp>
+#include <boost/noncopyable.hpp>
+#include "../shoddybattle/Pokemon.h"
+
+namespace shoddybattle {
+
+class StatusObject;
+
+namespace network {
+
+/**
+ * The results of validating teams, so that a player who joins the ladder with
+ * the same team again does not have to go through the clause scripts and the
+ * legality checks a second time. The least recently used team is forgotten
+ * once the cache is full.
+ *
+ * A TeamCache is thread safe.
+ */
+class TeamCache : boost::noncopyable {
+public:
+    TeamCache(const int capacity):
+            m_capacity(capacity) { }
+
+    /**
+     * Get the key of a team validated under the given clauses and bans.
+     */
+    static std::string getKey(const std::vector<StatusObject> &clauses,
+            const std::set<unsigned int> &bans, const Pokemon::ARRAY &team);
+
+    /**
+     * Look up a team. If it is found, its violations are appended to
+     * `violations` and the changes the clauses made to the team are made
+     * again.
+     */
+    bool find(const std::string &key, Pokemon::ARRAY &team,
+            std::vector<int> &violations);
+
+    /**
+     * Remember the result of validating a team.
+     */
+    void insert(const std::string &key, const Pokemon::ARRAY &team,
+            const std::vector<int> &violations);
+
+    /**
+     * Forget every team; this must be done whenever the clauses or the
+     * species data change.
+     */
+    void clear();
+
+private:
+    typedef std::list<std::string> AGE_LIST;
+
+    struct ENTRY {
+        std::vector<int> violations;
+        std::vector<int> levels;    // levels after transformTeam
+        AGE_LIST::iterator age;
+    };
+
+    typedef std::map<std::string, ENTRY> ENTRY_MAP;
+
+    boost::mutex m_mutex;
+    ENTRY_MAP m_entries;
+    AGE_LIST m_ages;                // most recently used first
+    const int m_capacity;
+};
+
+}} // namespace shoddybattle::network
+
+#endif
@@ -0,0 +1,100 @@
+/*
+ * File:   WorkerPool.cpp
+ * Author: Catherine
+ *
+ * Created on October 19, 2026, 9:30 PM
+ *
+ * This file is a part of Shoddy Battle.
+ * Copyright (C) 2009  Catherine Fitzpatrick and Benjamin Gwin
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program; if not, visit the Free Software Foundation, Inc.
+ * online at http://gnu.org.
+ */
+
+#include <boost/bind.hpp>
+#include "WorkerPool.h"
+
+using namespace std;
+using namespace boost;
+
+namespace shoddybattle { namespace network {
+
+namespace {
+
+struct DrainSignal {
+    boost::mutex mutex;
+    boost::condition_variable condition;
+    bool done;
+};
+
+void signalDrained(DrainSignal *signal) {
+    // The waiter cannot return until the mutex is released, so the signal
+    // is still alive while we notify it.
+    boost::lock_guard<boost::mutex> lock(signal->mutex);
+    signal->done = true;
+    signal->condition.notify_one();
+}
+
+} // anonymous namespace
+
+WorkerThread::WorkerThread():
+        m_service(new asio::io_service()),
+        m_work(new asio::io_service::work(*m_service)),
+        m_thread(boost::bind(&WorkerThread::run, m_service)) { }
+
+WorkerThread::~WorkerThread() {
+    m_work.reset();
+    if (isCurrentThread()) {
+        // run() holds its own reference to the io_service.
+        m_thread.detach();
+    } else {
+        m_thread.join();
+    }
+}
+
+void WorkerThread::run(shared_ptr<asio::io_service> service) {
+    service->run();
+}
+
+void WorkerThread::drain() {
+    DrainSignal signal;
+    signal.done = false;
+    m_service->post(boost::bind(signalDrained, &signal));
+    boost::unique_lock<boost::mutex> lock(signal.mutex);
+    while (!signal.done) {
+        signal.condition.wait(lock);
+    }
+}
+
+boost::mutex WorkerPool::m_mutex;
+vector<WorkerPtr> WorkerPool::m_idle;
+
+WorkerPtr WorkerPool::acquire() {
+    {
+        boost::lock_guard<boost::mutex> lock(m_mutex);
+        if (!m_idle.empty()) {
+            WorkerPtr ret = m_idle.back();
+            m_idle.pop_back();
+            return ret;
+        }
+    }
+    return WorkerPtr(new WorkerThread());
+}
+
+void WorkerPool::release(WorkerPtr worker) {
+    boost::lock_guard<boost::mutex> lock(m_mutex);
+    m_idle.push_back(worker);
+}
+
+}} // namespace shoddybattle::network
@@ -0,0 +1,139 @@
+/*
+ * File:   WorkerPool.h
+ * Author: Catherine
+ *
+ * Created on October 19, 2026, 9:30 PM
+ *
+ * This file is a part of Shoddy Battle.
+ * Copyright (C) 2009  Catherine Fitzpatrick and Benjamin Gwin
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program; if not, visit the Free Software Foundation, Inc.
+ * online at http://gnu.org.
+ */
+
+#ifndef _WORKER_POOL_H_
+#define _WORKER_POOL_H_
+
+#include <memory>
+#include <vector>
+#include <boost/asio.hpp>
+#include <boost/thread.hpp>
+#include <boost/function.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/noncopyable.hpp>
+
+namespace shoddybattle { namespace network {
+
+/**
+ * A thread running an io_service. A WorkerThread outlives its users: when one
+ * is done with it, it goes back into the WorkerPool for the next one.
+ */
+class WorkerThread : boost::noncopyable {
+public:
+    WorkerThread();
+    ~WorkerThread();
+
+    boost::asio::io_service &getService() {
+        return *m_service;
+    }
+
+    bool isCurrentThread() const {
+        return (m_thread.get_id() == boost::this_thread::get_id());
+    }
+
+    /**
+     * Wait until every handler posted so far has run.
+     */
+    void drain();
+
+private:
+    static void run(boost::shared_ptr<boost::asio::io_service> service);
+
+    // Note: Do not change the order of the following three declarations.
+    boost::shared_ptr<boost::asio::io_service> m_service;
+    std::auto_ptr<boost::asio::io_service::work> m_work;
+    boost::thread m_thread;
+};
+
+typedef boost::shared_ptr<WorkerThread> WorkerPtr;
+
+/**
+ * Idle worker threads. Each battle takes a thread from here to run its turns
+ * and returns it when the battle ends, so starting a battle does not start a
+ * thread. The pool grows to the largest number of battles that have been in
+ * progress at once.
+ */
+class WorkerPool {
+public:
+    static WorkerPtr acquire();
+    static void release(WorkerPtr worker);
+
+private:
+    static boost::mutex m_mutex;
+    static std::vector<WorkerPtr> m_idle;
+};
+
+/**
+ * A ThreadedQueue that runs on a pooled WorkerThread instead of a thread of
+ * its own.
+ */
+template <class T>
+class PooledQueue : boost::noncopyable {
+public:
+    typedef boost::function<void (T &)> DELEGATE;
+
+    PooledQueue(DELEGATE delegate):
+            m_delegate(delegate),
+            m_worker(WorkerPool::acquire()) { }
+
+    void post(T elem) {
+        boost::lock_guard<boost::mutex> lock(m_mutex);
+        if (m_worker) {
+            m_worker->getService().post(boost::bind(m_delegate, elem));
+        }
+    }
+
+    /**
+     * Wait for the messages posted so far to be handled, then give the
+     * thread back to the pool. Messages posted after this are dropped. If
+     * this is called by a delegate, the remaining messages are still
+     * handled, after the delegate returns.
+     */
+    void join() {
+        WorkerPtr worker;
+        {
+            boost::lock_guard<boost::mutex> lock(m_mutex);
+            worker.swap(m_worker);
+        }
+        if (!worker)
+            return;
+        if (!worker->isCurrentThread()) {
+            worker->drain();
+        }
+        WorkerPool::release(worker);
+    }
+
+    ~PooledQueue() {
+        join();
+    }
+
+private:
+    DELEGATE m_delegate;
+    boost::mutex m_mutex;
+    WorkerPtr m_worker;
+};
+
+}} // namespace shoddybattle::network
+
+#endif
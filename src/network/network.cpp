@@ -52,8 +52,10 @@
 #include "network.h"
 #include "Channel.h"
 #include "NetworkBattle.h"
+#include "TeamCache.h"
 #include "../database/Authenticator.h"
 #include "../database/DatabaseRegistry.h"
+#include "../database/DatabaseQueue.h"
 #include "../text/Text.h"
 #include "../shoddybattle/Pokemon.h"
 #include "../moves/PokemonMove.h"
@@ -177,7 +179,9 @@ public:
         CANCEL_QUEUE = 19,
         CANCEL_BATTLE_ACTION = 20,
         PRIVATE_MESSAGE = 21,
-        IMPORTANT_MESSAGE = 22
+        IMPORTANT_MESSAGE = 22,
+        LADDER_QUERY = 23,
+        CLOSE_RATING_PERIODS = 24
     };
 
     InMessage() {
@@ -369,7 +373,7 @@ Pokemon::PTR readPokemon(SpeciesDatabase *speciesData,
     string ability;
     int natureId;
     int moveCount;
-    vector<string> moves;
+    vector<const MoveTemplate *> moves;
     vector<int> ppUp;
     int ivs[STAT_COUNT];
     int evs[STAT_COUNT];
@@ -387,7 +391,7 @@ Pokemon::PTR readPokemon(SpeciesDatabase *speciesData,
     for (int i = 0; i < moveCount; ++i) {
         int id, pp;
         msg >> id >> pp;
-        moves[i] = moveData->getMove(id);
+        moves[i] = moveData->getMoveById(id);
         ppUp[i] = pp;
     }
 
@@ -596,9 +600,49 @@ public:
     }
 };
 
+class LadderStandings : public OutMessage {
+public:
+    enum QUERY {
+        TOP = 0,        // from a position
+        USER = 1,       // around a user
+        RATING = 2      // around a rating
+    };
+    enum { MAX_PLAYERS = 50 };
+
+    LadderStandings(const int generation, const int metagame, const int type,
+            const int players,
+            database::DatabaseRegistry::STANDING_LIST &standings):
+                OutMessage(LADDER_STANDINGS) {
+        using database::DatabaseRegistry;
+        *this << (unsigned char)generation;
+        *this << (unsigned char)metagame;
+        *this << (unsigned char)type;
+        *this << (int32_t)players;
+        truncate<unsigned char>(standings);
+        *this << (unsigned char)standings.size();
+        DatabaseRegistry::STANDING_LIST::iterator i = standings.begin();
+        for (; i != standings.end(); ++i) {
+            *this << (int32_t)(i->get<0>());
+            *this << i->get<1>();
+            *this << (int32_t)(i->get<2>());
+        }
+        finalise();
+    }
+};
+
 class MetagameQueue {
 public:
-    typedef pair<ClientImplPtr, Pokemon::ARRAY> QUEUE_ENTRY;
+    /**
+     * A client waiting in the queue. The token identifies this particular
+     * visit to the queue, so that an entry which was taken off the queue for
+     * a match can be told apart from a later one for the same client.
+     */
+    struct QUEUE_ENTRY {
+        ClientImplPtr client;
+        Pokemon::ARRAY team;
+        unsigned int token;
+    };
+    typedef map<ClientImplPtr, unsigned int> TOKEN_MAP;
     typedef variate_generator<mt11213b &, uniform_int<> > GENERATOR;
 
     MetagameQueue(int generation, int metagame, bool rated, ServerImpl *server):
@@ -606,7 +650,8 @@ public:
             m_metagame(metagame),
             m_rated(rated),
             m_server(server),
-            m_rand(mt11213b(time(NULL))) { }
+            m_rand(mt11213b(time(NULL))),
+            m_nextToken(0) { }
 
     MetagamePtr getMetagame();
     bool queueClient(ClientImplPtr, Pokemon::ARRAY &);
@@ -614,15 +659,18 @@ public:
     void startMatches();
 
 private:
+    bool claim(const QUEUE_ENTRY &);
+
     int m_generation;
     int m_metagame;
     bool m_rated;
-    CLIENT_LIST m_clients;
+    TOKEN_MAP m_tokens;
     vector<QUEUE_ENTRY> m_queue;
     map<ClientImplPtr, pair<ClientImplPtr, int> > m_generations;
     mutex m_mutex;
     ServerImpl *m_server;
     mt11213b m_rand;
+    unsigned int m_nextToken;
 };
 
 typedef shared_ptr<MetagameQueue> MetagameQueuePtr;
@@ -647,10 +695,12 @@ public:
     void initialiseChannels();
     void initialiseMatchmaking();
     void initialiseClauses();
+    void initialiseRatingPeriods(const int hours);
 
     bool validateTeam(ScriptContextPtr, Pokemon::ARRAY &,
             vector<StatusObject> &, vector<int> &, const set<unsigned int> &);
     database::DatabaseRegistry *getRegistry() { return &m_registry; }
+    database::DatabaseQueue *getDatabaseQueue() { return &m_queries; }
     ScriptMachine *getMachine() { return &m_machine; }
     ChannelPtr getMainChannel() const { return m_mainChannel; }
     void sendChannelList(ClientImplPtr client);
@@ -659,12 +709,10 @@ public:
         return m_generations;
     }
     void sendClauseList(ClientImplPtr client);
-    void fetchClauses(ScriptContextPtr scx, vector<int> &clauses,
-            vector<StatusObject> &ret);
-    void fetchClauses(ScriptContextPtr scx, MetagamePtr metagame,
-            vector<StatusObject> &ret);
-    void fetchClauses(ScriptContextPtr scx, const int metagame,
-            const int generation, vector<StatusObject> &ret);
+    void fetchClauses(const vector<int> &clauses,
+            vector<StatusObject> &ret) const;
+    void fetchClauses(const int generation, const int metagame,
+            vector<StatusObject> &ret) const;
 
     ChannelPtr getChannel(const string &);
     ClientImplPtr getClient(const string &);
@@ -679,7 +727,6 @@ public:
     bool commitBan(const int, const string &, const int, const int,
             const bool = false);
     void commitPersonalMessage(const string& user, const string& msg);
-    void loadPersonalMessage(const string &user, string &msg);
 
 private:
     void acceptClient();
@@ -687,6 +734,7 @@ private:
             const boost::system::error_code &error);
     void handleMatchmaking();
     void handlePhantomClients();
+    void handleRatingPeriods(const int hours);
     void runPopulationServer(const int port);
     static void handleSignal(int signum);
 
@@ -715,14 +763,22 @@ private:
     io_service m_service;
     tcp::acceptor m_acceptor;
     database::DatabaseRegistry m_registry;
+    database::DatabaseQueue m_queries;      // declared after m_registry
     ScriptMachine m_machine;
     vector<GenerationPtr> m_generations;
     map<METAGAME_PAIR, MetagameQueuePtr> m_queues;
     thread m_matchmaking;
     thread m_phantomClientWorker;
+    thread m_ratingPeriods;
     thread m_populationThread;
     shared_ptr<MetagameList> m_metagameList;
     vector<CLAUSE_PAIR> m_clauses;
+    // The clause objects are resolved once, in initialiseClauses, and are
+    // only read after that, so they can be shared without a lock.
+    vector<StatusObject> m_clauseObjects;   // parallel to m_clauses
+    map<METAGAME, vector<StatusObject> > m_metagameClauses;
+    vector<shared_ptr<StatusObject> > m_clauseRoots;
+    TeamCache m_teamCache;
     WelcomeMessage m_welcomeMessage;
     Server *m_server;
 
@@ -747,6 +803,10 @@ database::DatabaseRegistry *Server::getRegistry() {
     return m_impl->getRegistry();
 }
 
+database::DatabaseQueue *Server::getDatabaseQueue() {
+    return m_impl->getDatabaseQueue();
+}
+
 ScriptMachine *Server::getMachine() {
     return m_impl->getMachine();
 }
@@ -776,6 +836,10 @@ void Server::initialiseClauses() {
     m_impl->initialiseClauses();
 }
 
+void Server::initialiseRatingPeriods(const int hours) {
+    m_impl->initialiseRatingPeriods(hours);
+}
+
 ChannelPtr Server::getMainChannel() const {
     return m_impl->getMainChannel();
 }
@@ -789,11 +853,164 @@ Server::~Server() {
     delete m_impl;
 }
 
+namespace {
+
+/**
+ * The database work done for a request. Each query is run on a database
+ * thread and then handed back to the client's io_service with its results.
+ */
+struct ChallengeQuery {
+    string user;
+    string ip;
+    int ban;
+    unsigned char data[16];
+    database::DatabaseRegistry::CHALLENGE_INFO challenge;
+
+    void run(database::DatabaseRegistry *registry) {
+        ban = registry->getGlobalBan(user, ip);
+        if (ban > 0) {
+            if (database::DatabaseRegistry::isBanExpired(ban)) {
+                // ban expired remove the ban
+                registry->removeBan(-1, user);
+                ban = 0;
+            } else {
+                return;
+            }
+        }
+        challenge = registry->getAuthChallenge(user, ip, data);
+    }
+};
+
+struct ResponseQuery {
+    string name;
+    string ip;
+    int challenge;
+    unsigned char data[16];
+    database::DatabaseRegistry::AUTH_PAIR auth;
+    string message;
+
+    void run(database::DatabaseRegistry *registry) {
+        auth = registry->isResponseValid(name, ip, challenge, data);
+        if (auth.first) {
+            registry->updateIp(name, ip);
+            registry->loadPersonalMessage(name, message);
+        }
+    }
+};
+
+struct RegisterQuery {
+    string user;
+    string password;
+    string ip;
+    bool success;
+
+    void run(database::DatabaseRegistry *registry) {
+        success = registry->registerUser(user, password, ip);
+    }
+};
+
+struct UserInfoQuery {
+    string user;
+    string ip;
+    vector<string> aliases;
+    database::DatabaseRegistry::BAN_LIST bans;
+
+    void run(database::DatabaseRegistry *registry) {
+        ip = registry->getIp(user);
+        if (!ip.empty()) {
+            aliases = registry->getAliases(user);
+            bans = registry->getBans(user);
+        }
+    }
+};
+
+struct JoinQuery {
+    ChannelPtr channel;
+    ClientPtr client;
+    Channel::FLAGS flags;
+    int ban;
+
+    void run() {
+        flags = channel->handleJoin(client);
+        ban = channel->handleBan(client);
+    }
+};
+
+/**
+ * The database half of a kick or ban. The outcome is acted on once the
+ * query has finished.
+ */
+struct BanQuery {
+    enum RESULT {
+        NONEXISTENT_USER,
+        UNAUTHORIZED,
+        KICK,
+        BAN,
+        UNBAN,
+        UNCHANGED
+    };
+
+    ChannelPtr channel;
+    Channel::FLAGS auth;    // of the user carrying out the ban
+    int id;
+    int banner;
+    string target;
+    int date;
+    bool ipBan;
+    RESULT result;
+
+    void run(database::DatabaseRegistry *registry) {
+        if (!registry->userExists(target)) {
+            result = NONEXISTENT_USER;
+            return;
+        }
+        Channel::FLAGS uauth = channel->getUserFlags(target);
+        if (!auth[Channel::OP] || uauth[Channel::PROTECTED]
+                || (!auth[Channel::PROTECTED] && uauth[Channel::OP])) {
+            // You don't have the authority to do anything to this user
+            result = UNAUTHORIZED;
+            return;
+        }
+        if (date == 0) {
+            //0 date means kick
+            result = KICK;
+            return;
+        }
+
+        int ban;
+        int setter;
+        if (id == -1) {
+            registry->getBan(-1, target, ban, setter);
+        } else {
+            channel->getBan(target, ban, setter);
+        }
+
+        // Can't change ban made by user with a higher level.
+        Channel::FLAGS flags = setter;
+        if (!auth[Channel::PROTECTED] && flags[Channel::PROTECTED]) {
+            result = UNAUTHORIZED;
+            return;
+        }
+
+        if (registry->setBan(id, target, banner, date, ipBan)) {
+            result = BAN;
+        } else if (ban > 0) {
+            registry->removeBan(id, target);
+            result = UNBAN;
+        } else {
+            result = UNCHANGED;
+        }
+    }
+};
+
+} // anonymous namespace
+
 class ClientImpl : public Client, public enable_shared_from_this<ClientImpl> {
 public:
     ClientImpl(io_service &service, ServerImpl *server):
             m_authenticated(false),
             m_challenge(0),
+            m_waiting(false),
             m_lastActivity(time(NULL)),
             m_service(service),
             m_socket(service),
@@ -865,12 +1082,11 @@ public:
         m_battles.insert(battle);
     }
     void joinLadder(const string &ladder) {
-        lock_guard<mutex> lock(m_ratingMutex);
-        m_server->getRegistry()->joinLadder(ladder, m_id);
-    }
-    void updateLadderStats(const string &ladder) {
-        lock_guard<mutex> lock(m_ratingMutex);
-        m_server->getRegistry()->updatePlayerStats(ladder, m_id);
+        m_server->getDatabaseQueue()->post(
+                database::DatabaseQueue::QUERY_WRITE,
+                boost::bind(&database::DatabaseRegistry::joinLadder,
+                    m_server->getRegistry(), ladder, m_id, m_name),
+                "ladder " + ladder);
     }
     
     void informBanned(int date) {
@@ -881,9 +1097,11 @@ public:
     string *getPersonalMessage() {
         return &m_message;
     }
-    
-    void loadPersonalMessage() {
-        m_server->loadPersonalMessage(m_name, m_message);
+
+    bool isConnected() {
+        // disconnect() closes the socket under the channel mutex.
+        shared_lock<shared_mutex> lock(m_channelMutex);
+        return m_socket.is_open();
     }
 
     bool isPhantom() const {
@@ -944,6 +1162,56 @@ private:
 
     void handleReadBody(const boost::system::error_code &error);
 
+    /**
+     * Start reading the next message.
+     */
+    void readMessage() {
+        m_msg.reset();
+        async_read(m_socket, buffer(m_msg()),
+                boost::bind(&ClientImpl::handleReadHeader,
+                shared_from_this(), placeholders::error));
+    }
+
+    /**
+     * Run a query on a database thread, and then run the completion handler
+     * on a network thread. No more messages are read from this client until
+     * the query is finished, so requests are still handled in order.
+     */
+    void queryDatabase(const database::DatabaseQueue::QUERY_CLASS type,
+            const function<void ()> &query,
+            const function<void ()> &completion) {
+        m_waiting = true;
+        m_server->getDatabaseQueue()->post(type, query, m_service,
+                boost::bind(&ClientImpl::finishQuery, shared_from_this(),
+                    completion),
+                boost::bind(&ClientImpl::handleQueryFailure,
+                    shared_from_this()));
+    }
+
+    void finishQuery(const function<void ()> &completion) {
+        {
+            // Wait for the handler that started the query to return.
+            lock_guard<mutex> lock(m_readMutex);
+            if (completion) {
+                completion();
+            }
+            m_waiting = false;
+        }
+        readMessage();
+    }
+
+    void handleQueryFailure() {
+        {
+            lock_guard<mutex> lock(m_readMutex);
+            if (!m_authenticated) {
+                // Tell the client to try again later.
+                sendMessage(RegistryResponse(RegistryResponse::SERVER_FULL));
+            }
+            m_waiting = false;
+        }
+        readMessage();
+    }
+
     /**
      * Handle the completion of writing a message.
      */
@@ -970,34 +1238,37 @@ private:
      * string : user name
      */
     void handleRequestChallenge(InMessage &msg) {
-        string user;
-        msg >> user;
-        const int ban = m_server->getRegistry()->getGlobalBan(user, m_ip);
-        if (ban > 0) {
-            if (ban < time(NULL)) {
-                // ban expired remove the ban
-                m_server->getRegistry()->removeBan(-1, user);
-            } else {
-                informBanned(ban);
-                return;
-            }
+        shared_ptr<ChallengeQuery> query(new ChallengeQuery());
+        msg >> query->user;
+        query->ip = m_ip;
+        queryDatabase(database::DatabaseQueue::QUERY_AUTH,
+                boost::bind(&ChallengeQuery::run, query,
+                    m_server->getRegistry()),
+                boost::bind(&ClientImpl::finishRequestChallenge,
+                    shared_from_this(), query));
+    }
+
+    void finishRequestChallenge(shared_ptr<ChallengeQuery> query) {
+        if (query->ban > 0) {
+            informBanned(query->ban);
+            return;
         }
-        unsigned char data[16];
-        const database::DatabaseRegistry::CHALLENGE_INFO challenge =
-                m_server->getRegistry()->getAuthChallenge(user, m_ip, data);
+        const database::DatabaseRegistry::CHALLENGE_INFO &challenge =
+                query->challenge;
         m_challenge = challenge.get<0>();
         if (m_challenge != 0) {
             // user exists
 
-            if (m_server->getClient(user)) {
+            if (m_server->getClient(query->user)) {
                 // user is already online
                 sendMessage(RegistryResponse(
                         RegistryResponse::USER_ALREADY_ON));
                 return;
             }
 
-            m_name = user;
-            ChallengeMessage msg(data, challenge.get<1>(), challenge.get<2>());
+            m_name = query->user;
+            ChallengeMessage msg(query->data, challenge.get<1>(),
+                    challenge.get<2>());
             sendMessage(msg);
         } else {
             sendMessage(RegistryResponse(RegistryResponse::NONEXISTENT_NAME));
@@ -1013,14 +1284,24 @@ private:
             return;
         }
 
-        unsigned char data[16];
+        shared_ptr<ResponseQuery> query(new ResponseQuery());
         for (int i = 0; i < 16; ++i) {
-            msg >> data[i];
+            msg >> query->data[i];
         }
-        database::DatabaseRegistry *registry = m_server->getRegistry();
-        database::DatabaseRegistry::AUTH_PAIR auth =
-                registry->isResponseValid(m_name, m_ip, m_challenge, data);
+        query->name = m_name;
+        query->ip = m_ip;
+        query->challenge = m_challenge;
         m_challenge = 0;
+        queryDatabase(database::DatabaseQueue::QUERY_AUTH,
+                boost::bind(&ResponseQuery::run, query,
+                    m_server->getRegistry()),
+                boost::bind(&ClientImpl::finishChallengeResponse,
+                    shared_from_this(), query));
+    }
+
+    void finishChallengeResponse(shared_ptr<ResponseQuery> query) {
+        m_name = query->name;
+        const database::DatabaseRegistry::AUTH_PAIR &auth = query->auth;
 
         if (!auth.first) {
             sendMessage(RegistryResponse(RegistryResponse::INVALID_RESPONSE));
@@ -1035,11 +1316,10 @@ private:
         }
 
         m_id = auth.second;
+        m_message = query->message;
 
         sendMessage(RegistryResponse(RegistryResponse::SUCCESSFUL_LOGIN));
         m_server->sendMetagameList(shared_from_this());
-        m_server->getRegistry()->updateIp(m_name, m_ip);
-        loadPersonalMessage();
         m_server->sendClauseList(shared_from_this());
     }
 
@@ -1065,8 +1345,19 @@ private:
             return;
         }
 
-        database::DatabaseRegistry *registry = m_server->getRegistry();
-        if (!registry->registerUser(user, password, m_ip)) {
+        shared_ptr<RegisterQuery> query(new RegisterQuery());
+        query->user = user;
+        query->password = password;
+        query->ip = m_ip;
+        queryDatabase(database::DatabaseQueue::QUERY_AUTH,
+                boost::bind(&RegisterQuery::run, query,
+                    m_server->getRegistry()),
+                boost::bind(&ClientImpl::finishRegisterAccount,
+                    shared_from_this(), query));
+    }
+
+    void finishRegisterAccount(shared_ptr<RegisterQuery> query) {
+        if (!query->success) {
             sendMessage(RegistryResponse(RegistryResponse::NAME_UNAVAILABLE));
             return;
         }
@@ -1082,7 +1373,25 @@ private:
         msg >> channel;
         ChannelPtr p = m_server->getChannel(channel);
         if (p) {
-            joinChannel(p);
+            // Joining a channel looks up the user's flags and bans.
+            shared_ptr<JoinQuery> query(new JoinQuery());
+            query->channel = p;
+            query->client = shared_from_this();
+            queryDatabase(database::DatabaseQueue::QUERY_CHANNEL,
+                    boost::bind(&JoinQuery::run, query),
+                    boost::bind(&ClientImpl::finishJoinChannel,
+                        shared_from_this(), query));
+        }
+    }
+
+    void finishJoinChannel(shared_ptr<JoinQuery> query) {
+        if (query->ban != 0) {
+            informBanned(query->ban);
+            return;
+        }
+        if (query->channel->join(shared_from_this(), query->flags)) {
+            lock_guard<shared_mutex> lock(m_channelMutex);
+            m_channels.insert(query->channel);
         }
     }
 
@@ -1106,6 +1415,11 @@ private:
      * int32 : ban expiry
      */
     void handleBanMessage(InMessage &msg);
+
+    /**
+     * Act on the outcome of a kick or ban once its query has finished.
+     */
+    void finishBanUser(shared_ptr<BanQuery> query);
     
     //Formats a ban to output to a log
     string getBanString(const string &mod, const string &user, const int date);
@@ -1126,14 +1440,21 @@ private:
         if (!flags[Channel::OP] && !flags[Channel::PROTECTED]) {
             return;
         }
-        const string ip = m_server->getRegistry()->getIp(user);
-        if (ip.empty()) {
+        shared_ptr<UserInfoQuery> query(new UserInfoQuery());
+        query->user = user;
+        queryDatabase(database::DatabaseQueue::QUERY_ADMIN,
+                boost::bind(&UserInfoQuery::run, query,
+                    m_server->getRegistry()),
+                boost::bind(&ClientImpl::finishRequestUserInfo,
+                    shared_from_this(), query));
+    }
+
+    void finishRequestUserInfo(shared_ptr<UserInfoQuery> query) {
+        if (query->ip.empty()) {
             sendMessage(UserDetailMessage());
         } else {
-            vector<string> aliases = m_server->getRegistry()->getAliases(user);
-            database::DatabaseRegistry::BAN_LIST bans =
-                    m_server->getRegistry()->getBans(user);
-            sendMessage(UserDetailMessage(user, ip, aliases, bans));
+            sendMessage(UserDetailMessage(query->user, query->ip,
+                    query->aliases, query->bans));
         }
     }
 
@@ -1270,9 +1591,9 @@ private:
         int generation = challenge->generation;
         int metagame = challenge->metagame;
         if (metagame == -1) {
-            m_server->fetchClauses(cx, challenge->clauses, clauses);
+            m_server->fetchClauses(challenge->clauses, clauses);
         } else {
-            m_server->fetchClauses(cx, generation, metagame, clauses);
+            m_server->fetchClauses(generation, metagame, clauses);
         }
 
         set<unsigned int> bans;
@@ -1332,9 +1653,9 @@ private:
         int generationId = challenge->generation;
         int metagame = challenge->metagame;
         if (metagame == -1) {
-            m_server->fetchClauses(cx, challenge->clauses, clauses);
+            m_server->fetchClauses(challenge->clauses, clauses);
         } else {
-            m_server->fetchClauses(cx, generationId, metagame, clauses);
+            m_server->fetchClauses(generationId, metagame, clauses);
         }
 
         set<unsigned int> bans;
@@ -1552,6 +1873,56 @@ private:
         client->sendMessage(PrivateMessage(m_name, m_name, content));
     }
 
+    /**
+     * uint8  : generation
+     * uint8  : metagame
+     * uint8  : query type (see LadderStandings::QUERY)
+     * int32  : position, counting from zero (TOP), or rating (RATING)
+     * string : user (USER)
+     * uint8  : maximum number of players to return
+     *
+     * The standings are answered from memory, so this does not touch the
+     * database.
+     */
+    void handleLadderQuery(InMessage &msg) {
+        unsigned char generation, metagame, type, count;
+        int32_t value;
+        string user;
+        msg >> generation >> metagame >> type >> value >> user >> count;
+
+        const vector<GenerationPtr> &generations = m_server->getGenerations();
+        if (generation >= generations.size())
+            return;
+        const vector<MetagamePtr> &metagames =
+                generations[generation]->getMetagames();
+        if (metagame >= metagames.size())
+            return;
+        const string ladder = metagames[metagame]->getId();
+        const int limit = min(int(count), int(LadderStandings::MAX_PLAYERS));
+
+        database::DatabaseRegistry *registry = m_server->getRegistry();
+        database::DatabaseRegistry::STANDING_LIST standings;
+        int players;
+        switch (type) {
+            case LadderStandings::TOP:
+                players = registry->getStandings(ladder, max(0, int(value)),
+                        limit, standings);
+                break;
+            case LadderStandings::USER:
+                players = registry->getStandingsAround(ladder, user, limit,
+                        standings);
+                break;
+            case LadderStandings::RATING:
+                players = registry->getStandingsNear(ladder, value, limit,
+                        standings);
+                break;
+            default:
+                return;
+        }
+        sendMessage(LadderStandings(generation, metagame, type, players,
+                standings));
+    }
+
     /**
      * int32  : channel (-1 for global)
      * string : the message to display
@@ -1587,10 +1958,32 @@ private:
         channel->writeLog(logMessage);
     }
 
+    /**
+     * (no body)
+     *
+     * Close the current rating period of every ladder now, rather than
+     * waiting for it to end. Only +a users on the main channel may do this.
+     */
+    void handleCloseRatingPeriods(InMessage &) {
+        ChannelPtr main = m_server->getMainChannel();
+        Channel::FLAGS flags = main->getStatusFlags(shared_from_this());
+        if (!flags[Channel::PROTECTED]) {
+            sendMessage(ErrorMessage(ErrorMessage::UNAUTHORIZED_ACTION));
+            return;
+        }
+        queryDatabase(database::DatabaseQueue::QUERY_ADMIN,
+                boost::bind(&database::DatabaseRegistry::closeRatingPeriods,
+                    m_server->getRegistry()),
+                boost::bind(&Channel::writeLog, main,
+                    "[rating periods] closed by " + m_name));
+    }
+
     string m_name;
     int m_id;   // user id
     bool m_authenticated;
     int m_challenge; // for challenge-response authentication
+    bool m_waiting;  // for a database query before reading more messages
+    mutex m_readMutex;  // held while a message is being handled
     string m_message;
     int m_lastActivity;
 
@@ -1609,7 +2002,6 @@ private:
     ServerImpl *m_server;
     CHANNEL_LIST m_channels;    // channels this user is in
     shared_mutex m_channelMutex;
-    mutex m_ratingMutex;
 
     typedef void (ClientImpl::*MESSAGE_HANDLER)(InMessage &msg);
     static const MESSAGE_HANDLER m_handlers[];
@@ -1639,7 +2031,9 @@ const ClientImpl::MESSAGE_HANDLER ClientImpl::m_handlers[] = {
     &ClientImpl::handleCancelQueue,
     &ClientImpl::handleCancelBattleAction,
     &ClientImpl::handlePrivateMessage,
-    &ClientImpl::handleImportantMessage
+    &ClientImpl::handleImportantMessage,
+    &ClientImpl::handleLadderQuery,
+    &ClientImpl::handleCloseRatingPeriods
 };
 
 const int ClientImpl::MESSAGE_COUNT =
@@ -1666,6 +2060,7 @@ void ClientImpl::handleReadBody(const boost::system::error_code &error) {
         return;
     }
     if (type < MESSAGE_COUNT) {
+        lock_guard<mutex> lock(m_readMutex);
         try {
             // Call the handler for this type of message.
             (this->*m_handlers[type])(m_msg);
@@ -1675,13 +2070,12 @@ void ClientImpl::handleReadBody(const boost::system::error_code &error) {
             m_server->removeClient(shared_from_this());
             return;
         }
+        if (m_waiting)
+            return;
     }
 
     // Read another message.
-    m_msg.reset();
-    async_read(m_socket, buffer(m_msg()),
-            boost::bind(&ClientImpl::handleReadHeader,
-            shared_from_this(), placeholders::error));
+    readMessage();
 }
 
 void ClientImpl::joinChannel(ChannelPtr channel) {
@@ -1776,59 +2170,55 @@ void ClientImpl::handleBanMessage(InMessage &msg) {
         return;
     }
 
-    database::DatabaseRegistry *registry = m_server->getRegistry();
-
-    // Escape if the target doesn't exist.
-    if (!registry->userExists(target)) {
-        sendMessage(ErrorMessage(ErrorMessage::NONEXISTENT_USER, target));
-        return;
-    }
-
-    Channel::FLAGS auth = channel->getStatusFlags(shared_from_this());
-    Channel::FLAGS uauth = channel->getUserFlags(target);
+    shared_ptr<BanQuery> query(new BanQuery());
+    query->channel = channel;
+    query->auth = channel->getStatusFlags(shared_from_this());
+    query->id = id;
+    query->banner = m_id;
+    query->target = target;
+    query->date = date;
+    query->ipBan = ipBan;
+    queryDatabase(database::DatabaseQueue::QUERY_ADMIN,
+            boost::bind(&BanQuery::run, query, m_server->getRegistry()),
+            boost::bind(&ClientImpl::finishBanUser, shared_from_this(),
+                query));
+}
+
+void ClientImpl::finishBanUser(shared_ptr<BanQuery> query) {
+    const int id = query->id;
+    const string &target = query->target;
+    const int date = query->date;
+    ChannelPtr channel = query->channel;
     ClientImplPtr client = m_server->getClient(target);
-    if (!auth[Channel::OP] || uauth[Channel::PROTECTED]
-            || (!auth[Channel::PROTECTED] && uauth[Channel::OP])) {
-        // You don't have the authority to do anything to this user
-        sendMessage(ErrorMessage(ErrorMessage::UNAUTHORIZED_ACTION));
-        return;
-    }
+    string msg;
+    switch (query->result) {
+        case BanQuery::NONEXISTENT_USER:
+            sendMessage(ErrorMessage(ErrorMessage::NONEXISTENT_USER, target));
+            break;
 
-    if (date == 0) {
-        //0 date means kick
-        if (client && ((id == -1) || client->getChannel(id))) {
-            kickUser(m_server, channel, m_name, client, date, id);
-        } else if (!client) {
-            // The user isn't online, so inform the kicker.
-            sendMessage(ErrorMessage(ErrorMessage::USER_NOT_ONLINE, target));
-        }
-    } else {
-        int ban;
-        int setter;
-        
-        if (id == -1) {
-            registry->getBan(-1, target, ban, setter);
-        } else {
-            channel->getBan(target, ban, setter);
-        }
-        
-        // Can't change ban made by user with a higher level.
-        Channel::FLAGS flags = setter;
-        if (!auth[Channel::PROTECTED] && flags[Channel::PROTECTED]) {
+        case BanQuery::UNAUTHORIZED:
             sendMessage(ErrorMessage(ErrorMessage::UNAUTHORIZED_ACTION));
-            return;
-        }
+            break;
 
-        string msg;
-        const bool banned = m_server->commitBan(id, target, m_id, date, ipBan);
-        if (!banned && (ban > 0)) {
-            registry->removeBan(id, target);
+        case BanQuery::KICK:
+            if (client && ((id == -1) || client->getChannel(id))) {
+                kickUser(m_server, channel, m_name, client, date, id);
+            } else if (!client) {
+                // The user isn't online, so inform the kicker.
+                sendMessage(ErrorMessage(ErrorMessage::USER_NOT_ONLINE,
+                        target));
+            }
+            break;
+
+        case BanQuery::UNBAN:
             msg = (id == -1) ? "[unban global] " : "[unban] ";
             msg += m_name + " -> " + target;
-            
+
             // Inform the invoker that the user was unbanned.
             sendMessage(KickBanMessage(channel->getId(), m_name, target, -1));
-        } else if (banned) {
+            break;
+
+        case BanQuery::BAN:
             msg = (id == -1) ? "[ban global] " : "[ban] ";
             msg += getBanString(m_name, target, date);
 
@@ -1838,10 +2228,13 @@ void ClientImpl::handleBanMessage(InMessage &msg) {
             } else {
                 sendMessage(KickBanMessage(id, m_name, target, date));
             }
-        }
-        if (!msg.empty()) {
-            channel->writeLog(msg);
-        }
+            break;
+
+        case BanQuery::UNCHANGED:
+            break;
+    }
+    if (!msg.empty()) {
+        channel->writeLog(msg);
     }
 }
 
@@ -1881,11 +2274,10 @@ void ClientImpl::disconnect() {
 }
 
 void ServerImpl::commitPersonalMessage(const string &user, const string &msg) {
-    m_registry.setPersonalMessage(user, msg);
-}
-
-void ServerImpl::loadPersonalMessage(const string &user, string &message) {
-    m_registry.loadPersonalMessage(user, message);
+    m_queries.post(database::DatabaseQueue::QUERY_WRITE,
+            boost::bind(&database::DatabaseRegistry::setPersonalMessage,
+                &m_registry, user, msg),
+            "user " + user);
 }
 
 bool ServerImpl::commitBan(const int channel, const string &user,
@@ -1899,9 +2291,10 @@ void ServerImpl::postLadderMatch(const string &ladder,
     ClientImpl *impl1 = dynamic_cast<ClientImpl *>(clients[1].get());
     if (!impl0 || !impl1)
         return;
-    m_registry.postLadderMatch(ladder, impl0->getId(), impl1->getId(), victor);
-    impl0->updateLadderStats(ladder);
-    impl1->updateLadderStats(ladder);
+    m_queries.post(database::DatabaseQueue::QUERY_WRITE,
+            boost::bind(&database::DatabaseRegistry::postLadderMatch,
+                &m_registry, ladder, impl0->getId(), impl1->getId(), victor),
+            "ladder " + ladder);
 }
 
 MetagamePtr MetagameQueue::getMetagame() {
@@ -1912,7 +2305,7 @@ MetagamePtr MetagameQueue::getMetagame() {
 
 bool MetagameQueue::queueClient(ClientImplPtr client, Pokemon::ARRAY &team) {
     lock_guard<mutex> lock(m_mutex);
-    if (m_clients.find(client) != m_clients.end())
+    if (m_tokens.find(client) != m_tokens.end())
         return false;
 
     MetagamePtr metagame = getMetagame();
@@ -1925,7 +2318,7 @@ bool MetagameQueue::queueClient(ClientImplPtr client, Pokemon::ARRAY &team) {
     // created - ScriptContextLock is necessary!!
     ScriptContextLock cxLock(scx);
     vector<StatusObject> clauses;
-    m_server->fetchClauses(scx, metagame, clauses);
+    m_server->fetchClauses(m_generation, m_metagame, clauses);
     vector<int> violations;
     if (!m_server->validateTeam(scx, team, clauses, violations,
             metagame->getBanList())) {
@@ -1935,51 +2328,99 @@ bool MetagameQueue::queueClient(ClientImplPtr client, Pokemon::ARRAY &team) {
     if (m_rated) {
         client->joinLadder(metagame->getId());
     }
-    m_clients.insert(client);
-    m_queue.push_back(QUEUE_ENTRY(client, team));
+    const QUEUE_ENTRY entry = { client, team, m_nextToken++ };
+    m_tokens[client] = entry.token;
+    m_queue.push_back(entry);
     return true;
 }
 
 void MetagameQueue::removeClient(ClientImplPtr client) {
     lock_guard<mutex> lock(m_mutex);
-    m_clients.erase(client);
+    m_tokens.erase(client);
     vector<QUEUE_ENTRY>::iterator i = m_queue.begin();
     for (; i != m_queue.end(); ++i) {
-        if (i->first->getId() == client->getId()) {
+        if (i->client->getId() == client->getId()) {
             m_queue.erase(i);
             break;
         }
     }
 }
 
+/**
+ * Take a client which has been taken off the queue for a match out of the
+ * queue for good. This fails if the client has since left the queue (even if
+ * it has queued again, which gives it a new token) or disconnected. The queue
+ * mutex must be held.
+ */
+bool MetagameQueue::claim(const QUEUE_ENTRY &entry) {
+    TOKEN_MAP::iterator i = m_tokens.find(entry.client);
+    if ((i == m_tokens.end()) || (i->second != entry.token))
+        return false;
+    m_tokens.erase(i);
+    return entry.client->isConnected();
+}
+
 void MetagameQueue::startMatches() {
-    lock_guard<mutex> lock(m_mutex);
-    if (m_queue.size() < 2)
-        return;
-    if (m_rated) {
-        // TODO: Sort the list of clients by rating.
-    } else {
-        GENERATOR generator(m_rand, uniform_int<>());
-        random_shuffle(m_queue.begin(), m_queue.end(), generator);
+    vector<QUEUE_ENTRY> matches;
+    {
+        lock_guard<mutex> lock(m_mutex);
+        if (m_queue.size() < 2)
+            return;
+        if (m_rated) {
+            // TODO: Sort the list of clients by rating.
+        } else {
+            GENERATOR generator(m_rand, uniform_int<>());
+            random_shuffle(m_queue.begin(), m_queue.end(), generator);
+        }
+
+        // TODO: Use the generations map to prevent rematches.
+        // The matched clients keep their tokens until they are claimed
+        // below, so that removeClient() can still withdraw them.
+        matches.swap(m_queue);
+        if (matches.size() % 2) {
+            m_queue.push_back(matches.back());
+            matches.pop_back();
+        }
+
+        // Claim both sides of every pairing. Once a client is claimed it is
+        // committed to the battle; leaving after this point is a forfeit
+        // rather than a withdrawal.
+        vector<QUEUE_ENTRY> claimed;
+        const int size = matches.size();
+        for (int i = 0; i < size; i += 2) {
+            QUEUE_ENTRY &q1 = matches[i];
+            QUEUE_ENTRY &q2 = matches[i + 1];
+            const bool waiting1 = claim(q1);
+            const bool waiting2 = claim(q2);
+            if (waiting1 && waiting2) {
+                claimed.push_back(q1);
+                claimed.push_back(q2);
+                continue;
+            }
+            // Drop the pairing and requeue whichever client is left.
+            if (waiting1) {
+                m_tokens[q1.client] = q1.token;
+                m_queue.push_back(q1);
+            }
+            if (waiting2) {
+                m_tokens[q2.client] = q2.token;
+                m_queue.push_back(q2);
+            }
+        }
+        matches.swap(claimed);
     }
 
-    // TODO: Use the generations map to prevent rematches.
+    // The battles are built without the queue mutex, so that queueing and
+    // leaving are not held up by battle construction.
     MetagamePtr metagame = getMetagame();
-    QUEUE_ENTRY remainder;
-    int size = m_queue.size();
-    const bool hasRemainder = size % 2;
-    if (hasRemainder) {
-        --size;
-        remainder = m_queue.back();
-    }
+    vector<StatusObject> clauses;
+    m_server->fetchClauses(m_generation, m_metagame, clauses);
+    const int size = matches.size();
     for (int i = 0; i < size; i += 2) {
-        QUEUE_ENTRY &q1 = m_queue[i];
-        QUEUE_ENTRY &q2 = m_queue[i + 1];
-        ClientPtr clients[] = { q1.first, q2.first };
-        Pokemon::ARRAY teams[] = { q1.second, q2.second };
-        vector<StatusObject> clauses;
-        m_server->fetchClauses(m_server->getMachine()->acquireContext(),
-                metagame, clauses);
+        QUEUE_ENTRY &q1 = matches[i];
+        QUEUE_ENTRY &q2 = matches[i + 1];
+        ClientPtr clients[] = { q1.client, q2.client };
+        Pokemon::ARRAY teams[] = { q1.team, q2.team };
         shared_ptr<void> monitor;
         NetworkBattle::PTR field(new NetworkBattle(
                 m_server->getServer(),
@@ -1994,16 +2435,10 @@ void MetagameQueue::startMatches() {
                 m_rated,
                 monitor));
         field->beginBattle();
-        q1.first->insertBattle(field);
-        q2.first->insertBattle(field);
+        q1.client->insertBattle(field);
+        q2.client->insertBattle(field);
         // monitor goes out of scope here.
     }
-    m_clients.clear();
-    m_queue.clear();
-    if (hasRemainder) {
-        m_queue.push_back(remainder);
-        m_clients.insert(remainder.first);
-    }
 }
 
 void ServerImpl::sendChannelList(ClientImplPtr client) {
@@ -2018,35 +2453,27 @@ void ServerImpl::sendClauseList(ClientImplPtr client) {
     client->sendMessage(ClauseList(m_clauses));
 }
 
-void ServerImpl::fetchClauses(ScriptContextPtr scx, vector<int> &clauses, 
-                                                vector<StatusObject> &ret) {
-    vector<int>::iterator i = clauses.begin();
-    int size = m_clauses.size();
+void ServerImpl::fetchClauses(const vector<int> &clauses,
+        vector<StatusObject> &ret) const {
+    vector<int>::const_iterator i = clauses.begin();
+    const int size = m_clauseObjects.size();
     for (; i != clauses.end(); ++i) {
-        int idx = (*i);
-        if ((idx < 0) || (idx > size))
+        const int idx = *i;
+        if ((idx < 0) || (idx >= size))
             continue;
-        string name = m_clauses[idx].first;
-        ret.push_back(scx->getClause(name));
+        ret.push_back(m_clauseObjects[idx]);
     }
 }
 
-void ServerImpl::fetchClauses(ScriptContextPtr scx, MetagamePtr metagame,
-        vector<StatusObject> &ret) {
-    const vector<string> &clauses = metagame->getClauses();
-    vector<string>::const_iterator i = clauses.begin();
-    for (; i != clauses.end(); ++i) {
-        ret.push_back(scx->getClause(*i));
+void ServerImpl::fetchClauses(const int generation, const int metagame,
+        vector<StatusObject> &ret) const {
+    map<METAGAME, vector<StatusObject> >::const_iterator i =
+            m_metagameClauses.find(METAGAME(generation, metagame));
+    if (i != m_metagameClauses.end()) {
+        ret.insert(ret.end(), i->second.begin(), i->second.end());
     }
 }
 
-void ServerImpl::fetchClauses(ScriptContextPtr scx, const int generation,
-        const int metagame, vector<StatusObject> &ret) {
-    GenerationPtr gen = m_generations[generation];
-    MetagamePtr meta = gen->getMetagames()[metagame];
-    fetchClauses(scx, meta, ret);
-}
-
 void ServerImpl::addChannel(ChannelPtr p) {
     lock_guard<shared_mutex> lock(m_channelMutex);
     m_channels.insert(p);
@@ -2146,7 +2573,14 @@ ServerImpl::ServerImpl(Server *server, const int port, const int userLimit):
             m_population(0),
             m_userLimit(userLimit),
             m_acceptor(m_service, tcp::endpoint(tcp::v4(), port), true),
+            m_queries(4, 1024),
+            m_teamCache(4096),
             m_server(server) {
+    // Writes are only posted without handlers, and so never time out.
+    m_queries.setTimeout(database::DatabaseQueue::QUERY_AUTH, 15000);
+    m_queries.setTimeout(database::DatabaseQueue::QUERY_CHANNEL, 15000);
+    m_queries.setTimeout(database::DatabaseQueue::QUERY_ADMIN, 30000);
+    m_queries.setTimeout(database::DatabaseQueue::QUERY_WRITE, 0);
     acceptClient();
     m_phantomClientWorker = boost::thread(boost::bind(
             &ServerImpl::handlePhantomClients, this));
@@ -2249,14 +2683,56 @@ void ServerImpl::initialiseChannels() {
     assert(m_mainChannel);
 }
 
+namespace {
+
+/**
+ * The first error from the threads started by initialiseMatchmaking(), which
+ * is rethrown once they have all finished, because an exception must not
+ * leave a thread function.
+ */
+struct LadderError {
+    mutex lock;
+    bool failed;
+    string message;
+
+    LadderError(): failed(false) { }
+
+    void set(const string &msg) {
+        lock_guard<mutex> guard(lock);
+        if (!failed) {
+            failed = true;
+            message = msg;
+        }
+    }
+};
+
+void initialiseLadder(database::DatabaseRegistry *registry,
+        const string id, LadderError *error) {
+    try {
+        database::DatabaseRegistry::startThread();
+        registry->initialiseLadder(id);
+    } catch (std::exception &e) {
+        error->set("ladder " + id + ": " + e.what());
+    } catch (...) {
+        error->set("ladder " + id + ": unknown exception");
+    }
+}
+
+} // anonymous namespace
+
 void ServerImpl::initialiseMatchmaking() {
+    // Each ladder is checked (and created if necessary) with its own
+    // queries, so they are all done at once.
+    thread_group ladders;
+    LadderError error;
     vector<GenerationPtr>::const_iterator i = m_generations.begin();
     for (; i != m_generations.end(); ++i) {
         GenerationPtr generation = *i;
         const vector<MetagamePtr> &metagames = generation->getMetagames();
         vector<MetagamePtr>::const_iterator j = metagames.begin();
         for (; j != metagames.end(); ++j) {
-            m_registry.initialiseLadder((*j)->getId());
+            ladders.create_thread(boost::bind(initialiseLadder, &m_registry,
+                    (*j)->getId(), &error));
 
             int genIdx = generation->getIdx();
             int metaIdx = (*j)->getIdx();
@@ -2270,25 +2746,82 @@ void ServerImpl::initialiseMatchmaking() {
         }
     }
 
+    ladders.join_all();
+    if (error.failed) {
+        throw runtime_error(error.message);
+    }
+
     m_metagameList = shared_ptr<MetagameList>(new MetagameList(m_generations));
     m_matchmaking = thread(boost::bind(&ServerImpl::handleMatchmaking, this));
 }
 
+/**
+ * Close the rating period of every ladder at a fixed interval, counted by the
+ * wall clock from the start of each period as recorded in the database. If
+ * the interval is zero, periods are only closed on demand.
+ */
+void ServerImpl::initialiseRatingPeriods(const int hours) {
+    if (hours <= 0)
+        return;
+    m_ratingPeriods = thread(boost::bind(&ServerImpl::handleRatingPeriods,
+            this, hours));
+}
+
 void ServerImpl::initialiseClauses() {
     ScriptContextPtr scx = m_machine.acquireContext();
     ScriptContextLock lock(scx);
     vector<StatusObject> clauses;
     scx->getClauseList(clauses);
+    m_teamCache.clear();
+    map<string, int> indices;
     vector<StatusObject>::iterator i = clauses.begin();
     for (; i != clauses.end(); ++i) {
-        m_clauses.push_back(
-            CLAUSE_PAIR(i->getId(scx.get()), i->getDescription(scx.get())));
+        const string id = i->getId(scx.get());
+        indices[id] = m_clauses.size();
+        m_clauses.push_back(CLAUSE_PAIR(id, i->getDescription(scx.get())));
+        m_clauseObjects.push_back(*i);
+        m_clauseRoots.push_back(scx->addRoot(new StatusObject(*i)));
+    }
+
+    // Resolve the clauses of every metagame now, so that creating a battle
+    // or validating a team does not have to look them up in the scripts.
+    vector<GenerationPtr>::const_iterator j = m_generations.begin();
+    for (; j != m_generations.end(); ++j) {
+        const vector<MetagamePtr> &metagames = (*j)->getMetagames();
+        vector<MetagamePtr>::const_iterator k = metagames.begin();
+        for (; k != metagames.end(); ++k) {
+            vector<StatusObject> &objects = m_metagameClauses[
+                    METAGAME((*j)->getIdx(), (*k)->getIdx())];
+            const vector<string> &names = (*k)->getClauses();
+            vector<string>::const_iterator l = names.begin();
+            for (; l != names.end(); ++l) {
+                map<string, int>::const_iterator idx = indices.find(*l);
+                if (idx != indices.end()) {
+                    objects.push_back(m_clauseObjects[idx->second]);
+                    continue;
+                }
+                // A clause which is not in the clause list still has to be
+                // rooted like the others, since it outlives this context.
+                StatusObject clause = scx->getClause(*l);
+                if (clause.isNull()) {
+                    Log::out() << "Unknown clause \"" << *l << "\" in "
+                            << (*k)->getName() << "." << endl;
+                    continue;
+                }
+                objects.push_back(clause);
+                m_clauseRoots.push_back(scx->addRoot(new StatusObject(clause)));
+            }
+        }
     }
 }
 
 bool ServerImpl::validateTeam(ScriptContextPtr scx, Pokemon::ARRAY &team,
         vector<StatusObject> &clauses, vector<int> &violations,
         const set<unsigned int> &bans) {
+    const string key = TeamCache::getKey(clauses, bans, team);
+    if (m_teamCache.find(key, team, violations))
+        return violations.empty();
+
     Pokemon::ARRAY::iterator i = team.begin();
     for (; i != team.end(); ++i) {
         (*i)->initialise(NULL, scx, 0, 0);
@@ -2302,8 +2835,10 @@ bool ServerImpl::validateTeam(ScriptContextPtr scx, Pokemon::ARRAY &team,
             violations.push_back(clauses[i].getIdx(cx));
         }
     }
-    if (!pass)
+    if (!pass) {
+        m_teamCache.insert(key, team, violations);
         return false;
+    }
         
     for (int i = 0; i < size; ++i) {
         clauses[i].transformTeam(cx, team);
@@ -2334,7 +2869,8 @@ bool ServerImpl::validateTeam(ScriptContextPtr scx, Pokemon::ARRAY &team,
             violations.push_back(-i - 1 - (partySize * 8));
         }
     }
-    
+
+    m_teamCache.insert(key, team, violations);
     return !violations.size();
 }
 
@@ -2362,6 +2898,34 @@ void ServerImpl::handlePhantomClients() {
         lock.unlock();
         for_each(phantoms.begin(), phantoms.end(),
                 boost::bind(&ServerImpl::removeClient, this, _1));
+        // This is as good a place as any to report on the database.
+        m_queries.report();
+        m_registry.expireSessions();
+    }
+}
+
+void ServerImpl::handleRatingPeriods(const int hours) {
+    // How long to wait before trying again if the database fails.
+    const int RETRY_SECONDS = 60;
+
+    database::DatabaseRegistry::startThread();
+    const int length = hours * 3600;
+    while (true) {
+        // The first pass catches up on any periods that ended while the
+        // server was not running.
+        time_t next;
+        try {
+            const int closed = m_registry.closeDueRatingPeriods(length, next);
+            if (closed != 0) {
+                Log::out() << "Closed " << closed
+                        << " ladder rating periods." << endl;
+            }
+        } catch (std::exception &e) {
+            Log::out() << "Failed to close the ladder rating periods: "
+                    << e.what() << endl;
+            next = time(NULL) + RETRY_SECONDS;
+        }
+        this_thread::sleep(posix_time::from_time_t(next));
     }
 }
 
@@ -35,6 +35,7 @@ namespace shoddybattle {
 
 namespace shoddybattle { namespace database {
     class DatabaseRegistry;
+    class DatabaseQueue;
 }} // namespace shoddybattle::database
 
 namespace shoddybattle { namespace network {
@@ -73,6 +74,7 @@ public:
     void installSignalHandlers();
     void run();
     database::DatabaseRegistry *getRegistry();
+    database::DatabaseQueue *getDatabaseQueue();
     ScriptMachine *getMachine();
     void readMetagames(const std::string &);
     void initialiseMetagames();
@@ -80,6 +82,7 @@ public:
     void initialiseChannels();
     void initialiseMatchmaking();
     void initialiseClauses();
+    void initialiseRatingPeriods(const int hours);
     boost::shared_ptr<Channel> getMainChannel() const;
     void addChannel(boost::shared_ptr<Channel>);
     void removeChannel(boost::shared_ptr<Channel>);
@@ -143,7 +146,8 @@ public:
         INVALID_TEAM = 32,
         ERROR_MESSAGE = 33,
         PRIVATE_MESSAGE = 34,
-        IMPORTANT_MESSAGE = 35
+        IMPORTANT_MESSAGE = 35,
+        LADDER_STANDINGS = 36
     };
 
     // variable size message
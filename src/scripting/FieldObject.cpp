@@ -60,7 +60,8 @@ enum FIELD_TINYID {
     FTI_NARRATION,
     FTI_HOST,
     FTI_EXECUTION,
-    FTI_EXECUTION_USER
+    FTI_EXECUTION_USER,
+    FTI_QUERY
 };
 
 /**
@@ -226,16 +227,15 @@ JSBool getMove(JSContext *cx,
     BattleField *p = (BattleField *)JS_GetPrivate(cx, obj);
     MoveDatabase *moves = p->getScriptMachine()->getMoveDatabase();
 
-    string str;
+    const MoveTemplate *tpl;
     if (JSVAL_IS_STRING(v)) {
-        str = JS_GetStringBytes(JSVAL_TO_STRING(v));
+        tpl = moves->getMove(JS_GetStringBytes(JSVAL_TO_STRING(v)));
     } else if (JSVAL_IS_INT(v)) {
-        str = moves->getMove(JSVAL_TO_INT(v));
+        tpl = moves->getMoveById(JSVAL_TO_INT(v));
     } else {
         return JS_FALSE;
     }
 
-    const MoveTemplate *tpl = moves->getMove(str);
     if (tpl) {
         MoveObjectPtr move = scx->newMoveObject(tpl);
         *ret = OBJECT_TO_JSVAL((JSObject *)move->getObject());
@@ -623,6 +623,9 @@ JSBool fieldGet(JSContext *cx, JSObject *obj, jsval id, jsval *vp) {
                 *vp = JSVAL_NULL;
             }
         } break;
+        case FTI_QUERY: {
+            *vp = BOOLEAN_TO_JSVAL(p->isQuery());
+        } break;
     }
     return JS_TRUE;
 }
@@ -637,6 +640,7 @@ JSPropertySpec fieldProperties[] = {
     { "host", FTI_HOST, JSPROP_PERMANENT | JSPROP_SHARED, fieldGet, NULL },
     { "execution", FTI_EXECUTION, JSPROP_PERMANENT | JSPROP_SHARED, fieldGet, NULL },
     { "executionUser", FTI_EXECUTION_USER, JSPROP_PERMANENT | JSPROP_SHARED, fieldGet, NULL },
+    { "query", FTI_QUERY, JSPROP_PERMANENT | JSPROP_SHARED, fieldGet, NULL },
     { 0, 0, 0, 0, 0 }
 };
 
@@ -292,9 +292,9 @@ static JSBool getText(JSContext *cx,
         args[i] = pstr;
     }
     ScriptContext *scx = (ScriptContext *)JS_GetContextPrivate(cx);
-    string sret = scx->getMachine()->getText(category, text, count, args);
-    char *pstr = JS_strdup(cx, sret.c_str());
-    JSString *str = JS_NewString(cx, pstr, sret.length());
+    string sret;
+    scx->getMachine()->getText(category, text, count, args, sret);
+    JSString *str = JS_NewStringCopyN(cx, sret.data(), sret.length());
     *ret = STRING_TO_JSVAL(str);
     return JS_TRUE;
 }
@@ -303,6 +303,11 @@ string ScriptMachine::getText(int i, int j, int argc, const char **argv) {
     return m_impl->state->text.getText(i, j, argc, argv);
 }
 
+void ScriptMachine::getText(int i, int j, int argc, const char **argv,
+        string &out) {
+    m_impl->state->text.getText(i, j, argc, argv, out);
+}
+
 static JSBool loadText(JSContext *cx,
         JSObject * /*obj*/, uintN /*argc*/, jsval *argv, jsval *) {
     jsval v = argv[0];
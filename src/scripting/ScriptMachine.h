@@ -142,7 +142,7 @@ public:
 
 struct MODIFIER {
     int position;
-    double value;
+    Fraction value;
     int priority;
 };
 
@@ -391,6 +391,8 @@ public:
     MoveDatabase *getMoveDatabase() const;
 
     std::string getText(int i, int j, int argc, const char **argv);
+    void getText(int i, int j, int argc, const char **argv,
+            std::string &out);
     void loadText(const std::string file, TextLookup &func);
     void includeMoves(const std::string);
     void includeSpecies(const std::string);
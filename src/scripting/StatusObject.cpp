@@ -55,7 +55,7 @@ bool StatusObject::getModifier(ScriptContext *scx, BattleField *field,
         if (!arr.isNull()) {
             b = true;
             mod.position = arr[0].getInt();
-            mod.value = arr[1].getDouble(scx);
+            mod.value = toFraction(arr[1].getDouble(scx));
             mod.priority = arr[2].getInt();
         }
     }
@@ -79,7 +79,7 @@ bool StatusObject::getStatModifier(ScriptContext *scx, BattleField *field,
         if (!arr.isNull()) {
             b = true;
             mod.position = -1;  // unused here
-            mod.value = arr[0].getDouble(scx);
+            mod.value = toFraction(arr[0].getDouble(scx));
             mod.priority = arr[1].getInt();
         }
     }
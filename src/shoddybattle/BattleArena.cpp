@@ -0,0 +1,157 @@
+/*
+ * File:   BattleArena.cpp
+ * Author: Catherine
+ *
+ * Created on October 19, 2026, 7:30 PM
+ *
+ * This file is a part of Shoddy Battle.
+ * Copyright (C) 2009  Catherine Fitzpatrick and Benjamin Gwin
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program; if not, visit the Free Software Foundation, Inc.
+ * online at http://gnu.org.
+ */
+
+#include "BattleArena.h"
+
+using namespace std;
+
+namespace shoddybattle {
+
+BattleArena::BattleArena():
+        m_chunks(NULL),
+        m_top(NULL),
+        m_end(NULL),
+        m_reserved(0) {
+    for (int i = 0; i < CLASS_COUNT; ++i) {
+        m_free[i] = NULL;
+    }
+}
+
+BattleArena::~BattleArena() {
+    while (m_chunks) {
+        Chunk *next = m_chunks->next;
+        ::operator delete(m_chunks);
+        m_chunks = next;
+    }
+}
+
+/**
+ * Get the free list for blocks of a given size, or -1 if the block is too
+ * large to come from the arena.
+ */
+int BattleArena::getSizeClass(const size_t size) {
+    if (size > MAX_BLOCK)
+        return -1;
+    int c = 0;
+    size_t block = MIN_BLOCK;
+    while (block < size) {
+        block <<= 1;
+        ++c;
+    }
+    return c;
+}
+
+void *BattleArena::allocate(const size_t size) {
+    const int c = getSizeClass(size);
+    if (c == -1) {
+        m_reserved += size;
+        return ::operator new(size);
+    }
+    FreeBlock *block = m_free[c];
+    if (block) {
+        m_free[c] = block->next;
+        return block;
+    }
+    const size_t bytes = size_t(MIN_BLOCK) << c;
+    if (m_top + bytes > m_end) {
+        // The rest of the current chunk is abandoned; it is at most one
+        // block of the largest class.
+        const size_t header = (sizeof(Chunk) + MIN_BLOCK - 1)
+                & ~size_t(MIN_BLOCK - 1);
+        Chunk *chunk = static_cast<Chunk *>(
+                ::operator new(header + CHUNK_SIZE));
+        chunk->next = m_chunks;
+        m_chunks = chunk;
+        m_top = reinterpret_cast<char *>(chunk) + header;
+        m_end = m_top + CHUNK_SIZE;
+        m_reserved += header + CHUNK_SIZE;
+    }
+    void *ret = m_top;
+    m_top += bytes;
+    return ret;
+}
+
+void BattleArena::deallocate(void *p, const size_t size) {
+    if (!p)
+        return;
+    const int c = getSizeClass(size);
+    if (c == -1) {
+        m_reserved -= size;
+        ::operator delete(p);
+        return;
+    }
+    FreeBlock *block = static_cast<FreeBlock *>(p);
+    block->next = m_free[c];
+    m_free[c] = block;
+}
+
+}
+
+#if 0
+
+#include <iostream>
+#include <vector>
+#include <map>
+#include <boost/date_time/posix_time/posix_time.hpp>
+
+using namespace shoddybattle;
+using namespace boost::posix_time;
+
+/**
+ * Compare the cost of the scratch containers built during a turn on the
+ * global heap and in an arena.
+ */
+template <class Alloc>
+void runTurns(const Alloc &alloc, const int turns) {
+    typedef std::pair<const std::pair<int, int>, bool> ENTRY;
+    typedef typename Alloc::template rebind<ENTRY>::other MAP_ALLOC;
+    typedef std::less<std::pair<int, int> > LESS;
+    for (int i = 0; i < turns; ++i) {
+        std::vector<int, Alloc> effects(alloc);
+        for (int j = 0; j < 24; ++j) {
+            effects.push_back(j);
+        }
+        const LESS less = LESS();
+        std::map<std::pair<int, int>, bool, LESS, MAP_ALLOC>
+                random(less, MAP_ALLOC(alloc));
+        for (int j = 0; j < 6; ++j) {
+            random[std::make_pair(j, j + 1)] = (j & 1);
+        }
+    }
+}
+
+int main() {
+    const int TURNS = 1000000;
+    ptime start = microsec_clock::universal_time();
+    runTurns(std::allocator<int>(), TURNS);
+    ptime mid = microsec_clock::universal_time();
+    BattleArena arena;
+    runTurns(ArenaAllocator<int>(&arena), TURNS);
+    ptime end = microsec_clock::universal_time();
+    std::cout << "heap:  " << (mid - start) << std::endl;
+    std::cout << "arena: " << (end - mid) << std::endl;
+    std::cout << "reserved: " << arena.getReserved() << std::endl;
+}
+
+#endif
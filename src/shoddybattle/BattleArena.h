@@ -0,0 +1,164 @@
+/*
+ * File:   BattleArena.h
+ * Author: Catherine
+ *
+ * Created on October 19, 2026, 7:30 PM
+ *
+ * This file is a part of Shoddy Battle.
+ * Copyright (C) 2009  Catherine Fitzpatrick and Benjamin Gwin
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program; if not, visit the Free Software Foundation, Inc.
+ * online at http://gnu.org.
+ */
+
+#ifndef _BATTLE_ARENA_H_
+#define _BATTLE_ARENA_H_
+
+#include <cstddef>
+#include <new>
+#include <boost/utility.hpp>
+
+namespace shoddybattle {
+
+/**
+ * Memory owned by a single battle. Blocks are carved out of large chunks and
+ * returned to per-size free lists when they are released, so a battle thread
+ * never contends with other battles for the global heap. All of the chunks
+ * are freed together when the arena is destroyed.
+ *
+ * A BattleArena is not thread safe: it must only be used by the thread that
+ * is running the battle (or by a thread holding the battle's lock).
+ *
+ * Only the battle's scratch data comes from its arena: the active parties,
+ * the turn order and coin flip maps built by processTurn, the end of turn
+ * effect lists and the pokemon's forced turns. The pokemon themselves, the
+ * turns sent in by clients and the script object wrappers are still on the
+ * global heap, because they are made or released on other threads or can
+ * outlive the battle.
+ */
+class BattleArena : boost::noncopyable {
+public:
+    BattleArena();
+    ~BattleArena();
+
+    void *allocate(const size_t size);
+    void deallocate(void *p, const size_t size);
+
+    /**
+     * Get the number of bytes obtained from the global heap.
+     */
+    size_t getReserved() const { return m_reserved; }
+
+private:
+    enum {
+        MIN_BLOCK = 16,
+        MAX_BLOCK = 4096,
+        CLASS_COUNT = 9,        // 16, 32, ..., 4096
+        CHUNK_SIZE = 16384
+    };
+
+    struct Chunk {
+        Chunk *next;
+    };
+
+    struct FreeBlock {
+        FreeBlock *next;
+    };
+
+    static int getSizeClass(const size_t size);
+
+    Chunk *m_chunks;
+    char *m_top;
+    char *m_end;
+    FreeBlock *m_free[CLASS_COUNT];
+    size_t m_reserved;
+};
+
+/**
+ * An STL allocator backed by a BattleArena. An allocator without an arena
+ * uses the global heap, so containers can be built before a battle exists.
+ */
+template <class T>
+class ArenaAllocator {
+public:
+    typedef T value_type;
+    typedef T *pointer;
+    typedef const T *const_pointer;
+    typedef T &reference;
+    typedef const T &const_reference;
+    typedef size_t size_type;
+    typedef ptrdiff_t difference_type;
+
+    template <class U>
+    struct rebind {
+        typedef ArenaAllocator<U> other;
+    };
+
+    ArenaAllocator(BattleArena *arena = NULL): m_arena(arena) { }
+
+    template <class U>
+    ArenaAllocator(const ArenaAllocator<U> &rhs): m_arena(rhs.getArena()) { }
+
+    BattleArena *getArena() const { return m_arena; }
+
+    pointer address(reference x) const { return &x; }
+    const_pointer address(const_reference x) const { return &x; }
+
+    pointer allocate(const size_type n, const void * = 0) {
+        const size_t size = n * sizeof(T);
+        if (m_arena) {
+            return static_cast<pointer>(m_arena->allocate(size));
+        }
+        return static_cast<pointer>(::operator new(size));
+    }
+
+    void deallocate(pointer p, const size_type n) {
+        if (m_arena) {
+            m_arena->deallocate(p, n * sizeof(T));
+        } else {
+            ::operator delete(p);
+        }
+    }
+
+    size_type max_size() const {
+        return size_t(-1) / sizeof(T);
+    }
+
+    void construct(pointer p, const T &val) {
+        new(static_cast<void *>(p)) T(val);
+    }
+
+    void destroy(pointer p) {
+        p->~T();
+    }
+
+private:
+    BattleArena *m_arena;
+};
+
+template <class T, class U>
+inline bool operator==(const ArenaAllocator<T> &a,
+        const ArenaAllocator<U> &b) {
+    return (a.getArena() == b.getArena());
+}
+
+template <class T, class U>
+inline bool operator!=(const ArenaAllocator<T> &a,
+        const ArenaAllocator<U> &b) {
+    return (a.getArena() != b.getArena());
+}
+
+}
+
+#endif
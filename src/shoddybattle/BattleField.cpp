@@ -24,7 +24,9 @@
 
 #include <boost/bind.hpp>
 #include <boost/shared_array.hpp>
+#include <boost/make_shared.hpp>
 #include "BattleField.h"
+#include "BattleArena.h"
 #include "../mechanics/BattleMechanics.h"
 #include "../scripting/ScriptMachine.h"
 #include "../text/Text.h"
@@ -39,6 +41,8 @@ using namespace boost;
 namespace shoddybattle {
 
 struct BattleFieldImpl {
+    // Declared first so that it outlives everything allocated from it.
+    BattleArena arena;
     FieldObjectPtr object;
     const BattleMechanics *mech;
     Generation *generation;
@@ -47,23 +51,39 @@ struct BattleFieldImpl {
     ScriptContextPtr contextRef;
     Pokemon::ARRAY teams[TEAM_COUNT];
     int partySize;
+    int visitSize;          // party size that visitActive is specialised for
     shared_ptr<PokemonParty> active[TEAM_COUNT];
     STATUSES effects;      // field effects
+    TICK_SCHEDULE schedule; // end of turn order of field effects
     bool descendingSpeed;
     std::stack<BattleField::EXECUTION> executing;
     MoveObjectPtr lastMove;
     bool narration;
+    bool query;             // see BattleField::setQuery
     int host;
+    string text;            // buffer for print()
 
-    typedef map<pair<Pokemon *, Pokemon *>, bool> RANDOM_MAP;
+    typedef pair<Pokemon *, Pokemon *> RANDOM_KEY;
+    typedef map<RANDOM_KEY, bool, less<RANDOM_KEY>,
+            ArenaAllocator<pair<const RANDOM_KEY, bool> > > RANDOM_MAP;
 
     BattleFieldImpl():
             mech(NULL),
             machine(NULL),
             context(NULL),
+            visitSize(0),
             narration(true),
+            query(false),
             host(0) { }
 
+    template <class T>
+    bool visitActive(T &visitor);
+
+    RANDOM_MAP getRandomMap() {
+        const less<RANDOM_KEY> comp = less<RANDOM_KEY>();
+        return RANDOM_MAP(comp, RANDOM_MAP::allocator_type(&arena));
+    }
+
     void sortInTurnOrder(vector<Pokemon::PTR> &, vector<const PokemonTurn *> &);
     bool speedComparator(RANDOM_MAP &random,
             Pokemon *p1, Pokemon *p2) {
@@ -74,7 +94,7 @@ struct BattleFieldImpl {
                 return (s1 > s2);
             return (s2 > s1);
         }
-        pair<Pokemon *, Pokemon *> elem(p1, p2);
+        RANDOM_KEY elem(p1, p2);
         RANDOM_MAP::iterator i = random.find(elem);
         if (i != random.end()) {
             return i->second;
@@ -123,17 +143,89 @@ struct BattleFieldImpl {
 
     ~BattleFieldImpl() {
         terminate();
+        // A pokemon can outlive the battle, so anything it holds from the
+        // arena has to be released now.
+        for (int i = 0; i < TEAM_COUNT; ++i) {
+            for_each(teams[i].begin(), teams[i].end(),
+                    boost::bind(&Pokemon::clearForcedTurn, _1));
+        }
     }
 };
 
 PokemonTurn PokemonTurn::NOP(TT_NOP, 0);
+const vector<string> TextMessage::NO_ARGS;
+
+namespace {
+
+/**
+ * Call a visitor with each active pokemon that has not fainted, in field
+ * order, until the visitor returns true. SIZE is the party size, or zero if it
+ * is only known at run time.
+ */
+template <int SIZE, class T>
+bool visitActive(BattleFieldImpl *impl, T &visitor) {
+    const int size = SIZE ? SIZE : impl->partySize;
+    for (int i = 0; i < TEAM_COUNT; ++i) {
+        PokemonParty &party = *impl->active[i];
+        for (int j = 0; j < size; ++j) {
+            Pokemon *p = party[j].get();
+            if (p && !p->isFainted() && visitor(p)) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+/**
+ * Sort a range. Ranges of two elements, which is every sort in a singles
+ * battle, are ordered with one comparison. That is also what std::sort ends
+ * up doing with two elements, so the coin flips made by the comparators of
+ * this file happen in the same order either way.
+ */
+template <class T, class Comparator>
+void sortRange(T begin, T end, Comparator comp) {
+    if ((end - begin) == 2) {
+        if (comp(*(begin + 1), *begin)) {
+            std::iter_swap(begin, begin + 1);
+        }
+        return;
+    }
+    sort(begin, end, comp);
+}
+
+} // anonymous namespace
+
+/**
+ * Visit the active pokemon. Singles and doubles battles use a copy of the
+ * loop with the party size fixed; which copy is picked once, when the battle
+ * is initialised, rather than on every visit.
+ */
+template <class T>
+bool BattleFieldImpl::visitActive(T &visitor) {
+    typedef bool (*VISIT)(BattleFieldImpl *, T &);
+    static const VISIT VISIT_ACTIVE[] = {
+        &shoddybattle::visitActive<0, T>,
+        &shoddybattle::visitActive<1, T>,
+        &shoddybattle::visitActive<2, T>
+    };
+    return VISIT_ACTIVE[visitSize](this, visitor);
+}
 
 void BattleField::setNarrationEnabled(const bool enabled) {
     m_impl->narration = enabled;
 }
 
 bool BattleField::isNarrationEnabled() const {
-    return m_impl->narration;
+    return m_impl->narration && !m_impl->query;
+}
+
+void BattleField::setQuery(const bool query) {
+    m_impl->query = query;
+}
+
+bool BattleField::isQuery() const {
+    return m_impl->query;
 }
 
 void BattleField::terminate() {
@@ -211,9 +303,9 @@ ScriptValue BattleField::sendMessage(const string &message,
  */
 template <class T>
 void BattleField::sortBySpeed(T &pokemon) {
-    sort(pokemon.begin(), pokemon.end(),
+    sortRange(pokemon.begin(), pokemon.end(),
             boost::bind(&BattleFieldImpl::speedComparator,
-                m_impl, BattleFieldImpl::RANDOM_MAP(), _1, _2));
+                m_impl, m_impl->getRandomMap(), _1, _2));
 }
 
 /**
@@ -357,6 +449,21 @@ Pokemon *BattleField::getRandomTarget(const int partyIdx) const {
     return intermediate[r].get();
 }
 
+namespace {
+
+struct TargetVisitor {
+    vector<Pokemon *> *targets;
+    Pokemon *exclude;
+    bool operator()(Pokemon *p) {
+        if (p != exclude) {
+            targets->push_back(p);
+        }
+        return false;
+    }
+};
+
+} // anonymous namespace
+
 /**
  * Build a list of targets for a move.
  */
@@ -388,27 +495,9 @@ void BattleField::getTargetList(TARGET mc, std::vector<Pokemon *> &targets,
         }
     } else if (mc == T_NONE) {
         targets.push_back(user->getMemoryPokemon());
-    } else if (mc == T_OTHERS) {
-        for (int i = 0; i < TEAM_COUNT; ++i) {
-            PokemonParty &party = *active[i].get();
-            for (int j = 0; j < party.getSize(); ++j) {
-                Pokemon::PTR p = party[j];
-                if (p && !p->isFainted() && (p.get() != user)) {
-                    targets.push_back(p.get());
-                }
-            }
-        }
-        sortBySpeed(targets);
-    } else if (mc == T_ALL) {
-        for (int i = 0; i < TEAM_COUNT; ++i) {
-            PokemonParty &party = *active[i].get();
-            for (int j = 0; j < party.getSize(); ++j) {
-                Pokemon::PTR p = party[j];
-                if (p && !p->isFainted()) {
-                    targets.push_back(p.get());
-                }
-            }
-        }
+    } else if ((mc == T_OTHERS) || (mc == T_ALL)) {
+        TargetVisitor visitor = { &targets, (mc == T_OTHERS) ? user : NULL };
+        m_impl->visitActive(visitor);
         sortBySpeed(targets);
     } else if (mc == T_ALLIES) {
         Pokemon::ARRAY &team = m_impl->teams[user->getParty()];
@@ -496,7 +585,7 @@ bool turnOrderComparator(BattleFieldImpl *impl,
     }
 
     // finally: coin flip
-    pair<Pokemon *, Pokemon *> elem(p1.pokemon.get(), p2.pokemon.get());
+    BattleFieldImpl::RANDOM_KEY elem(p1.pokemon.get(), p2.pokemon.get());
     BattleFieldImpl::RANDOM_MAP::iterator i = random.find(elem);
     if (i != random.end()) {
         return i->second;
@@ -513,7 +602,7 @@ bool turnOrderComparator(BattleFieldImpl *impl,
  */
 void BattleFieldImpl::sortInTurnOrder(vector<Pokemon::PTR> &pokemon,
         vector<const PokemonTurn *> &turns) {
-    vector<TurnOrderEntity> entities;
+    vector<TurnOrderEntity, ArenaAllocator<TurnOrderEntity> > entities(&arena);
 
     const int count = pokemon.size();
     assert(count == (int)turns.size());
@@ -537,9 +626,8 @@ void BattleFieldImpl::sortInTurnOrder(vector<Pokemon::PTR> &pokemon,
     }
 
     // sort the entities
-    sort(entities.begin(), entities.end(),
-            boost::bind(turnOrderComparator, this,
-                BattleFieldImpl::RANDOM_MAP(), _1, _2));
+    sortRange(entities.begin(), entities.end(),
+            boost::bind(turnOrderComparator, this, getRandomMap(), _1, _2));
 
     // reorder the parameter vectors
     for (int i = 0; i < count; ++i) {
@@ -556,6 +644,10 @@ ScriptMachine *BattleField::getScriptMachine() {
     return m_impl->machine;
 }
 
+BattleArena *BattleField::getArena() {
+    return &m_impl->arena;
+}
+
 const BattleMechanics *BattleField::getMechanics() const {
     return m_impl->mech;
 }
@@ -600,22 +692,31 @@ void BattleField::sendOutPokemon(const int party,
 /**
  * Apply a status effect to the whole field.
  */
+namespace {
+
+struct ApplyStatusVisitor {
+    StatusObject *effect;
+    bool applied;
+    bool operator()(Pokemon *p) {
+        if (p->applyStatus(NULL, effect)) {
+            applied = true;
+        }
+        return false;
+    }
+};
+
+} // anonymous namespace
+
 StatusObjectPtr BattleField::applyStatus(StatusObject *effect) {
     StatusObjectPtr ret = effect->cloneAndRoot(m_impl->context);
     ret->disableClone(m_impl->context);
-    bool applied = false;
-    for (int i = 0; i < TEAM_COUNT; ++i) {
-        for (int j = 0; j < m_impl->partySize; ++j) {
-            Pokemon::PTR p = (*m_impl->active[i])[j];
-            if (p && !p->isFainted() && p->applyStatus(NULL, ret.get())) {
-                applied = true;
-            }
-        }
-    }
-    if (!applied) {
+    ApplyStatusVisitor visitor = { ret.get(), false };
+    m_impl->visitActive(visitor);
+    if (!visitor.applied) {
         return StatusObjectPtr();
     }
-    m_impl->effects.push_back(ret);
+    m_impl->effects.push_back(ret, m_impl->context);
+    Pokemon::scheduleEffect(m_impl->schedule, ret, m_impl->context);
     return ret;
 }
 
@@ -641,14 +742,9 @@ void BattleField::print(const TextMessage &msg) {
     if (!isNarrationEnabled())
         return;
 
-    const vector<string> &args = msg.getArgs();
-    const int argc = args.size();
-    const char *argv[argc];
-    for (int i = 0; i < argc; ++i) {
-        argv[i] = args[i].c_str();
-    }
-    string message = m_impl->machine->getText(
-            msg.getCategory(), msg.getMessage(), argc, argv);
+    string &message = m_impl->text;
+    m_impl->machine->getText()->getText(
+            msg.getCategory(), msg.getMessage(), msg.getArgs(), message);
     Log::out() << message << endl;
 }
 
@@ -686,19 +782,32 @@ void BattleField::informStatusChange(Pokemon *, StatusObject *, const bool) {
 
 }
 
+namespace {
+
+struct VetoSelectionVisitor {
+    Pokemon *user;
+    MoveObject *move;
+    bool operator()(Pokemon *p) {
+        return p->vetoSelection(user, move);
+    }
+};
+
+struct VetoSwitchVisitor {
+    ScriptValue *args;
+    bool operator()(Pokemon *p) {
+        ScriptValue v = p->sendMessage("vetoSwitch", 1, args);
+        return (!v.failed() && v.getBool());
+    }
+};
+
+} // anonymous namespace
+
 /**
  * Determine whether to veto the selection of a move.
  */
 bool BattleField::vetoSelection(Pokemon *user, MoveObject *move) {
-    for (int i = 0; i < TEAM_COUNT; ++i) {
-        for (int j = 0; j < m_impl->partySize; ++j) {
-            Pokemon::PTR p = (*m_impl->active[i])[j];
-            if (p && !p->isFainted() && p->vetoSelection(user, move)) {
-                return true;
-            }
-        }
-    }
-    return false;
+    VetoSelectionVisitor visitor = { user, move };
+    return m_impl->visitActive(visitor);
 }
 
 /**
@@ -706,18 +815,8 @@ bool BattleField::vetoSelection(Pokemon *user, MoveObject *move) {
  */
 bool BattleField::vetoSwitch(Pokemon *subject) {
     ScriptValue args[] = { subject };
-    for (int i = 0; i < TEAM_COUNT; ++i) {
-        for (int j = 0; j < m_impl->partySize; ++j) {
-            Pokemon::PTR p = (*m_impl->active[i])[j];
-            if (p && !p->isFainted()) {
-                ScriptValue v = p->sendMessage("vetoSwitch", 1, args);
-                if (!v.failed() && v.getBool()) {
-                    return true;
-                }
-            }
-        }
-    }
-    return false;
+    VetoSwitchVisitor visitor = { args };
+    return m_impl->visitActive(visitor);
 }
 
 namespace {
@@ -725,10 +824,10 @@ namespace {
 /**
  * The user's own statuses are checked first, then index order.
  */
-bool vetoExecutionPredicate(Pokemon::PTR p1, Pokemon::PTR p2, Pokemon *user) {
-    if (p1.get() == user)
+bool vetoExecutionPredicate(Pokemon *p1, Pokemon *p2, Pokemon *user) {
+    if (p1 == user)
         return true;
-    if (p2.get() == user)
+    if (p2 == user)
         return false;
     int diff = p1->getParty() - p2->getParty();
     if (diff != 0) {
@@ -737,6 +836,14 @@ bool vetoExecutionPredicate(Pokemon::PTR p1, Pokemon::PTR p2, Pokemon *user) {
     return ((p1->getSlot() - p2->getSlot()) < 0);
 }
 
+struct CollectVisitor {
+    vector<Pokemon *> *pokemon;
+    bool operator()(Pokemon *p) {
+        pokemon->push_back(p);
+        return false;
+    }
+};
+
 } // anonymous namespace
 
 /**
@@ -745,18 +852,12 @@ bool vetoExecutionPredicate(Pokemon::PTR p1, Pokemon::PTR p2, Pokemon *user) {
  */
 bool BattleField::vetoExecution(Pokemon *user, Pokemon *target,
         MoveObject *move) {
-    Pokemon::ARRAY pokemon;
-    for (int i = 0; i < TEAM_COUNT; ++i) {
-        for (int j = 0; j < m_impl->partySize; ++j) {
-            Pokemon::PTR p = (*m_impl->active[i])[j];
-            if (p && !p->isFainted()) {
-                pokemon.push_back(p);
-            }
-        }
-    }
-    sort(pokemon.begin(), pokemon.end(),
+    vector<Pokemon *> pokemon;
+    CollectVisitor visitor = { &pokemon };
+    m_impl->visitActive(visitor);
+    sortRange(pokemon.begin(), pokemon.end(),
             boost::bind(vetoExecutionPredicate, _1, _2, user));
-    for (Pokemon::ARRAY::iterator i = pokemon.begin();
+    for (vector<Pokemon *>::iterator i = pokemon.begin();
             i != pokemon.end(); ++i) {
         if ((*i)->vetoExecution(user, target, move)) {
             return true;
@@ -803,38 +904,74 @@ void BattleField::beginBattle() {
 namespace {
 
 struct EffectEntity {
-    Pokemon::PTR subject;
-    StatusObject *effect;
+    Pokemon *subject;
+    const TickEntry *entry;
     int speed;
-    double tier;
-    int subtier;
-};
-
-struct FieldEffectEntity {
-    StatusObject *effect;
-    double tier;
-    int subtier;
 };
 
 bool effectComparator(const bool descendingSpeed,
         const EffectEntity &e1, const EffectEntity &e2) {
-    if (e1.tier != e2.tier) {
-        return (e1.tier < e2.tier);
+    if (e1.entry->tier != e2.entry->tier) {
+        return (e1.entry->tier < e2.entry->tier);
     }
     if (e1.speed != e2.speed) {
         const bool cmp = e1.speed > e2.speed;
         return descendingSpeed ? cmp : !cmp;
     }
-    return e1.subtier < e2.subtier;
+    return e1.entry->subtier < e2.entry->subtier;
 }
 
-bool fieldEffectComparator(const FieldEffectEntity &e1,
-        const FieldEffectEntity &e2) {
-    if (e1.tier != e2.tier) {
-        return (e1.tier < e2.tier);
+/**
+ * A run of EffectEntity objects belonging to one pokemon, already in end of
+ * turn order.
+ */
+struct EffectRun {
+    int begin;
+    int end;
+};
+
+typedef vector<EffectEntity, ArenaAllocator<EffectEntity> > EFFECT_LIST;
+typedef vector<EffectRun, ArenaAllocator<EffectRun> > RUN_LIST;
+
+/**
+ * Take a snapshot of the end of turn schedule of each active pokemon. Each
+ * schedule is already in tier and subtier order, and speed only needs to be
+ * looked up once per pokemon rather than once per effect, so each pokemon
+ * adds a single sorted run.
+ */
+struct ScheduleVisitor {
+    ScriptContext *cx;
+    EFFECT_LIST *effects;
+    RUN_LIST *runs;
+    bool operator()(Pokemon *p) {
+        const TICK_SCHEDULE &schedule = p->getTickSchedule();
+        if (schedule.empty())
+            return false;
+        const int speed = p->getStat(S_SPEED);
+        const int size = static_cast<int>(effects->size());
+        EffectRun run = { size, size };
+        TICK_SCHEDULE::const_iterator k = schedule.begin();
+        for (; k != schedule.end(); ++k) {
+            // A tier of -1 means that the effect never ticks.
+            if ((k->tier != -1) && k->effect->isActive(cx)) {
+                EffectEntity entity = { p, &*k, speed };
+                effects->push_back(entity);
+            }
+        }
+        run.end = effects->size();
+        if (run.begin != run.end) {
+            runs->push_back(run);
+        }
+        return false;
+    }
+};
+
+struct RemoveStatusesVisitor {
+    bool operator()(Pokemon *p) {
+        p->removeStatuses();
+        return false;
     }
-    return e1.subtier < e2.subtier;
-}
+};
 
 } // anonymous namespace
 
@@ -853,85 +990,75 @@ void BattleField::tickEffects() {
         cx->callFunctionByName(i->get(), "beginTick", 1, argv);
     }
 
-    vector<EffectEntity> effects;
-    for (int i = 0; i < TEAM_COUNT; ++i) {
-        PokemonParty &party = *m_impl->active[i];
-        for (int j = 0; j < m_impl->partySize; ++j) {
-            Pokemon::PTR p = party[j];
-            if (p && !p->isFainted()) {
-                const STATUSES &statuses = p->getEffects();
-                STATUSES::const_iterator k = statuses.begin();
-                for (; k != statuses.end(); ++k) {
-                    if ((*k)->isActive(cx)) {
-                        const int speed = p->getStat(S_SPEED);
-                        const double tier = (*k)->getTier(cx);
-                        const int subtier = (*k)->getSubtier(cx);
-                        EffectEntity entity = { p, k->get(), speed, tier,
-                                subtier };
-                        effects.push_back(entity);
-                    }
-                }
-            }
-        }
-    }
+    BattleArena *arena = &m_impl->arena;
+    EFFECT_LIST effects(arena);
+    RUN_LIST runs(arena);
+    ScheduleVisitor schedule = { cx, &effects, &runs };
+    m_impl->visitActive(schedule);
 
     // Determine what order to sort pokemon by speed for the purpose of end
     // of turn effects. This is recalculated here in case the value changed
     // during the turn. We send the message to a pokemon known to be alive.
     if (!effects.empty()) {
-        Pokemon::PTR p = effects[0].subject;
+        Pokemon *p = effects[0].subject;
         ScriptValue v = p->sendMessage("informSpeedSort", 0, NULL);
         m_impl->descendingSpeed = v.failed() ? true : v.getBool();
     }
 
-    sort(effects.begin(), effects.end(), boost::bind(effectComparator,
-            m_impl->descendingSpeed, _1, _2));
+    // Merge the runs. Every entry in a run has the same speed, so merging
+    // gives the same order that sorting the whole lot would.
+    EFFECT_LIST ordered(arena);
+    ordered.reserve(effects.size());
+    while (true) {
+        EffectRun *next = NULL;
+        for (RUN_LIST::iterator i = runs.begin(); i != runs.end(); ++i) {
+            if (i->begin == i->end)
+                continue;
+            if (!next || effectComparator(m_impl->descendingSpeed,
+                    effects[i->begin], effects[next->begin])) {
+                next = &*i;
+            }
+        }
+        if (!next)
+            break;
+        ordered.push_back(effects[next->begin++]);
+    }
 
     int tier = -1;
-    for (vector<EffectEntity>::iterator i = effects.begin();
-            i != effects.end(); ++i) {
+    for (EFFECT_LIST::iterator i = ordered.begin(); i != ordered.end(); ++i) {
 
-        if (tier != i->tier) {
+        if (tier != i->entry->tier) {
             if ((tier != -1) && determineVictory()) {
                 return;
             }
-            tier = i->tier;
+            tier = i->entry->tier;
         }
 
-        Pokemon::PTR subject = i->subject;
+        Pokemon *subject = i->subject;
         if (subject->isFainted()) {
             continue;
         }
-        StatusObject *effect = i->effect;
+        // Hold a reference in case the tick removes the effect.
+        StatusObjectPtr effect = i->entry->effect;
         if (!effect->isActive(cx)) {
             continue;
         }
-        effect->setSubject(cx, subject.get());
+        effect->setSubject(cx, subject);
         effect->tick(cx);
 
-        if (i->tier == 6) {
+        if (i->entry->tier == 6) {
             if (determineVictory()) {
                 return;
             }
         }
     }
 
-    vector<FieldEffectEntity> fieldEffects;
-    for (STATUSES::const_iterator i = m_impl->effects.begin();
-            i != m_impl->effects.end(); ++i) {
-        if (!(*i)->isActive(cx))
-            continue;
-        FieldEffectEntity entity = { i->get(), (*i)->getTier(cx),
-                (*i)->getSubtier(cx) };
-        fieldEffects.push_back(entity);
-    }
-
-    sort(fieldEffects.begin(), fieldEffects.end(),
-            boost::bind(fieldEffectComparator, _1, _2));
-
-    for (vector<FieldEffectEntity>::const_iterator i = fieldEffects.begin();
+    // Field effects are kept in tier and subtier order as they are applied.
+    // Copy the schedule because an endTick may apply another field effect.
+    const TICK_SCHEDULE fieldEffects = m_impl->schedule;
+    for (TICK_SCHEDULE::const_iterator i = fieldEffects.begin();
             i != fieldEffects.end(); ++i) {
-        StatusObject *effect = i->effect;
+        StatusObject *effect = i->effect.get();
         if (!effect->isActive(cx))
             continue;
 
@@ -939,18 +1066,12 @@ void BattleField::tickEffects() {
         cx->callFunctionByName(effect, "endTick", 1, argv);
     }
 
-    for (int i = 0; i < TEAM_COUNT; ++i) {
-        PokemonParty &party = *m_impl->active[i];
-        for (int j = 0; j < m_impl->partySize; ++j) {
-            Pokemon::PTR p = party[j];
-            if (p && !p->isFainted()) {
-                p->removeStatuses();
-            }
-        }
-    }
+    RemoveStatusesVisitor remove;
+    m_impl->visitActive(remove);
 
-    Pokemon::removeStatuses(m_impl->effects,
+    Pokemon::removeStatuses(m_impl->effects, m_impl->schedule,
             boost::bind(&StatusObject::isRemovable, _1, m_impl->context));
+    m_impl->effects.compact();
 
     determineVictory();
 }
@@ -977,23 +1098,23 @@ int BattleField::getAliveCount(const int party, const bool reserve) const {
  */
 bool BattleField::determineVictory() {
     int victory = -1;
-    for (STATUSES::const_iterator i = m_impl->effects.begin();
-            i != m_impl->effects.end(); ++i) {
-        if (!(*i)->isActive(m_impl->context))
+    const StatusList::INDEX &hook =
+            m_impl->effects.getHook("determineVictory", m_impl->context);
+    for (unsigned int i = 0; i < hook.size(); ++i) {
+        StatusObject *effect = m_impl->effects[hook[i]];
+        if (!effect || !effect->isActive(m_impl->context))
             continue;
 
-        if (m_impl->context->hasProperty(i->get(), "determineVictory")) {
-            ScriptValue v = m_impl->context->callFunctionByName(i->get(),
-                   "determineVictory", 0, NULL);
-            if (!v.failed()) {
-                const int val = v.getInt();
-                if (val != -1) {
-                    if ((victory != -1) && (victory != val)) {
-                        informVictory(-1);
-                        return true;
-                    }
-                    victory = val;
+        ScriptValue v = m_impl->context->callFunctionByName(effect,
+               "determineVictory", 0, NULL);
+        if (!v.failed()) {
+            const int val = v.getInt();
+            if (val != -1) {
+                if ((victory != -1) && (victory != val)) {
+                    informVictory(-1);
+                    return true;
                 }
+                victory = val;
             }
         }
     }
@@ -1248,21 +1369,68 @@ PokemonTurn *BattleField::getTurn(const int i, const int j) {
     return &PokemonTurn::NOP;
 }
 
+namespace {
+
+struct TransformStatusVisitor {
+    Pokemon *subject;
+    StatusObjectPtr *status;
+    bool operator()(Pokemon *p) {
+        p->transformStatus(subject, status);
+        return !*status;
+    }
+};
+
+struct ModifierVisitor {
+    Pokemon *user, *target;
+    MoveObject *move;
+    bool critical;
+    int targets;
+    MODIFIERS *mods;
+    bool operator()(Pokemon *p) {
+        p->getModifiers(user, target, move, critical, targets, *mods);
+        return false;
+    }
+};
+
+struct ImmunityVisitor {
+    Pokemon *user, *target;
+    TYPE_SET *immunities, *vulnerabilities;
+    bool transforms;
+    bool operator()(Pokemon *p) {
+        if (p->getImmunities(user, target, *immunities, *vulnerabilities)) {
+            transforms = true;
+        }
+        return false;
+    }
+};
+
+struct EffectivenessVisitor {
+    const PokemonType *moveType, *type;
+    Pokemon *target;
+    double *factor;
+    bool operator()(Pokemon *p) {
+        return p->getTransformedEffectiveness(moveType, type, target, *factor);
+    }
+};
+
+struct StatModifierVisitor {
+    STAT stat;
+    Pokemon *subject, *target;
+    PRIORITY_MAP *mods;
+    bool operator()(Pokemon *p) {
+        p->getStatModifiers(stat, subject, target, *mods);
+        return false;
+    }
+};
+
+} // anonymous namespace
+
 /**
  * Transform a status effect.
  */
 void BattleField::transformStatus(Pokemon *subject, StatusObjectPtr *status) {
-    for (int i = 0; i < TEAM_COUNT; ++i) {
-        for (int j = 0; j < m_impl->partySize; ++j) {
-            Pokemon::PTR p = (*m_impl->active[i])[j];
-            if (p && !p->isFainted()) {
-                p->transformStatus(subject, status);
-                if (!*status) {
-                    return;
-                }
-            }
-        }
-    }
+    TransformStatusVisitor visitor = { subject, status };
+    m_impl->visitActive(visitor);
 }
 
 /**
@@ -1272,31 +1440,21 @@ void BattleField::transformStatus(Pokemon *subject, StatusObjectPtr *status) {
 void BattleField::getModifiers(Pokemon &user, Pokemon &target,
         MoveObject &obj, const bool critical, const int targets,
         MODIFIERS &mods) {
-    for (int i = 0; i < TEAM_COUNT; ++i) {
-        for (int j = 0; j < m_impl->partySize; ++j) {
-            Pokemon::PTR p = (*m_impl->active[i])[j];
-            if (p && !p->isFainted()) {
-                p->getModifiers(&user, &target, &obj, critical, targets, mods);
-            }
-        }
-    }
+    ModifierVisitor visitor =
+            { &user, &target, &obj, critical, targets, &mods };
+    m_impl->visitActive(visitor);
 }
 
 /**
  * Get additional immunities or vulnerabilities in play for a given user
  * attacking a given target.
  */
-void BattleField::getImmunities(Pokemon *user, Pokemon *target,
-        set<const PokemonType *> &immunities,
-        set<const PokemonType *> &vulnerabilities) {
-    for (int i = 0; i < TEAM_COUNT; ++i) {
-        for (int j = 0; j < m_impl->partySize; ++j) {
-            Pokemon::PTR p = (*m_impl->active[i])[j];
-            if (p && !p->isFainted()) {
-                p->getImmunities(user, target, immunities, vulnerabilities);
-            }
-        }
-    }
+bool BattleField::getImmunities(Pokemon *user, Pokemon *target,
+        TYPE_SET &immunities, TYPE_SET &vulnerabilities) {
+    ImmunityVisitor visitor =
+            { user, target, &immunities, &vulnerabilities, false };
+    m_impl->visitActive(visitor);
+    return visitor.transforms;
 }
 
 /**
@@ -1305,18 +1463,8 @@ void BattleField::getImmunities(Pokemon *user, Pokemon *target,
  */
 bool BattleField::getTransformedEffectiveness(const PokemonType *moveType,
         const PokemonType *type, Pokemon *target, double &factor) {
-    for (int i = 0; i < TEAM_COUNT; ++i) {
-        for (int j = 0; j < m_impl->partySize; ++j) {
-            Pokemon::PTR p = (*m_impl->active[i])[j];
-            if (p && !p->isFainted()) {
-                if (p->getTransformedEffectiveness(moveType, type,
-                        target, factor)) {
-                    return true;
-                }
-            }
-        }
-    }
-    return false;
+    EffectivenessVisitor visitor = { moveType, type, target, &factor };
+    return m_impl->visitActive(visitor);
 }
 
 /**
@@ -1325,14 +1473,8 @@ bool BattleField::getTransformedEffectiveness(const PokemonType *moveType,
  */
 void BattleField::getStatModifiers(STAT stat,
         Pokemon *subject, Pokemon *target, PRIORITY_MAP &mods) {
-    for (int i = 0; i < TEAM_COUNT; ++i) {
-        for (int j = 0; j < m_impl->partySize; ++j) {
-            Pokemon::PTR p = (*m_impl->active[i])[j];
-            if (p && !p->isFainted()) {
-                p->getStatModifiers(stat, subject, target, mods);
-            }
-        }
-    }
+    StatModifierVisitor visitor = { stat, subject, target, &mods };
+    m_impl->visitActive(visitor);
 }
 
 /**
@@ -1395,11 +1537,14 @@ void BattleFieldImpl::initialise(BattleField *field,
     this->host = mech->getCoinFlip() ? 0 : 1;
     this->generation = generation;
     this->partySize = activeParty;
+    this->visitSize = (activeParty <= 2) ? activeParty : 0;
     this->descendingSpeed = true;
     for (int i = 0; i < TEAM_COUNT; ++i) {
         this->teams[i] = teams[i];
-        active[i] = shared_ptr<PokemonParty>(
-                new PokemonParty(activeParty, trainer[i]));
+        // The parties die with the battle, so they come from its arena.
+        active[i] = allocate_shared<PokemonParty>(
+                ArenaAllocator<PokemonParty>(&arena), activeParty,
+                trainer[i], &arena);
 
         // Set first n pokemon to be the active pokemon.
         int bound = activeParty;
@@ -26,10 +26,10 @@
 #define _BATTLE_FIELD_H_
 
 #include <boost/shared_ptr.hpp>
-#include <boost/shared_array.hpp>
 #include <vector>
 #include <set>
 #include "Pokemon.h"
+#include "BattleArena.h"
 #include "../matchmaking/MetagameList.h"
 #include "../scripting/ObjectWrapper.h"
 
@@ -44,6 +44,7 @@ class BattleMechanics;
 
 class ScriptMachine;
 class ScriptContext;
+class BattleArena;
 class MoveObject;
 
 class ScriptObject;
@@ -52,10 +53,14 @@ class BattleFieldException {
     
 };
 
+/**
+ * A message from the string table and its arguments. The arguments are held
+ * by reference, so a TextMessage must not outlive them.
+ */
 class TextMessage {
 public:
     TextMessage(const int category, const int msg,
-            const std::vector<std::string> &args = std::vector<std::string>()):
+            const std::vector<std::string> &args = NO_ARGS):
             m_category(category),
             m_msg(msg),
             m_args(args) { }
@@ -69,9 +74,11 @@ public:
         return m_args;
     }
 private:
+    static const std::vector<std::string> NO_ARGS;
+
     const int m_category;
     const int m_msg;
-    const std::vector<std::string> m_args;
+    const std::vector<std::string> &m_args;
 };
 
 enum TURN_TYPE {
@@ -98,10 +105,11 @@ struct PokemonTurn {
 
 struct PokemonParty {
 public:
-    PokemonParty(const int size, const std::string &name):
-            m_size(size), m_name(name) {
-        m_party = boost::shared_array<Pokemon::PTR>(new Pokemon::PTR[size]);
-    }
+    PokemonParty(const int size, const std::string &name,
+            BattleArena *arena = NULL):
+            m_size(size),
+            m_name(name),
+            m_party(size, Pokemon::PTR(), PARTY::allocator_type(arena)) { }
     Pokemon::PTR &operator[](const int i) {
         return m_party[i];
     }
@@ -116,9 +124,11 @@ public:
     }
     ScriptValue sendMessage(const std::string &, int, ScriptValue *);
 private:
+    typedef std::vector<Pokemon::PTR, ArenaAllocator<Pokemon::PTR> > PARTY;
+
     const int m_size;
     const std::string m_name;
-    boost::shared_array<Pokemon::PTR> m_party;
+    PARTY m_party;
     STATUSES m_effects;     // party-specific status effects
 };
 
@@ -328,11 +338,11 @@ public:
     void removeStatuses();
 
     /**
-     * Get a list of special types to which a pokemon is immune or vulnerable.
+     * Get the special types to which a pokemon is immune or vulnerable.
+     * Returns whether any active effect can transform type effectiveness.
      */
-    void getImmunities(Pokemon *user, Pokemon *target,
-            std::set<const PokemonType *> &immunities,
-            std::set<const PokemonType *> &vulnerabilities);
+    bool getImmunities(Pokemon *user, Pokemon *target,
+            TYPE_SET &immunities, TYPE_SET &vulnerabilities);
     
     /**
      * Get's the transformed effectiveness of a move type on a target
@@ -348,6 +358,14 @@ public:
     void setNarrationEnabled(const bool);
     bool isNarrationEnabled() const;
 
+    /**
+     * Mark the field as only being queried, e.g. for a damage distribution.
+     * Nothing is narrated while this is set, and scripts (which can read it
+     * as field.query) must not change the battle.
+     */
+    void setQuery(const bool);
+    bool isQuery() const;
+
     Pokemon *getRandomInactivePokemon(Pokemon *);
 
     typedef Pokemon::RECENT_MOVE EXECUTION;
@@ -357,6 +375,12 @@ public:
 
     ScriptMachine *getScriptMachine();
 
+    /**
+     * Get the memory arena that lives as long as this battle. Only the
+     * battle thread may allocate from it; see BattleArena for what does so.
+     */
+    BattleArena *getArena();
+
     ScriptContext *getContext();
 
     ScriptObject *getObject();
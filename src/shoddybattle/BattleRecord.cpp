@@ -0,0 +1,390 @@
+/*
+ * File:   BattleRecord.cpp
+ * Author: Catherine
+ *
+ * Created on October 19, 2026, 6:05 PM
+ *
+ * This file is a part of Shoddy Battle.
+ * Copyright (C) 2009  Catherine Fitzpatrick and Benjamin Gwin
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program; if not, visit the Free Software Foundation, Inc.
+ * online at http://gnu.org.
+ */
+
+#include <algorithm>
+#include "BattleRecord.h"
+#include "PokemonSpecies.h"
+#include "../mechanics/PokemonNature.h"
+#include "../moves/PokemonMove.h"
+
+using namespace std;
+using namespace boost;
+
+namespace shoddybattle {
+
+namespace {
+
+/**
+ * Identifies a battle record, and its version, at the start of the data.
+ */
+const unsigned char RECORD_MAGIC[] = { 'S', 'B', 'R', 1 };
+
+/**
+ * Writes integers in network byte order and strings in the same format as
+ * OutMessageBuffer, so a record can be inspected with the protocol tools.
+ */
+class RecordWriter {
+public:
+    RecordWriter(vector<unsigned char> &out): m_out(out) { }
+    RecordWriter &operator<<(const unsigned char v) {
+        m_out.push_back(v);
+        return *this;
+    }
+    RecordWriter &operator<<(const int16_t v) {
+        m_out.push_back((v >> 8) & 0xff);
+        m_out.push_back(v & 0xff);
+        return *this;
+    }
+    RecordWriter &operator<<(const int32_t v) {
+        for (int i = 24; i >= 0; i -= 8) {
+            m_out.push_back((v >> i) & 0xff);
+        }
+        return *this;
+    }
+    RecordWriter &operator<<(const string &v) {
+        *this << (int16_t)v.size();
+        m_out.insert(m_out.end(), v.begin(), v.end());
+        return *this;
+    }
+private:
+    vector<unsigned char> &m_out;
+};
+
+/**
+ * Reads what a RecordWriter wrote. Reading past the end of the data sets
+ * the error flag and yields zeroes.
+ */
+class RecordReader {
+public:
+    RecordReader(const vector<unsigned char> &in):
+            m_in(in), m_pos(0), m_error(false) { }
+    bool hasError() const { return m_error; }
+    bool atEnd() const { return (m_pos == m_in.size()); }
+    RecordReader &operator>>(unsigned char &v) {
+        v = available(1) ? m_in[m_pos++] : 0;
+        return *this;
+    }
+    RecordReader &operator>>(int16_t &v) {
+        v = 0;
+        if (available(2)) {
+            v = (int16_t)((m_in[m_pos] << 8) | m_in[m_pos + 1]);
+            m_pos += 2;
+        }
+        return *this;
+    }
+    RecordReader &operator>>(int32_t &v) {
+        v = 0;
+        if (available(4)) {
+            for (int i = 0; i < 4; ++i) {
+                v = (v << 8) | m_in[m_pos++];
+            }
+        }
+        return *this;
+    }
+    RecordReader &operator>>(string &v) {
+        int16_t length;
+        *this >> length;
+        const unsigned int size = (uint16_t)length;
+        if (available(size)) {
+            v.assign(m_in.begin() + m_pos, m_in.begin() + m_pos + size);
+            m_pos += size;
+        }
+        return *this;
+    }
+private:
+    bool available(const unsigned int size) {
+        if (m_in.size() - m_pos < size) {
+            m_error = true;
+            m_pos = m_in.size();
+            return false;
+        }
+        return true;
+    }
+    const vector<unsigned char> &m_in;
+    unsigned int m_pos;
+    bool m_error;
+};
+
+void writePokemon(RecordWriter &out, const PokemonRecord &p) {
+    out << (int16_t)p.species << p.nickname << (unsigned char)p.nature;
+    out << p.ability << p.item;
+    for (int i = 0; i < STAT_COUNT; ++i) {
+        out << (unsigned char)p.iv[i] << (unsigned char)p.ev[i];
+    }
+    out << (unsigned char)p.level << (unsigned char)p.gender;
+    out << p.happiness << (unsigned char)p.shiny;
+    out << (unsigned char)p.moves.size();
+    for (unsigned int i = 0; i < p.moves.size(); ++i) {
+        out << p.moves[i];
+    }
+    out << (unsigned char)p.ppUps.size();
+    for (unsigned int i = 0; i < p.ppUps.size(); ++i) {
+        out << (unsigned char)p.ppUps[i];
+    }
+}
+
+void readPokemon(RecordReader &in, PokemonRecord &p) {
+    int16_t species;
+    unsigned char nature, level, gender, shiny, count;
+    in >> species >> p.nickname >> nature >> p.ability >> p.item;
+    for (int i = 0; i < STAT_COUNT; ++i) {
+        unsigned char iv, ev;
+        in >> iv >> ev;
+        p.iv[i] = iv;
+        p.ev[i] = ev;
+    }
+    in >> level >> gender >> p.happiness >> shiny;
+    p.species = species;
+    p.nature = nature;
+    p.level = level;
+    p.gender = gender;
+    p.shiny = shiny;
+    in >> count;
+    p.moves.resize(count);
+    for (int i = 0; i < count; ++i) {
+        in >> p.moves[i];
+    }
+    in >> count;
+    p.ppUps.resize(count);
+    for (int i = 0; i < count; ++i) {
+        unsigned char ppUp;
+        in >> ppUp;
+        p.ppUps[i] = ppUp;
+    }
+}
+
+} // anonymous namespace
+
+void EventDigest::print(const TextMessage &msg) {
+    begin(E_PRINT);
+    add(msg.getCategory());
+    add(msg.getMessage());
+    const vector<string> &args = msg.getArgs();
+    add(args.size());
+    vector<string>::const_iterator i = args.begin();
+    for (; i != args.end(); ++i) {
+        add(*i);
+    }
+}
+
+void EventDigest::victory(const int party) {
+    begin(E_VICTORY);
+    add(party);
+}
+
+void EventDigest::useMove(Pokemon *p, const int move) {
+    begin(E_USE_MOVE, p);
+    add(move);
+}
+
+void EventDigest::withdraw(Pokemon *p) {
+    begin(E_WITHDRAW, p);
+}
+
+void EventDigest::sendOut(Pokemon *p) {
+    begin(E_SEND_OUT, p);
+    add(p->getSpeciesId());
+}
+
+void EventDigest::healthChange(Pokemon *p, const int delta) {
+    begin(E_HEALTH_CHANGE, p);
+    add(delta);
+    add(p->getHp());
+}
+
+void EventDigest::setPp(Pokemon *p, const int move, const int pp) {
+    begin(E_SET_PP, p);
+    add(move);
+    add(pp);
+}
+
+void EventDigest::setMove(Pokemon *p, const int idx, const int move,
+        const int pp, const int maxPp) {
+    begin(E_SET_MOVE, p);
+    add(idx);
+    add(move);
+    add(pp);
+    add(maxPp);
+}
+
+void EventDigest::fainted(Pokemon *p) {
+    begin(E_FAINTED, p);
+}
+
+void EventDigest::statusChange(Pokemon *p, const string &id,
+        const bool applied) {
+    begin(E_STATUS_CHANGE, p);
+    add(id);
+    add(applied);
+}
+
+void EventDigest::begin(const EVENT event, Pokemon *p) {
+    ++m_count;
+    add(event);
+    if (p) {
+        add(p->getParty());
+        add(p->getPosition());
+        add(p->getSlot());
+    }
+}
+
+/**
+ * FNV-1a, one byte at a time.
+ */
+void EventDigest::add(const int value) {
+    for (int i = 0; i < 32; i += 8) {
+        m_hash = (m_hash ^ ((value >> i) & 0xff)) * 16777619u;
+    }
+}
+
+void EventDigest::add(const string &value) {
+    add(value.size());
+    string::const_iterator i = value.begin();
+    for (; i != value.end(); ++i) {
+        m_hash = (m_hash ^ (unsigned char)*i) * 16777619u;
+    }
+}
+
+PokemonRecord::PokemonRecord(const Pokemon &p):
+        species(p.getSpeciesId()),
+        nickname(p.getName()),
+        nature(p.getNature()->getInternalValue()),
+        ability(p.getAbilityName()),
+        item(p.getItemName()),
+        level(p.getLevel()),
+        gender(p.getGender()),
+        happiness(p.getHappiness()),
+        shiny(p.isShiny()),
+        ppUps(p.getPpUps()) {
+    for (int i = 0; i < STAT_COUNT; ++i) {
+        iv[i] = p.getIv(static_cast<STAT>(i));
+        ev[i] = p.getEv(static_cast<STAT>(i));
+    }
+    const vector<const MoveTemplate *> &templates = p.getMoveTemplates();
+    vector<const MoveTemplate *>::const_iterator i = templates.begin();
+    for (; i != templates.end(); ++i) {
+        moves.push_back((*i)->getName());
+    }
+}
+
+Pokemon::PTR PokemonRecord::create(const SpeciesDatabase *data) const {
+    const PokemonSpecies *s = data->getSpecies(species);
+    const PokemonNature *n = PokemonNature::getNature(nature);
+    if (!s || !n) {
+        return Pokemon::PTR();
+    }
+    return Pokemon::PTR(new Pokemon(s, nickname, n, ability, item, iv, ev,
+            level, gender, happiness, shiny, moves, ppUps));
+}
+
+void BattleRecord::write(vector<unsigned char> &data) const {
+    data.insert(data.end(), RECORD_MAGIC,
+            RECORD_MAGIC + sizeof(RECORD_MAGIC));
+    RecordWriter out(data);
+    out << (int32_t)seed << (unsigned char)generation;
+    out << (unsigned char)partySize << (int16_t)metagame;
+    for (int i = 0; i < TEAM_COUNT; ++i) {
+        out << trainer[i];
+    }
+    out << (unsigned char)clauses.size();
+    for (unsigned int i = 0; i < clauses.size(); ++i) {
+        out << clauses[i];
+    }
+    for (int i = 0; i < TEAM_COUNT; ++i) {
+        out << (unsigned char)teams[i].size();
+        for (unsigned int j = 0; j < teams[i].size(); ++j) {
+            writePokemon(out, teams[i][j]);
+        }
+    }
+    out << (int32_t)steps.size();
+    vector<BattleStep>::const_iterator i = steps.begin();
+    for (; i != steps.end(); ++i) {
+        out << (unsigned char)i->type << (unsigned char)i->value;
+        out << (unsigned char)i->turns.size();
+        vector<PokemonTurn>::const_iterator j = i->turns.begin();
+        for (; j != i->turns.end(); ++j) {
+            out << (unsigned char)j->type << (unsigned char)j->id;
+            out << (unsigned char)j->target;
+        }
+    }
+    out << (int32_t)digest << (int32_t)eventCount;
+}
+
+bool BattleRecord::read(const vector<unsigned char> &data) {
+    const unsigned int magic = sizeof(RECORD_MAGIC);
+    if ((data.size() < magic)
+            || !equal(RECORD_MAGIC, RECORD_MAGIC + magic, data.begin())) {
+        return false;
+    }
+    const vector<unsigned char> body(data.begin() + magic, data.end());
+    RecordReader in(body);
+    int32_t seed32, stepCount, digest32, events;
+    int16_t metagame16;
+    unsigned char generation8, party8, count;
+    in >> seed32 >> generation8 >> party8 >> metagame16;
+    seed = seed32;
+    generation = generation8;
+    partySize = party8;
+    metagame = metagame16;
+    for (int i = 0; i < TEAM_COUNT; ++i) {
+        in >> trainer[i];
+    }
+    in >> count;
+    clauses.resize(count);
+    for (int i = 0; i < count; ++i) {
+        in >> clauses[i];
+    }
+    for (int i = 0; i < TEAM_COUNT; ++i) {
+        in >> count;
+        teams[i].resize(count);
+        for (int j = 0; j < count; ++j) {
+            readPokemon(in, teams[i][j]);
+        }
+    }
+    in >> stepCount;
+    steps.clear();
+    for (int i = 0; (i < stepCount) && !in.hasError(); ++i) {
+        unsigned char type, value;
+        in >> type >> value >> count;
+        if (type > BattleStep::S_FORFEIT)
+            return false;
+        // Party and team indices fit in a byte; -1 was stored as 255.
+        steps.push_back(BattleStep(BattleStep::TYPE(type),
+                (value == 0xff) ? -1 : value));
+        vector<PokemonTurn> &turns = steps.back().turns;
+        for (int j = 0; j < count; ++j) {
+            unsigned char tt, id, target;
+            in >> tt >> id >> target;
+            turns.push_back(PokemonTurn(TURN_TYPE(tt),
+                    (id == 0xff) ? -1 : id,
+                    (target == 0xff) ? -1 : target));
+        }
+    }
+    in >> digest32 >> events;
+    digest = digest32;
+    eventCount = events;
+    return !in.hasError() && in.atEnd();
+}
+
+}
@@ -0,0 +1,163 @@
+/*
+ * File:   BattleRecord.h
+ * Author: Catherine
+ *
+ * Created on October 19, 2026, 6:05 PM
+ *
+ * This file is a part of Shoddy Battle.
+ * Copyright (C) 2009  Catherine Fitzpatrick and Benjamin Gwin
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program; if not, visit the Free Software Foundation, Inc.
+ * online at http://gnu.org.
+ */
+
+#ifndef _BATTLE_RECORD_H_
+#define _BATTLE_RECORD_H_
+
+#include <string>
+#include <vector>
+#include "BattleField.h"
+
+namespace shoddybattle {
+
+class SpeciesDatabase;
+
+/**
+ * A running hash of the events that a battle reports through the inform
+ * methods of BattleField. Two runs of a battle made the same decisions if and
+ * only if (in practice) they end with the same digest. Each inform method
+ * feeds the digest with the arguments it was given, before deciding whether
+ * to report the event to anyone.
+ */
+class EventDigest {
+public:
+    EventDigest(): m_hash(2166136261u), m_count(0) { }
+
+    void print(const TextMessage &msg);
+    void victory(const int party);
+    void useMove(Pokemon *p, const int move);
+    void withdraw(Pokemon *p);
+    void sendOut(Pokemon *p);
+    void healthChange(Pokemon *p, const int delta);
+    void setPp(Pokemon *p, const int move, const int pp);
+    void setMove(Pokemon *p, const int idx, const int move, const int pp,
+            const int maxPp);
+    void fainted(Pokemon *p);
+    void statusChange(Pokemon *p, const std::string &id, const bool applied);
+
+    unsigned int getHash() const { return m_hash; }
+    int getCount() const { return m_count; }
+
+private:
+    enum EVENT {
+        E_PRINT,
+        E_VICTORY,
+        E_USE_MOVE,
+        E_WITHDRAW,
+        E_SEND_OUT,
+        E_HEALTH_CHANGE,
+        E_SET_PP,
+        E_SET_MOVE,
+        E_FAINTED,
+        E_STATUS_CHANGE
+    };
+
+    void begin(const EVENT event, Pokemon *p = NULL);
+    void add(const int value);
+    void add(const std::string &value);
+
+    unsigned int m_hash;
+    int m_count;
+};
+
+/**
+ * Everything needed to build a pokemon as it was when the battle began.
+ */
+struct PokemonRecord {
+    int species;
+    std::string nickname;
+    int nature;
+    std::string ability;
+    std::string item;
+    int iv[STAT_COUNT];
+    int ev[STAT_COUNT];
+    int level;
+    int gender;
+    unsigned char happiness;
+    bool shiny;
+    std::vector<std::string> moves;
+    std::vector<int> ppUps;
+
+    PokemonRecord() { }
+    explicit PokemonRecord(const Pokemon &p);
+
+    Pokemon::PTR create(const SpeciesDatabase *data) const;
+};
+
+/**
+ * A single decision made by the players during a battle.
+ */
+struct BattleStep {
+    enum TYPE {
+        S_TURN,         // a full turn, passed to processTurn
+        S_REPLACEMENT,  // replacements for fainted pokemon
+        S_SELECTION,    // an inactive pokemon picked in the middle of a turn
+        S_FORFEIT       // a player left the battle
+    };
+
+    TYPE type;
+    std::vector<PokemonTurn> turns; // S_TURN and S_REPLACEMENT
+    int value;                      // team index, or party for S_FORFEIT
+
+    BattleStep(const TYPE t, const int v = -1): type(t), value(v) { }
+};
+
+/**
+ * A battle reduced to its inputs: the random seed, the teams, the rules and
+ * the decisions made by each player. Feeding a BattleRecord to a ReplayBattle
+ * runs the same battle again.
+ */
+class BattleRecord {
+public:
+    BattleRecord(): seed(0), generation(0), partySize(1), metagame(-1),
+            digest(0), eventCount(0) { }
+
+    unsigned int seed;
+    int generation;
+    int partySize;
+    int metagame;
+    std::string trainer[TEAM_COUNT];
+    std::vector<std::string> clauses;
+    std::vector<PokemonRecord> teams[TEAM_COUNT];
+    std::vector<BattleStep> steps;
+
+    // The EventDigest of the original battle.
+    unsigned int digest;
+    int eventCount;
+
+    /**
+     * Append the binary form of this record to a buffer.
+     */
+    void write(std::vector<unsigned char> &out) const;
+
+    /**
+     * Read a record written by write(). Returns false if the data is not a
+     * valid record.
+     */
+    bool read(const std::vector<unsigned char> &in);
+};
+
+}
+
+#endif
@@ -0,0 +1,172 @@
+/*
+ * File:   DataImage.cpp
+ * Author: Catherine
+ *
+ * Created on October 19, 2026, 10:50 PM
+ *
+ * This file is a part of Shoddy Battle.
+ * Copyright (C) 2009  Catherine Fitzpatrick and Benjamin Gwin
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program; if not, visit the Free Software Foundation, Inc.
+ * online at http://gnu.org.
+ */
+
+#include <fstream>
+#include <sstream>
+#include <cstring>
+#include <cstdio>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "DataImage.h"
+
+using namespace std;
+
+namespace shoddybattle {
+
+namespace {
+
+/**
+ * Identifies a data image, and the version of its format. The version must
+ * be increased whenever the layout written by the loaders changes.
+ */
+const unsigned char IMAGE_MAGIC[] = { 'S', 'B', 'I', 1 };
+
+const size_t HEADER_SIZE = sizeof(IMAGE_MAGIC) + 1 + 8;
+
+void writeHeader(vector<unsigned char> &out, const unsigned char kind,
+        const uint64_t hash) {
+    out.insert(out.end(), IMAGE_MAGIC, IMAGE_MAGIC + sizeof(IMAGE_MAGIC));
+    out.push_back(kind);
+    for (int i = 56; i >= 0; i -= 8) {
+        out.push_back((hash >> i) & 0xff);
+    }
+}
+
+} // anonymous namespace
+
+ImageWriter &ImageWriter::operator<<(const double v) {
+    uint64_t bits;
+    memcpy(&bits, &v, sizeof(bits));
+    return *this << (int32_t)(bits >> 32) << (int32_t)bits;
+}
+
+ImageReader &ImageReader::operator>>(double &v) {
+    int32_t high, low;
+    *this >> high >> low;
+    const uint64_t bits = ((uint64_t)(uint32_t)high << 32) | (uint32_t)low;
+    memcpy(&v, &bits, sizeof(v));
+    return *this;
+}
+
+string DataImage::getPath(const string &xml) {
+    return xml + ".img";
+}
+
+/**
+ * Hash the contents of a file with 64-bit FNV-1a.
+ */
+bool DataImage::hashFile(const string &file, uint64_t &hash) {
+    ifstream in(file.c_str(), ios::in | ios::binary);
+    if (!in)
+        return false;
+    hash = 14695981039346656037ULL;
+    char buffer[65536];
+    while (in) {
+        in.read(buffer, sizeof(buffer));
+        const streamsize count = in.gcount();
+        for (streamsize i = 0; i < count; ++i) {
+            hash = (hash ^ (unsigned char)buffer[i]) * 1099511628211ULL;
+        }
+    }
+    return true;
+}
+
+DataImage::DataImage(const string &xml, const unsigned char kind):
+        m_map(NULL),
+        m_mapSize(0),
+        m_data(NULL),
+        m_size(0) {
+    uint64_t hash;
+    if (!hashFile(xml, hash))
+        return;
+    const int fd = open(getPath(xml).c_str(), O_RDONLY);
+    if (fd == -1)
+        return;
+    struct stat info;
+    if ((fstat(fd, &info) == 0) && (size_t(info.st_size) >= HEADER_SIZE)) {
+        void *map = mmap(NULL, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        if (map != MAP_FAILED) {
+            m_map = map;
+            m_mapSize = info.st_size;
+        }
+    }
+    close(fd);
+    if (!m_map)
+        return;
+
+    vector<unsigned char> header;
+    writeHeader(header, kind, hash);
+    if (memcmp(m_map, &header[0], HEADER_SIZE) != 0) {
+        // The XML has changed since the image was compiled.
+        munmap(m_map, m_mapSize);
+        m_map = NULL;
+        return;
+    }
+    m_data = static_cast<const unsigned char *>(m_map) + HEADER_SIZE;
+    m_size = m_mapSize - HEADER_SIZE;
+}
+
+DataImage::~DataImage() {
+    if (m_map) {
+        munmap(m_map, m_mapSize);
+    }
+}
+
+bool DataImage::write(const string &xml, const unsigned char kind,
+        const vector<unsigned char> &data) {
+    uint64_t hash;
+    if (!hashFile(xml, hash))
+        return false;
+    vector<unsigned char> header;
+    writeHeader(header, kind, hash);
+
+    const string path = getPath(xml);
+    stringstream ss;
+    ss << path << "." << getpid();
+    const string temp = ss.str();
+    {
+        ofstream out(temp.c_str(), ios::out | ios::binary | ios::trunc);
+        if (!out)
+            return false;
+        out.write((const char *)&header[0], header.size());
+        if (!data.empty()) {
+            out.write((const char *)&data[0], data.size());
+        }
+        if (!out) {
+            out.close();
+            remove(temp.c_str());
+            return false;
+        }
+    }
+    if (rename(temp.c_str(), path.c_str()) != 0) {
+        remove(temp.c_str());
+        return false;
+    }
+    return true;
+}
+
+}
@@ -0,0 +1,153 @@
+/*
+ * File:   DataImage.h
+ * Author: Catherine
+ *
+ * Created on October 19, 2026, 10:50 PM
+ *
+ * This file is a part of Shoddy Battle.
+ * Copyright (C) 2009  Catherine Fitzpatrick and Benjamin Gwin
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program; if not, visit the Free Software Foundation, Inc.
+ * online at http://gnu.org.
+ */
+
+#ifndef _DATA_IMAGE_H_
+#define _DATA_IMAGE_H_
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include <boost/utility.hpp>
+
+namespace shoddybattle {
+
+/**
+ * A compiled copy of one of the XML data files. The image starts with a
+ * magic number, the version of its format and a hash of the XML it was
+ * compiled from; an image whose XML has changed since is ignored, and the
+ * XML is parsed (and compiled again) instead.
+ *
+ * Images are written next to their XML files and are memory mapped when they
+ * are read, so server processes on the same host share the pages while they
+ * load.
+ */
+class DataImage : boost::noncopyable {
+public:
+    /**
+     * Map the image compiled from an XML file, if it is current.
+     */
+    DataImage(const std::string &xml, const unsigned char kind);
+    ~DataImage();
+
+    bool isValid() const { return (m_data != NULL); }
+    const unsigned char *getData() const { return m_data; }
+    size_t getSize() const { return m_size; }
+
+    /**
+     * Write the image for an XML file. The image is written to a temporary
+     * file and then renamed, so a process never maps a partial image.
+     */
+    static bool write(const std::string &xml, const unsigned char kind,
+            const std::vector<unsigned char> &data);
+
+private:
+    static std::string getPath(const std::string &xml);
+    static bool hashFile(const std::string &file, uint64_t &hash);
+
+    void *m_map;
+    size_t m_mapSize;
+    const unsigned char *m_data;
+    size_t m_size;
+};
+
+/**
+ * Writes integers in network byte order and strings prefixed with their
+ * lengths.
+ */
+class ImageWriter {
+public:
+    ImageWriter(std::vector<unsigned char> &out): m_out(out) { }
+    ImageWriter &operator<<(const unsigned char v) {
+        m_out.push_back(v);
+        return *this;
+    }
+    ImageWriter &operator<<(const int32_t v) {
+        for (int i = 24; i >= 0; i -= 8) {
+            m_out.push_back((v >> i) & 0xff);
+        }
+        return *this;
+    }
+    ImageWriter &operator<<(const double v);
+    ImageWriter &operator<<(const std::string &v) {
+        *this << (int32_t)v.size();
+        m_out.insert(m_out.end(), v.begin(), v.end());
+        return *this;
+    }
+private:
+    std::vector<unsigned char> &m_out;
+};
+
+/**
+ * Reads what an ImageWriter wrote. Reading past the end of the data sets the
+ * error flag and yields zeroes.
+ */
+class ImageReader {
+public:
+    ImageReader(const unsigned char *data, const size_t size):
+            m_data(data), m_size(size), m_pos(0), m_error(false) { }
+    bool hasError() const { return m_error; }
+    bool atEnd() const { return (m_pos == m_size); }
+    ImageReader &operator>>(unsigned char &v) {
+        v = available(1) ? m_data[m_pos++] : 0;
+        return *this;
+    }
+    ImageReader &operator>>(int32_t &v) {
+        v = 0;
+        if (available(4)) {
+            for (int i = 0; i < 4; ++i) {
+                v = (v << 8) | m_data[m_pos++];
+            }
+        }
+        return *this;
+    }
+    ImageReader &operator>>(double &v);
+    ImageReader &operator>>(std::string &v) {
+        int32_t length;
+        *this >> length;
+        if ((length >= 0) && available(length)) {
+            v.assign((const char *)m_data + m_pos, length);
+            m_pos += length;
+        } else {
+            v.clear();
+        }
+        return *this;
+    }
+private:
+    bool available(const size_t size) {
+        if (m_size - m_pos < size) {
+            m_error = true;
+            m_pos = m_size;
+            return false;
+        }
+        return true;
+    }
+    const unsigned char *m_data;
+    const size_t m_size;
+    size_t m_pos;
+    bool m_error;
+};
+
+}
+
+#endif
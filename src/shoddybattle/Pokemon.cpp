@@ -26,6 +26,7 @@
 #include <list>
 #include <sstream>
 #include <boost/bind.hpp>
+#include <boost/make_shared.hpp>
 
 #include "Pokemon.h"
 #include "PokemonSpecies.h"
@@ -36,6 +37,7 @@
 #include "../scripting/ScriptMachine.h"
 #include "../main/Log.h"
 #include "BattleField.h"
+#include "BattleArena.h"
 #include "ObjectTeamFile.h"
 
 using namespace shoddybattle;
@@ -44,6 +46,20 @@ using namespace boost;
 
 namespace shoddybattle {
 
+/**
+ * The parts of a pokemon that are only needed to set it up for a battle, to
+ * record it, or to print its name.
+ */
+struct PokemonDetails {
+    std::string nickname;
+    std::string itemName;
+    std::string abilityName;
+    unsigned int iv[STAT_COUNT];
+    unsigned int ev[STAT_COUNT];
+    std::vector<int> ppUps;
+    std::vector<const MoveTemplate *> moveProto;
+};
+
 Pokemon::Pokemon(const PokemonSpecies *species,
         const string &nickname,
         const PokemonNature *nature,
@@ -56,36 +72,81 @@ Pokemon::Pokemon(const PokemonSpecies *species,
         const unsigned char happiness,
         const bool shiny,
         const vector<string> &moves,
+        const vector<int> &ppUps):
+        m_details(new PokemonDetails()) {
+    construct(species, nickname, nature, ability, item, iv, ev, level,
+            gender, happiness, shiny, ppUps);
+    vector<string>::const_iterator i = moves.begin();
+    for (; i != moves.end(); ++i) {
+        const MoveTemplate *move = species->getMove(*i);
+        if (move) {
+            m_details->moveProto.push_back(move);
+        }
+    }
+}
+
+/**
+ * Construct a pokemon from moves that have already been looked up, such as
+ * moves sent by ID from a client. Moves the species cannot learn are skipped,
+ * as they are by the other constructor.
+ */
+Pokemon::Pokemon(const PokemonSpecies *species,
+        const string &nickname,
+        const PokemonNature *nature,
+        const string &ability,
+        const string &item,
+        const int *iv,
+        const int *ev,
+        const int level,
+        const int gender,
+        const unsigned char happiness,
+        const bool shiny,
+        const vector<const MoveTemplate *> &moves,
+        const vector<int> &ppUps):
+        m_details(new PokemonDetails()) {
+    construct(species, nickname, nature, ability, item, iv, ev, level,
+            gender, happiness, shiny, ppUps);
+    vector<const MoveTemplate *>::const_iterator i = moves.begin();
+    for (; i != moves.end(); ++i) {
+        const MoveTemplate *move = *i;
+        if (move && species->canLearn(move->getId())) {
+            m_details->moveProto.push_back(move);
+        }
+    }
+}
+
+void Pokemon::construct(const PokemonSpecies *species,
+        const string &nickname,
+        const PokemonNature *nature,
+        const string &ability,
+        const string &item,
+        const int *iv,
+        const int *ev,
+        const int level,
+        const int gender,
+        const unsigned char happiness,
+        const bool shiny,
         const vector<int> &ppUps) {
-    memcpy(m_iv, iv, sizeof(int) * STAT_COUNT);
-    memcpy(m_ev, ev, sizeof(int) * STAT_COUNT);
+    memcpy(m_details->iv, iv, sizeof(int) * STAT_COUNT);
+    memcpy(m_details->ev, ev, sizeof(int) * STAT_COUNT);
     memset(m_statLevel, 0, sizeof(int) * TOTAL_STAT_COUNT);
     m_species = species;
-    m_nickname = nickname;
-    if (m_nickname.empty()) {
-        m_nickname = m_species->getSpeciesName();
-    } else if (m_nickname.length() > 19) {
-        m_nickname = m_nickname.substr(0, 19);
+    string &name = m_details->nickname;
+    name = nickname;
+    if (name.empty()) {
+        name = m_species->getSpeciesName();
+    } else if (name.length() > 19) {
+        name = name.substr(0, 19);
     }
     m_nature = nature;
     m_types = species->getTypes();
     m_level = level;
     m_gender = gender;
     m_happiness = happiness;
-    m_ppUps = ppUps;
-    m_abilityName = ability;
-    m_itemName = item;
+    m_details->ppUps = ppUps;
+    m_details->abilityName = ability;
+    m_details->itemName = item;
     m_shiny = shiny;
-    vector<string>::const_iterator i = moves.begin();
-    for (; i != moves.end(); ++i) {
-        const MoveTemplate *move = species->getMove(*i);
-        if (move) {
-            m_moveProto.push_back(move);
-        }
-    }
-    m_pp.resize(m_moveProto.size());
-    m_maxPp.resize(m_pp.size());
-    m_moveUsed.resize(m_moveProto.size(), false);
     m_machine = NULL;
     m_cx = NULL;
     m_field = NULL;
@@ -98,12 +159,66 @@ Pokemon::Pokemon(const PokemonSpecies *species,
     m_turn = NULL;
 }
 
+Pokemon::~Pokemon() { }
+
+string Pokemon::getName() const {
+    return m_details->nickname;
+}
+
+unsigned int Pokemon::getIv(const STAT i) const {
+    return m_details->iv[i];
+}
+
+unsigned int Pokemon::getEv(const STAT i) const {
+    return m_details->ev[i];
+}
+
+const vector<int> &Pokemon::getPpUps() const {
+    return m_details->ppUps;
+}
+
+const vector<const MoveTemplate *> &Pokemon::getMoveTemplates() const {
+    return m_details->moveProto;
+}
+
 string Pokemon::getToken() const {
     stringstream ss;
     ss << "$p{" << getParty() << "," << getPosition() << "}";
     return ss.str();
 }
 
+/**
+ * Get a string that identifies everything the player chose about this
+ * pokemon. Two pokemon with the same signature pass or fail validation in
+ * the same way.
+ */
+string Pokemon::getSignature() const {
+    stringstream ss;
+    const PokemonDetails &d = *m_details;
+    ss << getSpeciesId() << ","
+            << (m_nature ? int(m_nature->getInternalValue()) : -1) << ","
+            << m_level << "," << m_gender << "," << int(m_happiness) << ","
+            << m_shiny << ",";
+    for (int i = 0; i < STAT_COUNT; ++i) {
+        ss << d.iv[i] << "," << d.ev[i] << ",";
+    }
+    // Strings are prefixed with their lengths so that they cannot run into
+    // each other.
+    ss << d.nickname.length() << ":" << d.nickname
+            << d.itemName.length() << ":" << d.itemName
+            << d.abilityName.length() << ":" << d.abilityName;
+    ss << "[";
+    for (size_t i = 0; i < d.moveProto.size(); ++i) {
+        ss << d.moveProto[i]->getId() << ",";
+    }
+    ss << "][";
+    for (size_t i = 0; i < d.ppUps.size(); ++i) {
+        ss << d.ppUps[i] << ",";
+    }
+    ss << "]";
+    return ss.str();
+}
+
 double Pokemon::getMass() const {
     return m_species->getMass();
 }
@@ -141,7 +256,7 @@ string Pokemon::getItemName() const {
     if (item) {
         return item->getName(m_cx);
     }
-    return m_itemName;
+    return m_details->itemName;
 }
 
 string Pokemon::getAbilityName() const {
@@ -149,7 +264,7 @@ string Pokemon::getAbilityName() const {
     if (ability) {
         return ability->getName(m_cx);
     }
-    return m_abilityName;
+    return m_details->abilityName;
 }
 
 /**
@@ -171,13 +286,12 @@ void Pokemon::determineLegalActions() {
     m_legalSwitch = !m_field->vetoSwitch(this);
 
     bool struggle = true;
-    const int count = m_moves.size();
-    m_legalMove.clear();
-    m_legalMove.resize(count, false);
-    for (int i = 0; i < count; ++i) {
-        MoveObjectPtr move = m_moves[i];
-        if (move && (m_pp[i] > 0)) {
-            if (m_legalMove[i] = !m_field->vetoSelection(this, move.get())) {
+    vector<MOVE_SLOT>::iterator i = m_slots.begin();
+    for (; i != m_slots.end(); ++i) {
+        i->legal = false;
+        MoveObject *move = i->move.get();
+        if (move && (i->pp > 0)) {
+            if (i->legal = !m_field->vetoSelection(this, move)) {
                 struggle = false;
             }
         }
@@ -198,15 +312,14 @@ ScriptValue Pokemon::sendMessage(const string &name,
         int argc, ScriptValue *argv) {
     ScriptValue ret;
     bool failed = true;
-    for (STATUSES::const_iterator i = m_effects.begin();
-            i != m_effects.end(); ++i) {
-        if (!(*i)->isActive(m_cx))
+    const StatusList::INDEX &hook = m_effects.getHook(name, m_cx);
+    for (unsigned int i = 0; i < hook.size(); ++i) {
+        StatusObject *effect = m_effects[hook[i]];
+        if (!effect || !effect->isActive(m_cx))
             continue;
 
-        if (m_cx->hasProperty(i->get(), name)) {
-            ret = m_cx->callFunctionByName(i->get(), name, argc, argv);
-            failed = false;
-        }
+        ret = m_cx->callFunctionByName(effect, name, argc, argv);
+        failed = false;
     }
     if (failed) {
         ret.setFailure();
@@ -218,27 +331,37 @@ ScriptValue Pokemon::sendMessage(const string &name,
  * Get additional immunities or vulnerabilities in play for a given user
  * attacking a given target.
  */
-void Pokemon::getImmunities(Pokemon *user, Pokemon *target,
-        std::set<const PokemonType *> &immunities,
-        std::set<const PokemonType *> &vulnerabilities) {
-    for (STATUSES::const_iterator i = m_effects.begin();
-            i != m_effects.end(); ++i) {
-        if (!(*i)->isActive(m_cx))
+bool Pokemon::getImmunities(Pokemon *user, Pokemon *target,
+        TYPE_SET &immunities, TYPE_SET &vulnerabilities) {
+    const StatusList::INDEX &hook = m_effects.getHook(StatusList::H_IMMUNITY);
+    for (unsigned int i = 0; i < hook.size(); ++i) {
+        StatusObject *effect = m_effects[hook[i]];
+        if (!effect || !effect->isActive(m_cx))
             continue;
 
-        const PokemonType *type = (*i)->getImmunity(m_cx, user, target);
+        const PokemonType *type = effect->getImmunity(m_cx, user, target);
         if (type) {
-            immunities.insert(type);
+            immunities |= type->getBit();
         }
-        type = (*i)->getVulnerability(m_cx, user, target);
+        type = effect->getVulnerability(m_cx, user, target);
         if (type) {
-            if (immunities.find(type) != immunities.end()) {
-                immunities.erase(type);
+            const TYPE_SET bit = type->getBit();
+            if (immunities & bit) {
+                immunities &= ~bit;
             } else {
-                vulnerabilities.insert(type);
+                vulnerabilities |= bit;
             }
         }
     }
+
+    const StatusList::INDEX &transforms =
+            m_effects.getHook(StatusList::H_TRANSFORM_EFFECTIVENESS);
+    for (unsigned int i = 0; i < transforms.size(); ++i) {
+        StatusObject *effect = m_effects[transforms[i]];
+        if (effect && effect->isActive(m_cx))
+            return true;
+    }
+    return false;
 }
 
 /**
@@ -249,11 +372,13 @@ bool Pokemon::getTransformedEffectiveness(const PokemonType *moveType,
     effectiveness = moveType->getMultiplier(*type);
     // The behaviour if more than one transform really isn't defined,
     // so I'll just stop after the first one.
-    for (STATUSES::const_iterator i = m_effects.begin();
-            i != m_effects.end(); ++i) {
-        if (!(*i)->isActive(m_cx))
+    const StatusList::INDEX &hook =
+            m_effects.getHook(StatusList::H_TRANSFORM_EFFECTIVENESS);
+    for (unsigned int i = 0; i < hook.size(); ++i) {
+        StatusObject *effect = m_effects[hook[i]];
+        if (!effect || !effect->isActive(m_cx))
             continue;
-        if ((*i)->transformEffectiveness(m_cx, moveType->getTypeValue(),
+        if (effect->transformEffectiveness(m_cx, moveType->getTypeValue(),
                 type->getTypeValue(), target, &effectiveness)) {
             return true;
         }
@@ -265,12 +390,14 @@ bool Pokemon::getTransformedEffectiveness(const PokemonType *moveType,
  * Determine whether the selection of a move should be vetoed.
  */
 bool Pokemon::vetoSelection(Pokemon *user, MoveObject *move) {
-    for (STATUSES::const_iterator i = m_effects.begin();
-            i != m_effects.end(); ++i) {
-        if (!(*i)->isActive(m_cx))
+    const StatusList::INDEX &hook =
+            m_effects.getHook(StatusList::H_VETO_SELECTION);
+    for (unsigned int i = 0; i < hook.size(); ++i) {
+        StatusObject *effect = m_effects[hook[i]];
+        if (!effect || !effect->isActive(m_cx))
             continue;
 
-        if ((*i)->vetoSelection(m_cx, user, move))
+        if (effect->vetoSelection(m_cx, user, move))
             return true;
     }
     return false;
@@ -291,8 +418,17 @@ bool vetoExecutionPredicate(ScriptContext *cx,
  * the effects on this pokemon.
  */
 bool Pokemon::vetoExecution(Pokemon *user, Pokemon *target, MoveObject *move) {
+    // Only effects which implement vetoExecution can veto anything, so there
+    // is no need to read the veto tier of the others.
+    const StatusList::INDEX &hook =
+            m_effects.getHook(StatusList::H_VETO_EXECUTION);
     vector<StatusObjectPtr> effects;
-    effects.insert(effects.begin(), m_effects.begin(), m_effects.end());
+    for (unsigned int i = 0; i < hook.size(); ++i) {
+        const StatusObjectPtr &effect = m_effects.getSlot(hook[i]);
+        if (effect) {
+            effects.push_back(effect);
+        }
+    }
     sort(effects.begin(), effects.end(),
             boost::bind(vetoExecutionPredicate, m_cx, _1, _2));
     for (vector<StatusObjectPtr>::const_iterator i = effects.begin();
@@ -311,6 +447,9 @@ bool Pokemon::vetoExecution(Pokemon *user, Pokemon *target, MoveObject *move) {
  */
 void Pokemon::switchIn() {
     m_acted = false;
+    // Nothing is walking the effects of a pokemon that is only now coming
+    // in, so this is a safe point to squeeze out tombstones.
+    m_effects.compact();
     // Inform status effects of switching in.
     for (STATUSES::const_iterator i = m_effects.begin();
             i != m_effects.end(); ++i) {
@@ -341,9 +480,10 @@ bool switchOutPredicate(StatusObjectPtr effect, ScriptContext *cx) {
  */
 void Pokemon::switchOut() {
     // Remove effects that do not survive switches.
-    removeStatuses(m_effects, boost::bind(switchOutPredicate, _1, m_cx));   
+    removeStatuses(m_effects, m_schedule,
+            boost::bind(switchOutPredicate, _1, m_cx));
     // Restore original ability.
-    setAbility(m_abilityName);
+    setAbility(m_details->abilityName);
     // Restore original type.
     m_types = m_species->getTypes();
     // Remove any forced moves
@@ -352,8 +492,10 @@ void Pokemon::switchOut() {
     m_slot = -1;
     // Clear this pokemon's memory.
     m_memory.clear();
-    m_moveUsed.clear();
-    m_moveUsed.resize(m_moves.size(), false);
+    vector<MOVE_SLOT>::iterator i = m_slots.begin();
+    for (; i != m_slots.end(); ++i) {
+        i->used = false;
+    }
     m_lastMove.reset();
     m_acted = false;
     m_damaged = false;
@@ -443,7 +585,10 @@ void Pokemon::setForcedTurn(const PokemonTurn &turn) {
  */
 void Pokemon::setForcedTurn(const PokemonTurn &turn, const FORCED_TYPE type) {
     m_forcedType = type;
-    m_forcedTurn = shared_ptr<PokemonTurn>(new PokemonTurn(turn));
+    // The forced turn is only used by the battle thread, so it comes from the
+    // battle's arena. It is released when the battle ends.
+    m_forcedTurn = allocate_shared<PokemonTurn>(
+            ArenaAllocator<PokemonTurn>(m_field->getArena()), turn);
 }
 
 /**
@@ -470,9 +615,9 @@ Pokemon::FORCED_TYPE Pokemon::getForcedType() const {
  * Get the index of a named move, -1 if the pokemon does not know the move.
  */
 int Pokemon::getMove(const string &name) const {
-    const int size = m_moves.size();
+    const int size = m_slots.size();
     for (int i = 0; i < size; ++i) {
-        if (m_moves[i]->getName(m_cx) == name)
+        if (m_slots[i].move->getName(m_cx) == name)
             return i;
     }
     return -1;
@@ -483,11 +628,14 @@ int Pokemon::getMove(const string &name) const {
  */
 bool Pokemon::getTransformedStatLevel(Pokemon *user, Pokemon *target,
         STAT stat, int *level) {
-    for (STATUSES::iterator i = m_effects.begin(); i != m_effects.end(); ++i) {
-        if ((*i)->isRemovable(m_cx))
+    const StatusList::INDEX &hook =
+            m_effects.getHook(StatusList::H_TRANSFORM_STAT_LEVEL);
+    for (unsigned int i = 0; i < hook.size(); ++i) {
+        StatusObject *effect = m_effects[hook[i]];
+        if (!effect || effect->isRemovable(m_cx))
             continue;
 
-        if ((*i)->transformStatLevel(m_cx, user, target, stat, level))
+        if (effect->transformStatLevel(m_cx, user, target, stat, level))
             return true;
     }
     return false;
@@ -507,8 +655,7 @@ unsigned int Pokemon::getStat(const STAT stat) {
     int value = getRawStat(stat);
     PRIORITY_MAP::const_iterator i = mods.begin();
     for (; i != mods.end(); ++i) {
-        double val = i->second;
-        value *= val;
+        value = i->second.apply(value);
     }
     return value;
 }
@@ -519,10 +666,10 @@ unsigned int Pokemon::getStat(const STAT stat) {
 MoveObjectPtr Pokemon::getMove(const int i) {
     if (i == -1)
         return m_forcedMove;
-    const int size = m_moves.size();
+    const int size = m_slots.size();
     if (size <= i)
         return MoveObjectPtr();
-    return m_moves[i];
+    return m_slots[i].move;
 }
 
 /**
@@ -631,16 +778,15 @@ void Pokemon::removeMemory(Pokemon *pokemon) {
  */
 void Pokemon::setMove(const int i, MoveObjectPtr move,
         const int pp, const int maxPp) {
-    const int size = m_moves.size();
+    const int size = m_slots.size();
     if (size <= i) {
-        m_moves.resize(i + 1, MoveObjectPtr());
-        m_pp.resize(i + 1, 0);
-        m_maxPp.resize(i + 1, 0);
-        m_moveUsed.resize(i + 1, false);
-    }
-    m_moves[i] = move;
-    m_pp[i] = pp;
-    m_maxPp[i] = maxPp;
+        const MOVE_SLOT empty = { MoveObjectPtr(), 0, 0, false, false };
+        m_slots.resize(i + 1, empty);
+    }
+    MOVE_SLOT &slot = m_slots[i];
+    slot.move = move;
+    slot.pp = pp;
+    slot.maxPp = maxPp;
     if (m_field) {
         const int id = move->getTemplate(m_cx)->getId();
         m_field->informSetMove(this, i, id, pp, maxPp);
@@ -666,8 +812,31 @@ void Pokemon::setMove(const int i, const string &name,
  * Remove defunct statuses from this pokemon.
  */
 void Pokemon::removeStatuses() {
-    removeStatuses(m_effects,
+    removeStatuses(m_effects, m_schedule,
             boost::bind(&StatusObject::isRemovable, _1, m_cx));
+    m_effects.compact();
+}
+
+namespace {
+
+bool tickEntryComparator(const TickEntry &e1, const TickEntry &e2) {
+    if (e1.tier != e2.tier) {
+        return (e1.tier < e2.tier);
+    }
+    return (e1.subtier < e2.subtier);
+}
+
+} // anonymous namespace
+
+/**
+ * Add an effect to an end of turn schedule. An effect goes after any others
+ * that have the same tier and subtier.
+ */
+void Pokemon::scheduleEffect(TICK_SCHEDULE &schedule,
+        StatusObjectPtr effect, ScriptContext *cx) {
+    TickEntry entry = { effect, effect->getTier(cx), effect->getSubtier(cx) };
+    schedule.insert(upper_bound(schedule.begin(), schedule.end(), entry,
+            tickEntryComparator), entry);
 }
 
 /**
@@ -709,7 +878,8 @@ StatusObjectPtr Pokemon::applyStatus(Pokemon *inducer, StatusObject *effect) {
         return StatusObjectPtr();
     }
 
-    m_effects.push_back(applied);
+    m_effects.push_back(applied, m_cx);
+    scheduleEffect(m_schedule, applied, m_cx);
 
     ScriptValue val[] = { applied.get(), inducer };
     sendMessage("informEffectApplied", 2, val);
@@ -723,12 +893,14 @@ StatusObjectPtr Pokemon::applyStatus(Pokemon *inducer, StatusObject *effect) {
  * Transform a StatusEffect.
  */
 bool Pokemon::transformStatus(Pokemon *subject, StatusObjectPtr *status) {
-    for (STATUSES::const_iterator i = m_effects.begin();
-            i != m_effects.end(); ++i) {
-        if (!(*i)->isActive(m_cx))
+    const StatusList::INDEX &hook =
+            m_effects.getHook(StatusList::H_TRANSFORM_STATUS);
+    for (unsigned int i = 0; i < hook.size(); ++i) {
+        StatusObject *effect = m_effects[hook[i]];
+        if (!effect || !effect->isActive(m_cx))
             continue;
 
-        if ((*i)->transformStatus(m_cx, subject, status)) {
+        if (effect->transformStatus(m_cx, subject, status)) {
             if (*status == NULL) {
                 return true;
             }
@@ -768,12 +940,14 @@ int Pokemon::getCriticalModifier() const {
  * Transform a health change.
  */
 int Pokemon::transformHealthChange(int hp, Pokemon *user, bool indirect) const {
-    for (STATUSES::const_iterator i = m_effects.begin();
-            i != m_effects.end(); ++i) {
-        if (!(*i)->isActive(m_cx))
+    const StatusList::INDEX &hook =
+            m_effects.getHook(StatusList::H_TRANSFORM_HEALTH_CHANGE);
+    for (unsigned int i = 0; i < hook.size(); ++i) {
+        StatusObject *effect = m_effects[hook[i]];
+        if (!effect || !effect->isActive(m_cx))
             continue;
 
-        (*i)->transformHealthChange(m_cx, hp, user, indirect, &hp);
+        effect->transformHealthChange(m_cx, hp, user, indirect, &hp);
     }
     return hp;
 }
@@ -803,11 +977,15 @@ int Pokemon::getInherentPriority() const {
 void Pokemon::getStatModifiers(STAT stat,
         Pokemon *subject, Pokemon *target, PRIORITY_MAP &mods) {
     MODIFIER mod;
-    for (STATUSES::iterator i = m_effects.begin(); i != m_effects.end(); ++i) {
-        if (!(*i)->isActive(m_cx))
+    const StatusList::INDEX &hook =
+            m_effects.getHook(StatusList::H_STAT_MODIFIER);
+    for (unsigned int i = 0; i < hook.size(); ++i) {
+        StatusObject *effect = m_effects[hook[i]];
+        if (!effect || !effect->isActive(m_cx))
             continue;
 
-        if ((*i)->getStatModifier(m_cx, m_field, stat, subject, target, mod)) {
+        if (effect->getStatModifier(m_cx, m_field,
+                stat, subject, target, mod)) {
             // position unused
             mods[mod.priority] = mod.value;
         }
@@ -821,13 +999,15 @@ void Pokemon::getModifiers(Pokemon *user, Pokemon *target,
         MoveObject *obj, const bool critical, const int targets,
         MODIFIERS &mods) {
     MODIFIER mod;
-    for (STATUSES::iterator i = m_effects.begin(); i != m_effects.end(); ++i) {
-        if (!(*i)->isActive(m_cx))
+    const StatusList::INDEX &hook = m_effects.getHook(StatusList::H_MODIFIER);
+    for (unsigned int i = 0; i < hook.size(); ++i) {
+        StatusObject *effect = m_effects[hook[i]];
+        if (!effect || !effect->isActive(m_cx))
             continue;
 
-        if ((*i)->getModifier(m_cx, m_field,
+        if (effect->getModifier(m_cx, m_field,
                 user, target, obj, critical, targets, mod)) {
-            mods[mod.position][mod.priority] = mod.value;
+            mods.set(mod.position, mod.priority, mod.value);
         }
     }
 }
@@ -924,11 +1104,14 @@ void Pokemon::informDamaged(Pokemon *user, MoveObjectPtr move, int damage) {
  * Inform that this pokemon was targeted by a move.
  */
 void Pokemon::informTargeted(Pokemon *user, MoveObjectPtr move) {
-    for (STATUSES::iterator i = m_effects.begin(); i != m_effects.end(); ++i) {
-        if (!(*i)->isActive(m_cx))
+    const StatusList::INDEX &hook =
+            m_effects.getHook(StatusList::H_INFORM_TARGETED);
+    for (unsigned int i = 0; i < hook.size(); ++i) {
+        StatusObject *effect = m_effects[hook[i]];
+        if (!effect || !effect->isActive(m_cx))
             continue;
 
-        (*i)->informTargeted(m_cx, user, move.get());
+        effect->informTargeted(m_cx, user, move.get());
     }
 
     if (move->getFlag(m_cx, F_MEMORABLE)) {
@@ -1001,9 +1184,9 @@ void Pokemon::setLevel(const int level) {
 void Pokemon::deductPp(MoveObjectPtr move) {
     void *p = move->getObject();
     int j = 0;
-    vector<MoveObjectPtr>::const_iterator i = m_moves.begin();
-    for (; i != m_moves.end(); ++i) {
-        if (p == (*i)->getObject()) {
+    vector<MOVE_SLOT>::const_iterator i = m_slots.begin();
+    for (; i != m_slots.end(); ++i) {
+        if (p == i->move->getObject()) {
             deductPp(j);
             return;
         }
@@ -1015,22 +1198,20 @@ void Pokemon::deductPp(MoveObjectPtr move) {
  * Set a move's remaining PP to an arbitrary value.
  */
 void Pokemon::setPp(const int i, const int pp) {
-    m_pp[i] = pp;
-    if (m_pp[i] < 0) {
-        m_pp[i] = 0;
-    }
-    m_field->informSetPp(this, i, m_pp[i]);
+    MOVE_SLOT &slot = m_slots[i];
+    slot.pp = (pp < 0) ? 0 : pp;
+    m_field->informSetPp(this, i, slot.pp);
 }
 
 /**
  * Deduct PP from a move slot.
  */
 void Pokemon::deductPp(const int i) {
-    if ((i < 0) || (i >= m_pp.size())) {
+    if ((i < 0) || (static_cast<size_t>(i) >= m_slots.size())) {
         return;
     }
-    setPp(i, m_pp[i] - 1);
-    m_moveUsed[i] = true;
+    setPp(i, m_slots[i].pp - 1);
+    m_slots[i].used = true;
 }
 
 void Pokemon::initialise(BattleField *field, ScriptContextPtr cx,
@@ -1062,87 +1243,25 @@ void Pokemon::initialise(BattleField *field, ScriptContextPtr cx,
     m_object = m_cx->newPokemonObject(this);
 
     // Create move objects.
-    if (m_moves.empty()) {
-        vector<const MoveTemplate *>::const_iterator i = m_moveProto.begin();
-        int j = 0;
-        for (; i != m_moveProto.end(); ++i) {
-            MoveObjectPtr obj = m_cx->newMoveObject(*i);
-            m_moves.push_back(obj);
-            m_maxPp[j] = m_pp[j] = obj->getPp(m_cx) * (5 + m_ppUps[j]) / 5;
-            ++j;
+    if (m_slots.empty()) {
+        const vector<const MoveTemplate *> &proto = m_details->moveProto;
+        const vector<int> &ppUps = m_details->ppUps;
+        m_slots.reserve(proto.size());
+        for (size_t j = 0; j < proto.size(); ++j) {
+            MoveObjectPtr obj = m_cx->newMoveObject(proto[j]);
+            const int pp = obj->getPp(m_cx) * (5 + ppUps[j]) / 5;
+            const MOVE_SLOT slot = { obj, short(pp), short(pp), false, false };
+            m_slots.push_back(slot);
         }
     }
 
     // Create ability and item objects.
     if (field) {
-        setAbility(m_abilityName);
-        if (!m_itemName.empty()) {
-            setItem(m_itemName);
-        }
-    }
-}
-
-/**
- * Checks a pokemon for legal move combinations.
- */
-namespace {
-bool validateMoveCombinations(ScriptContext *cx, const PokemonSpecies *species,
-        Pokemon *p, const vector<MoveObjectPtr> &moves) {
-    COMBINATION_LIST list = species->getIllegalCombinations();
-    COMBINATION_LIST::iterator i = list.begin();
-
-    // This loop is triple nested, but the only loop of
-    // substantional size is the outer one
-    for (; i != list.end(); ++i) {
-        bool match = true;
-        Combination combo = *i;
-
-        // Check moves
-        vector<string> illegalMoves = combo.moves;
-        vector<string>::iterator j = illegalMoves.begin();
-        for (; j != illegalMoves.end(); ++j) {
-            const string move = *j;
-
-            bool found = false;
-            vector<MoveObjectPtr>::const_iterator k = moves.begin();
-            for (; k != moves.end(); ++k) {
-                const string name = (*k)->getName(cx);
-                if (name == move) {
-                    found = true;
-                    break;
-                }
-            }
-            if (!found) {
-                match = false;
-                break;
-            }
-        }
-        if (!match) {
-            continue;
-        }
-
-        
-        // Check nature/ability/gender
-        if ((combo.ability.size() != 0) &&
-                (p->getAbilityName() != combo.ability)) {
-            continue;
+        setAbility(m_details->abilityName);
+        if (!m_details->itemName.empty()) {
+            setItem(m_details->itemName);
         }
-        
-        if (combo.nature && (combo.nature != p->getNature())) {
-            continue;
-        }
-        
-        // 0 gender is NONE, pokemon with NONE cannot have any other gender
-        // so we can treat 0 as unspecified
-        if ((combo.gender != 0) && (p->getGender() != combo.gender)) {
-            continue;
-        }
-
-        return false;
     }
-
-    return true;
-}
 }
 
 /**
@@ -1158,36 +1277,44 @@ bool validateMoveCombinations(ScriptContext *cx, const PokemonSpecies *species,
  */
 bool Pokemon::validate(ScriptContext *cx, set<unsigned int> &violations) {
     // Test Condition 0 - 1-4 UNIQUE moves
-    int moveCount = m_moves.size();
+    const vector<const MoveTemplate *> &proto = m_details->moveProto;
+    int moveCount = proto.size();
     if ((moveCount <= 0) || (moveCount > P_MOVE_COUNT)) {
         violations.insert(0);
     }
-    set<string> moves;
-    vector<MoveObjectPtr>::iterator i = m_moves.begin();
-    for (; i != m_moves.end(); ++i) {
-        const string name = (*i)->getName(cx);
-        if (moves.count(name)) {
-            violations.insert(0);
-            break;
-        }
-        moves.insert(name);
+    vector<int> moves;
+    vector<const MoveTemplate *>::const_iterator i = proto.begin();
+    for (; i != proto.end(); ++i) {
+        moves.push_back((*i)->getId());
+    }
+    vector<int> sorted = moves;
+    sort(sorted.begin(), sorted.end());
+    if (adjacent_find(sorted.begin(), sorted.end()) != sorted.end()) {
+        violations.insert(0);
     }
 
     // Test Condition 1 - Legal Learnsets
     // This only happens if there are illegal moves. This is because
     // the constructor skips over moves the pokemon can't learn
-    if (m_moves.size() != m_ppUps.size()) {
+    const vector<int> &ppUps = m_details->ppUps;
+    if (proto.size() != ppUps.size()) {
         violations.insert(1);
     }
 
     // Test Condition 2 - Legal move combinations
-    if (!validateMoveCombinations(cx, m_species, this, m_moves)) {
+    const ABILITY_LIST &abilities = m_species->getAbilities();
+    ABILITY_LIST::const_iterator ability = 
+        find(abilities.begin(), abilities.end(), m_details->abilityName);
+    const int abilityIdx = (ability == abilities.end())
+            ? -1 : (ability - abilities.begin());
+    if (!m_species->isLegalCombination(moves, m_nature, abilityIdx,
+            m_gender)) {
         violations.insert(2);
     }
 
     // Test Condition 3 - 0-3 PP ups
-    vector<int>::iterator j = m_ppUps.begin();
-    for (; j != m_ppUps.end(); ++j) {
+    vector<int>::const_iterator j = ppUps.begin();
+    for (; j != ppUps.end(); ++j) {
         if ((*j < 0) || (*j > 3)) {
             violations.insert(3);
         }
@@ -1197,9 +1324,6 @@ bool Pokemon::validate(ScriptContext *cx, set<unsigned int> &violations) {
     // TODO: Implement item validation
 
     // Test Condition 5 - Ability learnable
-    const ABILITY_LIST &abilities = m_species->getAbilities();
-    ABILITY_LIST::const_iterator ability = 
-        find(abilities.begin(), abilities.end(), m_abilityName);
     if (ability == abilities.end()) {
         violations.insert(5);
     }
@@ -26,6 +26,7 @@
 #define _POKEMON_H_
 
 #include <boost/shared_ptr.hpp>
+#include <boost/scoped_ptr.hpp>
 #include <vector>
 #include <string>
 #include <list>
@@ -33,6 +34,9 @@
 #include <stack>
 #include <set>
 #include "../mechanics/stat.h"
+#include "../mechanics/Modifiers.h"
+#include "../mechanics/PokemonType.h"
+#include "StatusList.h"
 #include "../scripting/ObjectWrapper.h"
 
 namespace shoddybattle {
@@ -43,6 +47,7 @@ class PokemonType;
 class PokemonSpecies;
 class MoveTemplate;
 class PokemonTurn;
+struct PokemonDetails;
 
 class PokemonObject;
 class MoveObject;
@@ -55,11 +60,24 @@ class ScriptValue;
 class Target;
 
 typedef std::vector<const PokemonType *> TYPE_ARRAY;
-typedef std::list<boost::shared_ptr<StatusObject> > STATUSES;
+typedef StatusList STATUSES;
 
-typedef std::map<int, double> PRIORITY_MAP;
-// map<position, map<priority, value>>
-typedef std::map<int, PRIORITY_MAP> MODIFIERS;
+/**
+ * An effect which ticks at the end of each turn, with its tier and subtier
+ * read once when it was applied.
+ */
+struct TickEntry {
+    boost::shared_ptr<StatusObject> effect;
+    double tier;
+    int subtier;
+};
+
+// Sorted by tier and then subtier.
+typedef std::vector<TickEntry> TICK_SCHEDULE;
+
+typedef PriorityMap PRIORITY_MAP;
+// position -> (priority -> value)
+typedef ModifierSet MODIFIERS;
 
 /**
  * The pokemon class contains all of the information about an arbitrary
@@ -91,6 +109,20 @@ public:
             const bool shiny,
             const std::vector<std::string> &moves,
             const std::vector<int> &ppUps);
+    Pokemon(const PokemonSpecies *species,
+            const std::string &nickname,
+            const PokemonNature *nature,
+            const std::string &ability,
+            const std::string &item,
+            const int *iv,
+            const int *ev,
+            const int level,
+            const int gender,
+            const unsigned char happiness,
+            const bool shiny,
+            const std::vector<const MoveTemplate *> &moves,
+            const std::vector<int> &ppUps);
+    ~Pokemon();
 
     void initialise(BattleField *field, boost::shared_ptr<ScriptContext>,
             const int i, const int j);
@@ -125,6 +157,9 @@ public:
     void clearMemory();
     
     const STATUSES &getEffects() const { return m_effects; }
+    const TICK_SCHEDULE &getTickSchedule() const { return m_schedule; }
+    static void scheduleEffect(TICK_SCHEDULE &,
+            boost::shared_ptr<StatusObject>, ScriptContext *);
     boost::shared_ptr<StatusObject> applyStatus(Pokemon *, StatusObject *);
     void removeStatus(StatusObject *);
     static boost::shared_ptr<StatusObject> getStatus(STATUSES &,
@@ -136,7 +171,7 @@ public:
     void getStatModifiers(STAT, Pokemon *, Pokemon *, PRIORITY_MAP &);
     bool getTransformedStatLevel(Pokemon *, Pokemon *, STAT, int *);
     template <class T>
-    static void removeStatuses(STATUSES &, T predicate);
+    static void removeStatuses(STATUSES &, TICK_SCHEDULE &, T predicate);
     void removeStatuses();
     bool hasAbility(const std::string &);
     bool transformStatus(Pokemon *, boost::shared_ptr<StatusObject> *);
@@ -149,13 +184,14 @@ public:
     std::string getSpeciesName() const;
     int getSpeciesId() const;
     bool hasRestrictedIvs() const;
-    std::string getName() const { return m_nickname; }
+    std::string getName() const;
     std::string getToken() const;
+    std::string getSignature() const;
     double getMass() const;
 
     unsigned int getBaseStat(const STAT i) const;
-    unsigned int getIv(const STAT i) const { return m_iv[i]; }
-    unsigned int getEv(const STAT i) const { return m_ev[i]; }
+    unsigned int getIv(const STAT i) const;
+    unsigned int getEv(const STAT i) const;
     unsigned int getStat(const STAT i);
     unsigned int getRawStat(const STAT i) const { return m_stat[i]; }
     void setRawStat(const STAT i, const unsigned int v) {
@@ -179,7 +215,8 @@ public:
 
     unsigned int getLevel() const { return m_level; }
     const PokemonNature *getNature() const { return m_nature; }
-    const std::vector<int> &getPpUps() const { return m_ppUps; }
+    const std::vector<int> &getPpUps() const;
+    const std::vector<const MoveTemplate *> &getMoveTemplates() const;
     unsigned int getGender() const { return m_gender; }
     bool isShiny() const { return m_shiny; }
 
@@ -190,9 +227,9 @@ public:
 
     int getMove(const std::string &) const;
 
-    bool isMoveUsed(const int i) const { return m_moveUsed[i]; }
-    int getPp(const int i) const { return m_pp[i]; }
-    int getMaxPp(const int i) const { return m_maxPp[i]; }
+    bool isMoveUsed(const int i) const { return m_slots[i].used; }
+    int getPp(const int i) const { return m_slots[i].pp; }
+    int getMaxPp(const int i) const { return m_slots[i].maxPp; }
     void setPp(const int i, const int pp);
     void deductPp(const int i);
     void deductPp(boost::shared_ptr<MoveObject>);
@@ -204,7 +241,7 @@ public:
     void setItem(const std::string &);
     void setLevel(const int level);
 
-    int getMoveCount() const { return m_moves.size(); }
+    int getMoveCount() const { return m_slots.size(); }
 
     int getParty() const { return m_party; }
     int getPosition() const { return m_position; }
@@ -232,7 +269,7 @@ public:
         return m_forcedTurn.get();
     }
     FORCED_TYPE getForcedType() const;
-    bool isMoveLegal(const int i) const { return m_legalMove[i]; }
+    bool isMoveLegal(const int i) const { return m_slots[i].legal; }
     bool isSwitchLegal() const {
         return m_legalSwitch && m_forcedType != FORCED_ACTION;
     }
@@ -273,9 +310,8 @@ public:
     std::string getItemName() const;
     std::string getAbilityName() const;
 
-    void getImmunities(Pokemon *user, Pokemon *target,
-            std::set<const PokemonType *> &immunities,
-            std::set<const PokemonType *> &vulnerabilities);
+    bool getImmunities(Pokemon *user, Pokemon *target,
+            TYPE_SET &immunities, TYPE_SET &vulnerabilities);
             
     bool getTransformedEffectiveness(const PokemonType *moveType,
             const PokemonType *type, Pokemon *target, double &effectiveness);
@@ -307,71 +343,105 @@ public:
     };
 
 private:
+    void construct(const PokemonSpecies *species,
+            const std::string &nickname,
+            const PokemonNature *nature,
+            const std::string &ability,
+            const std::string &item,
+            const int *iv,
+            const int *ev,
+            const int level,
+            const int gender,
+            const unsigned char happiness,
+            const bool shiny,
+            const std::vector<int> &ppUps);
     void setMove(const int, boost::shared_ptr<MoveObject>,
             const int, const int);
 
+    /**
+     * One of the moves the pokemon can currently use.
+     */
+    struct MOVE_SLOT {
+        boost::shared_ptr<MoveObject> move;
+        short pp;
+        short maxPp;
+        bool used;  // Has the move been used since the pokemon switched in?
+        bool legal; // Can the move be selected this turn?
+    };
+
+    // The state below is touched on every action; it is kept together at the
+    // start of the object. The team definition and the names, which are only
+    // read when the battle starts or when text is printed, are in m_details.
     const PokemonSpecies *m_species;
-    unsigned int m_level;
     int m_hp; // The remaining health of the pokemon.
     bool m_fainted;
-    unsigned int m_stat[STAT_COUNT];
-    unsigned int m_iv[STAT_COUNT];
-    unsigned int m_ev[STAT_COUNT];
-    int m_statLevel[TOTAL_STAT_COUNT];  // Level of stat boost.
-    unsigned int m_gender;    // This pokemon's gender.
+    bool m_acted;   // Has this pokemon acted since it became active?
+    bool m_damaged; // Has this pokemon been damaged this turn?
+    bool m_revealed;// Has this pokemon ever been seen in battle?
+    bool m_legalSwitch;
+    bool m_executingForcedTurn;
     unsigned char m_happiness;
     bool m_shiny;
+    int m_party, m_position, m_slot;
+    unsigned int m_level;
+    unsigned int m_gender;    // This pokemon's gender.
+    unsigned int m_stat[STAT_COUNT];
+    int m_statLevel[TOTAL_STAT_COUNT];  // Level of stat boost.
     const PokemonNature *m_nature;
     TYPE_ARRAY m_types; // Current effective type.
-    std::vector<int> m_ppUps;
-    std::vector<const MoveTemplate *> m_moveProto;
-    std::vector<boost::shared_ptr<MoveObject> > m_moves;
-    std::vector<int> m_pp;
-    std::vector<int> m_maxPp;
-    std::vector<bool> m_moveUsed;
-    std::vector<bool> m_legalMove;
-    bool m_legalSwitch;
-    std::string m_nickname;
-    std::string m_itemName;
-    std::string m_abilityName;
-
-    typedef RECENT_MOVE MEMORY;
-    std::list<MEMORY> m_memory;
-
-    boost::shared_ptr<MoveObject> m_lastMove;
-
-    bool m_acted;   // Has this pokemon acted since it became active?
-    bool m_damaged; // Has this pokemon been damaged this turn?
-    bool m_revealed;// Has this pokemon ever been seen in battle?
-
-    std::stack<RECENT_DAMAGE> m_recent;
-
-    boost::shared_ptr<StatusObject> m_item;
-    boost::shared_ptr<StatusObject> m_ability;
+    std::vector<MOVE_SLOT> m_slots;
+    FORCED_TYPE m_forcedType;
+    PokemonTurn *m_turn;
 
     ScriptMachine *m_machine;
     ScriptContext *m_cx;
-    boost::shared_ptr<ScriptContext> m_scx;
     BattleField *m_field;
-    int m_party, m_position, m_slot;
 
     STATUSES m_effects;
+    TICK_SCHEDULE m_schedule;
 
-    bool m_executingForcedTurn;
-    PokemonTurn *m_turn;
+    typedef RECENT_MOVE MEMORY;
+    std::list<MEMORY> m_memory;
+    std::stack<RECENT_DAMAGE, std::vector<RECENT_DAMAGE> > m_recent;
+
+    boost::shared_ptr<MoveObject> m_lastMove;
+    boost::shared_ptr<StatusObject> m_item;
+    boost::shared_ptr<StatusObject> m_ability;
     boost::shared_ptr<PokemonTurn> m_forcedTurn;
     boost::shared_ptr<MoveObject> m_forcedMove;
-    FORCED_TYPE m_forcedType;
 
+    boost::shared_ptr<ScriptContext> m_scx;
     boost::shared_ptr<PokemonObject> m_object;
 
+    boost::scoped_ptr<PokemonDetails> m_details;
+
     Pokemon(const Pokemon &);
     Pokemon &operator=(const Pokemon &);
 };
 
+/**
+ * Remove the statuses which satisfy a predicate, along with their entries in
+ * the end of turn schedule. The predicate is called exactly once for each
+ * status, in order. This only leaves tombstones; the caller decides when it
+ * is safe to compact the list.
+ */
 template <class T>
-void Pokemon::removeStatuses(STATUSES &v, T predicate) {
-    v.erase(std::remove_if(v.begin(), v.end(), predicate), v.end());
+void Pokemon::removeStatuses(STATUSES &v, TICK_SCHEDULE &schedule,
+        T predicate) {
+    for (int i = 0; i < v.getSlotCount(); ++i) {
+        // Copy, since the predicate may run script.
+        const boost::shared_ptr<StatusObject> effect = v.getSlot(i);
+        if (!effect || !predicate(effect))
+            continue;
+        TICK_SCHEDULE::iterator j = schedule.begin();
+        for (; j != schedule.end(); ++j) {
+            if (j->effect == effect) {
+                schedule.erase(j);
+                break;
+            }
+        }
+        v.erase(i);
+    }
 }
 
 }
@@ -26,6 +26,7 @@
 #include <map>
 #include <string>
 #include <iostream>
+#include <algorithm>
 #include <boost/bind.hpp>
 
 #include <xercesc/parsers/XercesDOMParser.hpp>
@@ -35,6 +36,7 @@
 #include <xercesc/util/PlatformUtils.hpp>
 
 #include "PokemonSpecies.h"
+#include "DataImage.h"
 #include "../mechanics/PokemonType.h"
 #include "../mechanics/PokemonNature.h"
 #include "../moves/PokemonMove.h"
@@ -62,8 +64,6 @@ bool PokemonSpecies::hasRestrictedIvs() const {
     return false;
 }
 
-const int ORIGIN_COUNT = 7;
-
 /**
  * Names for types used within the XML format.
  */
@@ -112,6 +112,10 @@ struct SPECIES {
     map<MOVE_ORIGIN, set<string> > moves;
     COMBINATION_LIST illegal;
     ABILITY_LIST abilities;
+
+    SPECIES(): id(-1), gender(0), mass(0) {
+        memset(base, 0, sizeof(base));
+    }
 };
 
 class ShoddyHandler : public HandlerBase {
@@ -367,7 +371,10 @@ void getSpecies(DOMElement *node, SPECIES *pSpecies) {
     }
 }
 
-bool PokemonSpecies::loadSpecies(const string file, SpeciesDatabase &set) {
+/**
+ * Parse a species XML file.
+ */
+void parseSpecies(const string &file, vector<SPECIES> &list) {
     XMLPlatformUtils::Initialize();
     XercesDOMParser parser;
     //parser.setDoSchema(true);
@@ -384,19 +391,136 @@ bool PokemonSpecies::loadSpecies(const string file, SpeciesDatabase &set) {
 
     XMLCh tempStr[12];
     XMLString::transcode("species", tempStr, 11);
-    DOMNodeList *list = root->getElementsByTagName(tempStr);
+    DOMNodeList *nodes = root->getElementsByTagName(tempStr);
 
-    int length = list->getLength();
+    int length = nodes->getLength();
+    list.resize(length);
     for (int i = 0; i < length; ++i) {
-        DOMElement *item = (DOMElement *)list->item(i);
-        SPECIES species;
-        getSpecies(item, &species);
+        DOMElement *item = (DOMElement *)nodes->item(i);
+        getSpecies(item, &list[i]);
+    }
+}
+
+const unsigned char SPECIES_IMAGE = 'S';
+
+void writeStrings(ImageWriter &out, const vector<string> &v) {
+    out << (int32_t)v.size();
+    vector<string>::const_iterator i = v.begin();
+    for (; i != v.end(); ++i) {
+        out << *i;
+    }
+}
+
+void readStrings(ImageReader &in, vector<string> &v) {
+    int32_t count;
+    in >> count;
+    v.clear();
+    for (int i = 0; (i < count) && !in.hasError(); ++i) {
+        string str;
+        in >> str;
+        v.push_back(str);
+    }
+}
+
+void writeSpeciesImage(const vector<SPECIES> &list,
+        vector<unsigned char> &data) {
+    ImageWriter out(data);
+    out << (int32_t)list.size();
+    vector<SPECIES>::const_iterator i = list.begin();
+    for (; i != list.end(); ++i) {
+        const SPECIES &p = *i;
+        out << (int32_t)p.id << p.name << (int32_t)p.gender << p.mass;
+        writeStrings(out, p.types);
+        for (int j = 0; j < STAT_COUNT; ++j) {
+            out << (int32_t)p.base[j];
+        }
+        writeStrings(out, p.abilities);
+        out << (int32_t)p.moves.size();
+        map<MOVE_ORIGIN, set<string> >::const_iterator j = p.moves.begin();
+        for (; j != p.moves.end(); ++j) {
+            out << (int32_t)j->first;
+            writeStrings(out, vector<string>(j->second.begin(),
+                    j->second.end()));
+        }
+        out << (int32_t)p.illegal.size();
+        COMBINATION_LIST::const_iterator k = p.illegal.begin();
+        for (; k != p.illegal.end(); ++k) {
+            const int nature = k->nature ? k->nature->getInternalValue() : -1;
+            out << (int32_t)nature << k->ability << (int32_t)k->gender;
+            writeStrings(out, k->moves);
+        }
+    }
+}
+
+bool readSpeciesImage(const DataImage &image, vector<SPECIES> &list) {
+    ImageReader in(image.getData(), image.getSize());
+    int32_t count;
+    in >> count;
+    for (int i = 0; (i < count) && !in.hasError(); ++i) {
+        list.push_back(SPECIES());
+        SPECIES &p = list.back();
+        int32_t id, gender, size;
+        in >> id >> p.name >> gender >> p.mass;
+        p.id = id;
+        p.gender = gender;
+        readStrings(in, p.types);
+        for (int j = 0; j < STAT_COUNT; ++j) {
+            int32_t base;
+            in >> base;
+            p.base[j] = base;
+        }
+        readStrings(in, p.abilities);
+        in >> size;
+        for (int j = 0; (j < size) && !in.hasError(); ++j) {
+            int32_t origin;
+            vector<string> moves;
+            in >> origin;
+            readStrings(in, moves);
+            p.moves[(MOVE_ORIGIN)origin].insert(moves.begin(), moves.end());
+        }
+        in >> size;
+        for (int j = 0; (j < size) && !in.hasError(); ++j) {
+            Combination combo;
+            int32_t nature, comboGender;
+            in >> nature >> combo.ability >> comboGender;
+            combo.nature = PokemonNature::getNature(nature);
+            combo.gender = comboGender;
+            readStrings(in, combo.moves);
+            p.illegal.push_back(combo);
+        }
+    }
+    return !in.hasError() && in.atEnd();
+}
+
+bool PokemonSpecies::loadSpecies(const string file, SpeciesDatabase &set) {
+    vector<SPECIES> list;
+    DataImage image(file, SPECIES_IMAGE);
+    if (!image.isValid() || !readSpeciesImage(image, list)) {
+        list.clear();
+        parseSpecies(file, list);
+        vector<unsigned char> data;
+        writeSpeciesImage(list, data);
+        if (!DataImage::write(file, SPECIES_IMAGE, data)) {
+            Log::out() << "Warning: Could not compile " << file << endl;
+        }
+    }
+
+    vector<SPECIES>::iterator i = list.begin();
+    for (; i != list.end(); ++i) {
+        SPECIES &species = *i;
         if (set.m_set.find(species.id) != set.m_set.end()) {
             Log::out() << "Warning: Duplicate species ID: " << species.id << endl;
             continue;
         }
         PokemonSpecies *p = new PokemonSpecies((void *)&species);
         set.m_set[species.id] = p;
+        if (species.id >= 0) {
+            if (static_cast<size_t>(species.id) >= set.m_byId.size()) {
+                set.m_byId.resize(species.id + 1, NULL);
+            }
+            set.m_byId[species.id] = p;
+        }
+        set.m_names.insert(make_pair(p->getSpeciesName(), p));
     }
 
     return true;
@@ -411,9 +535,10 @@ PokemonSpecies::PokemonSpecies(void *raw) {
     m_id = p->id;
     m_gender = p->gender;
     memcpy(m_base, p->base, sizeof(int) * STAT_COUNT);
-    m_moveset = p->moves;
+    m_movesetNames = p->moves;
+    m_moveDatabase = NULL;
     m_mass = p->mass;
-    m_illegal = p->illegal;
+    m_illegalNames = p->illegal;
     m_abilities = p->abilities;
     vector<string>::iterator i = p->types.begin();
     for (; i != p->types.end(); ++i) {
@@ -426,34 +551,169 @@ PokemonSpecies::PokemonSpecies(void *raw) {
     }
 }
 
+namespace {
+
+int getFirstMove(const IllegalCombination &combo) {
+    return combo.moves.empty() ? -1 : combo.moves[0];
+}
+
+/**
+ * Orders illegal combinations by their first move.
+ */
+struct FirstMoveLess {
+    bool operator()(const IllegalCombination &a,
+            const IllegalCombination &b) const {
+        return getFirstMove(a) < getFirstMove(b);
+    }
+    bool operator()(const IllegalCombination &a, const int b) const {
+        return getFirstMove(a) < b;
+    }
+    bool operator()(const int a, const IllegalCombination &b) const {
+        return a < getFirstMove(b);
+    }
+};
+
+} // anonymous namespace
+
 /**
- * Pokemon this pokemon's move list.
+ * Populate this pokemon's move list.
  */
 set<string> PokemonSpecies::populateMoveList(const MoveDatabase &p) {
     set<string> ret;
-    m_moves.clear();
+    m_moveDatabase = &p;
     for (int i = 0; i < ORIGIN_COUNT; ++i) {
-        set<string> &moves = m_moveset[(MOVE_ORIGIN)i];
+        LEARNSET &learnset = m_learnset[i];
+        set<string> &moves = m_movesetNames[(MOVE_ORIGIN)i];
         set<string>::iterator j = moves.begin();
         for (; j != moves.end(); ++j) {
-            const string name = *j;
-            const MoveTemplate *move = p.getMove(name);
-            if (move) {
-                m_moves[name] = move;
-            } else {
-                ret.insert(name);
+            const MoveTemplate *move = p.getMove(*j);
+            if (!move) {
+                ret.insert(*j);
+                continue;
             }
+            const size_t id = static_cast<size_t>(move->getId());
+            if (id >= learnset.size()) {
+                learnset.resize(id + 1);
+            }
+            learnset.set(id);
+        }
+        if (learnset.size() > m_learnable.size()) {
+            m_learnable.resize(learnset.size());
         }
     }
+    for (int i = 0; i < ORIGIN_COUNT; ++i) {
+        LEARNSET learnset = m_learnset[i];
+        learnset.resize(m_learnable.size());
+        m_learnable |= learnset;
+    }
+    MOVESET().swap(m_movesetNames);
+
+    m_illegal.clear();
+    COMBINATION_LIST::const_iterator i = m_illegalNames.begin();
+    for (; i != m_illegalNames.end(); ++i) {
+        IllegalCombination combo;
+        combo.nature = i->nature;
+        combo.gender = i->gender;
+        combo.ability = -1;
+        if (!i->ability.empty()) {
+            ABILITY_LIST::const_iterator ability = find(m_abilities.begin(),
+                    m_abilities.end(), i->ability);
+            if (ability == m_abilities.end()) {
+                // Only a pokemon with an ability that this species cannot
+                // have could match; it is rejected for that anyway.
+                continue;
+            }
+            combo.ability = ability - m_abilities.begin();
+        }
+        bool known = true;
+        vector<string>::const_iterator j = i->moves.begin();
+        for (; j != i->moves.end(); ++j) {
+            const MoveTemplate *move = p.getMove(*j);
+            if (!move) {
+                // No pokemon can know this move, so none can match.
+                known = false;
+                break;
+            }
+            combo.moves.push_back(move->getId());
+        }
+        if (!known)
+            continue;
+        sort(combo.moves.begin(), combo.moves.end());
+        combo.moves.erase(unique(combo.moves.begin(), combo.moves.end()),
+                combo.moves.end());
+        m_illegal.push_back(combo);
+    }
+    stable_sort(m_illegal.begin(), m_illegal.end(), FirstMoveLess());
+    COMBINATION_LIST().swap(m_illegalNames);
     return ret;
 }
 
+const MoveTemplate *PokemonSpecies::getMove(const string &name) const {
+    if (!m_moveDatabase)
+        return NULL;
+    const MoveTemplate *move = m_moveDatabase->getMove(name);
+    if (!move || !canLearn(move->getId()))
+        return NULL;
+    return move;
+}
+
+/**
+ * Only the combinations whose first move is one of the given moves (or that
+ * have no moves at all) can match, and they are found by binary search.
+ */
+bool PokemonSpecies::isLegalCombination(const vector<int> &moves,
+        const PokemonNature *nature, const int ability,
+        const unsigned int gender) const {
+    LEARNSET known(m_learnable.size());
+    vector<int> keys(1, -1);
+    vector<int>::const_iterator i = moves.begin();
+    for (; i != moves.end(); ++i) {
+        if ((*i >= 0) && (static_cast<size_t>(*i) < known.size())
+                && !known.test(*i)) {
+            known.set(*i);
+            keys.push_back(*i);
+        }
+    }
+
+    vector<int>::const_iterator j = keys.begin();
+    for (; j != keys.end(); ++j) {
+        pair<ILLEGAL_LIST::const_iterator, ILLEGAL_LIST::const_iterator> range
+                = equal_range(m_illegal.begin(), m_illegal.end(), *j,
+                        FirstMoveLess());
+        ILLEGAL_LIST::const_iterator k = range.first;
+        for (; k != range.second; ++k) {
+            const IllegalCombination &combo = *k;
+            bool match = true;
+            vector<int>::const_iterator l = combo.moves.begin();
+            for (; l != combo.moves.end(); ++l) {
+                if ((static_cast<size_t>(*l) >= known.size())
+                        || !known.test(*l)) {
+                    match = false;
+                    break;
+                }
+            }
+            if (!match)
+                continue;
+            if ((combo.ability != -1) && (combo.ability != ability))
+                continue;
+            if (combo.nature && (combo.nature != nature))
+                continue;
+            // 0 gender is NONE, pokemon with NONE cannot have any other
+            // gender so we can treat 0 as unspecified
+            if ((combo.gender != 0) && (gender != combo.gender))
+                continue;
+            return false;
+        }
+    }
+    return true;
+}
+
 /**
  * Verify that every ability is implemented.
  */
 void SpeciesDatabase::verifyAbilities(ScriptMachine *machine) const {
     set<string> abilities;
-    SPECIES_SET::iterator i = m_set.begin();
+    SPECIES_SET::const_iterator i = m_set.begin();
     for (; i != m_set.end(); ++i) {
         const ABILITY_LIST &part = i->second->getAbilities();
         ABILITY_LIST::const_iterator j = part.begin();
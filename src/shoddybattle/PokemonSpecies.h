@@ -30,6 +30,8 @@
 #include <vector>
 #include <map>
 #include <memory>
+#include <boost/dynamic_bitset.hpp>
+#include <boost/unordered_map.hpp>
 #include "../mechanics/stat.h"
 #include "../mechanics/PokemonNature.h"
 
@@ -49,6 +51,8 @@ enum MOVE_ORIGIN {
     MO_NONE = -1
 };
 
+const int ORIGIN_COUNT = 7;
+
 enum GENDER {
     G_MALE = 1,
     G_FEMALE = 2,
@@ -57,10 +61,14 @@ enum GENDER {
 };
 
 class MoveTemplate;
-typedef std::map<std::string, const MoveTemplate *> MOVE_LIST;
 
 typedef std::map<MOVE_ORIGIN, std::set<std::string> > MOVESET;
 
+/**
+ * A set of moves, with a bit for each move id.
+ */
+typedef boost::dynamic_bitset<> LEARNSET;
+
 class PokemonSpecies;
 typedef std::map<int, PokemonSpecies *> SPECIES_SET;
 
@@ -77,6 +85,18 @@ struct Combination {
 typedef std::vector<std::string> ABILITY_LIST;
 typedef std::vector<Combination> COMBINATION_LIST;
 
+/**
+ * An illegal combination with its moves and ability resolved for a species.
+ */
+struct IllegalCombination {
+    std::vector<int> moves;         // move ids, in ascending order
+    const PokemonNature *nature;
+    int ability;                    // index into the abilities, or -1
+    unsigned int gender;
+};
+
+typedef std::vector<IllegalCombination> ILLEGAL_LIST;
+
 class MoveDatabase;
 class SpeciesDatabase;
 class ScriptMachine;
@@ -97,18 +117,42 @@ public:
     unsigned int getSpeciesId() const { return m_id; }
     unsigned int getPossibleGenders() const { return m_gender; }
     const TYPE_LIST &getTypes() const { return m_types; }
-    const MOVESET &getMoveset() const { return m_moveset; }
     const ABILITY_LIST &getAbilities() const { return m_abilities; }
-    const MOVE_LIST &getMoveList() const { return m_moves; }
     double getMass() const { return m_mass; }
     bool hasRestrictedIvs() const;
-    const COMBINATION_LIST &getIllegalCombinations() const { return m_illegal; }
 
+    /**
+     * Resolve the moves this species can learn, and the moves in its illegal
+     * combinations, to move ids. The move names are released afterwards, so
+     * this can only be called once, after every move has been loaded.
+     */
     std::set<std::string> populateMoveList(const MoveDatabase &);
-    const MoveTemplate *getMove(const std::string name) const {
-        return m_moves[name];
+
+    /**
+     * Get a move by name, or NULL if this species cannot learn it.
+     */
+    const MoveTemplate *getMove(const std::string &name) const;
+
+    bool canLearn(const int move) const {
+        return (move >= 0)
+                && (static_cast<size_t>(move) < m_learnable.size())
+                && m_learnable.test(move);
+    }
+    bool canLearn(const int move, const MOVE_ORIGIN origin) const {
+        const LEARNSET &moves = m_learnset[origin];
+        return (move >= 0) && (static_cast<size_t>(move) < moves.size())
+                && moves.test(move);
     }
 
+    /**
+     * Determine whether a set of moves, together with a nature, ability and
+     * gender, is legal for this species. The ability is an index into
+     * getAbilities(), or -1 if the species cannot have it.
+     */
+    bool isLegalCombination(const std::vector<int> &moves,
+            const PokemonNature *nature, const int ability,
+            const unsigned int gender) const;
+
 private:
     PokemonSpecies(void *);
 
@@ -120,11 +164,14 @@ private:
     unsigned int m_gender;  // Possible genders for this species.
     TYPE_LIST m_types;
     unsigned int m_base[STAT_COUNT];
-    MOVESET m_moveset;
-    mutable MOVE_LIST m_moves;
+    LEARNSET m_learnset[ORIGIN_COUNT];
+    LEARNSET m_learnable;   // union of m_learnset
+    const MoveDatabase *m_moveDatabase;
     double m_mass;
     ABILITY_LIST m_abilities;
-    COMBINATION_LIST m_illegal;
+    ILLEGAL_LIST m_illegal; // sorted by first move, -1 if there are none
+    MOVESET m_movesetNames;             // until populateMoveList
+    COMBINATION_LIST m_illegalNames;    // until populateMoveList
     static const std::string m_restricted[];
 };
 
@@ -141,16 +188,13 @@ public:
         PokemonSpecies::loadSpecies(file, *this);
     }
     const PokemonSpecies *getSpecies(const int id) const {
-        return m_set[id];
+        if ((id < 0) || (static_cast<size_t>(id) >= m_byId.size()))
+            return NULL;
+        return m_byId[id];
     }
-    const PokemonSpecies *getSpecies(const std::string name) const {
-        SPECIES_SET::const_iterator i = m_set.begin();
-        for (; i != m_set.end(); ++i) {
-            const PokemonSpecies *p = i->second;
-            if (p->getSpeciesName() == name)
-                return p;
-        }
-        return NULL;
+    const PokemonSpecies *getSpecies(const std::string &name) const {
+        NAME_INDEX::const_iterator i = m_names.find(name);
+        return (i == m_names.end()) ? NULL : i->second;
     }
     const SPECIES_SET &getSpeciesSet() const {
         return m_set;
@@ -180,7 +224,12 @@ public:
         }
     }
 private:
-    mutable SPECIES_SET m_set;
+    typedef boost::unordered_map<std::string, const PokemonSpecies *>
+            NAME_INDEX;
+
+    SPECIES_SET m_set;
+    std::vector<const PokemonSpecies *> m_byId;
+    NAME_INDEX m_names;
     SpeciesDatabase(const SpeciesDatabase &);
     SpeciesDatabase &operator=(const SpeciesDatabase &);
     friend bool PokemonSpecies::loadSpecies(const std::string file,
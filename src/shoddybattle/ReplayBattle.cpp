@@ -0,0 +1,190 @@
+/*
+ * File:   ReplayBattle.cpp
+ * Author: Catherine
+ *
+ * Created on October 19, 2026, 6:40 PM
+ *
+ * This file is a part of Shoddy Battle.
+ * Copyright (C) 2009  Catherine Fitzpatrick and Benjamin Gwin
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program; if not, visit the Free Software Foundation, Inc.
+ * online at http://gnu.org.
+ */
+
+#include "ReplayBattle.h"
+#include "../scripting/ScriptMachine.h"
+#include "../moves/PokemonMove.h"
+
+using namespace std;
+using namespace boost;
+
+namespace shoddybattle {
+
+ReplayBattle::ReplayBattle(const BattleRecord &record):
+        m_record(record),
+        m_mech(record.seed),
+        m_step(0),
+        m_victory(false),
+        m_desync(false) { }
+
+bool ReplayBattle::run(ScriptMachine *machine, Generation *generation) {
+    ScriptContextPtr cx = machine->acquireContext();
+    ScriptContextLock cxLock(cx);
+
+    vector<StatusObject> clauses;
+    vector<string>::const_iterator i = m_record.clauses.begin();
+    for (; i != m_record.clauses.end(); ++i) {
+        StatusObject clause = cx->getClause(*i);
+        if (clause.isNull()) {
+            return false;
+        }
+        clauses.push_back(clause);
+    }
+
+    Pokemon::ARRAY teams[TEAM_COUNT];
+    const SpeciesDatabase *species = machine->getSpeciesDatabase();
+    for (int j = 0; j < TEAM_COUNT; ++j) {
+        const vector<PokemonRecord> &team = m_record.teams[j];
+        vector<PokemonRecord>::const_iterator k = team.begin();
+        for (; k != team.end(); ++k) {
+            Pokemon::PTR p = k->create(species);
+            if (!p) {
+                return false;
+            }
+            teams[j].push_back(p);
+        }
+    }
+
+    initialise(&m_mech, generation, machine, teams, m_record.trainer,
+            m_record.partySize, clauses);
+    beginBattle();
+
+    // This is the loop in NetworkBattleImpl::executeTurn, with the players'
+    // decisions read from the record instead of the network.
+    const vector<BattleStep> &steps = m_record.steps;
+    while (!m_victory && !m_desync && (m_step < steps.size())) {
+        const BattleStep &step = steps[m_step++];
+        switch (step.type) {
+            case BattleStep::S_TURN: {
+                // NetworkBattleImpl::requestMoves does this before asking
+                // the players for their moves.
+                Pokemon::ARRAY active;
+                getActivePokemon(active);
+                Pokemon::ARRAY::iterator j = active.begin();
+                for (; j != active.end(); ++j) {
+                    (*j)->determineLegalActions();
+                }
+                vector<PokemonTurn> turns = step.turns;
+                processTurn(turns);
+            } break;
+            case BattleStep::S_REPLACEMENT:
+                processReplacements(step.turns);
+                break;
+            case BattleStep::S_FORFEIT:
+                informVictory(1 - step.value);
+                break;
+            default:
+                // Selections are consumed by requestInactivePokemon.
+                m_desync = true;
+                break;
+        }
+    }
+    terminate();
+
+    return !m_desync
+            && (m_step == steps.size())
+            && (m_digest.getHash() == m_record.digest)
+            && (m_digest.getCount() == m_record.eventCount);
+}
+
+Pokemon *ReplayBattle::requestInactivePokemon(Pokemon *pokemon) {
+    const int party = pokemon->getParty();
+    if (getAliveCount(party, true) == 0)
+        return NULL;
+    const vector<BattleStep> &steps = m_record.steps;
+    if ((m_step == steps.size())
+            || (steps[m_step].type != BattleStep::S_SELECTION)) {
+        // The original battle asked for a pokemon at a different point. Let
+        // the turn finish and stop the replay there.
+        m_desync = true;
+        return getRandomInactivePokemon(pokemon);
+    }
+    const int idx = steps[m_step++].value;
+    if (idx == -1) {
+        // The player forfeited while choosing and there was nothing to pick
+        // for them. The forfeit took effect before the rest of the turn.
+        if ((m_step == steps.size())
+                || (steps[m_step].type != BattleStep::S_FORFEIT)) {
+            m_desync = true;
+            return NULL;
+        }
+        informVictory(1 - steps[m_step++].value);
+        return NULL;
+    }
+    const Pokemon::ARRAY &team = getTeam(party);
+    if ((idx < 0) || (idx >= static_cast<int>(team.size()))) {
+        // Not a pokemon on this team, so the record is corrupt.
+        m_desync = true;
+        return getRandomInactivePokemon(pokemon);
+    }
+    return team[idx].get();
+}
+
+void ReplayBattle::print(const TextMessage &msg) {
+    if (!isNarrationEnabled())
+        return;
+    m_digest.print(msg);
+}
+
+void ReplayBattle::informVictory(const int party) {
+    m_victory = true;
+    m_digest.victory(party);
+}
+
+void ReplayBattle::informUseMove(Pokemon *pokemon, MoveObject *move) {
+    m_digest.useMove(pokemon, move->getTemplate(getContext())->getId());
+}
+
+void ReplayBattle::informWithdraw(Pokemon *pokemon) {
+    m_digest.withdraw(pokemon);
+}
+
+void ReplayBattle::informSendOut(Pokemon *pokemon) {
+    m_digest.sendOut(pokemon);
+}
+
+void ReplayBattle::informHealthChange(Pokemon *pokemon, const int raw) {
+    m_digest.healthChange(pokemon, raw);
+}
+
+void ReplayBattle::informSetPp(Pokemon *pokemon,
+        const int move, const int pp) {
+    m_digest.setPp(pokemon, move, pp);
+}
+
+void ReplayBattle::informSetMove(Pokemon *pokemon, const int idx,
+        const int move, const int pp, const int maxPp) {
+    m_digest.setMove(pokemon, idx, move, pp, maxPp);
+}
+
+void ReplayBattle::informFainted(Pokemon *pokemon) {
+    m_digest.fainted(pokemon);
+}
+
+void ReplayBattle::informStatusChange(Pokemon *p, StatusObject *effect,
+        const bool applied) {
+    m_digest.statusChange(p, effect->getId(getContext()), applied);
+}
+
+}
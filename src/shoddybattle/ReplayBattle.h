@@ -0,0 +1,81 @@
+/*
+ * File:   ReplayBattle.h
+ * Author: Catherine
+ *
+ * Created on October 19, 2026, 6:40 PM
+ *
+ * This file is a part of Shoddy Battle.
+ * Copyright (C) 2009  Catherine Fitzpatrick and Benjamin Gwin
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program; if not, visit the Free Software Foundation, Inc.
+ * online at http://gnu.org.
+ */
+
+#ifndef _REPLAY_BATTLE_H_
+#define _REPLAY_BATTLE_H_
+
+#include "BattleField.h"
+#include "BattleRecord.h"
+#include "../mechanics/JewelMechanics.h"
+
+namespace shoddybattle {
+
+/**
+ * Runs a recorded battle again, headlessly, as fast as the engine can go.
+ * Nothing is narrated; each event only feeds an EventDigest, which is
+ * compared to the digest of the original battle at the end.
+ *
+ * ReplayBattle objects are used once: construct, run(), then discard.
+ */
+class ReplayBattle : public BattleField {
+public:
+    ReplayBattle(const BattleRecord &record);
+
+    /**
+     * Replay the whole record. Returns true if the replay reported exactly
+     * the events that the original battle reported.
+     */
+    bool run(ScriptMachine *machine, Generation *generation);
+
+    const EventDigest &getDigest() const { return m_digest; }
+
+    /**
+     * Get the number of recorded steps that were executed.
+     */
+    int getStepCount() const { return m_step; }
+
+private:
+    Pokemon *requestInactivePokemon(Pokemon *);
+    void print(const TextMessage &msg);
+    void informVictory(const int);
+    void informUseMove(Pokemon *, MoveObject *);
+    void informWithdraw(Pokemon *);
+    void informSendOut(Pokemon *);
+    void informHealthChange(Pokemon *, const int);
+    void informSetPp(Pokemon *, const int, const int);
+    void informSetMove(Pokemon *, const int, const int, const int, const int);
+    void informFainted(Pokemon *);
+    void informStatusChange(Pokemon *, StatusObject *, const bool);
+
+    const BattleRecord &m_record;
+    JewelMechanics m_mech;
+    EventDigest m_digest;
+    unsigned int m_step;
+    bool m_victory;
+    bool m_desync;
+};
+
+}
+
+#endif
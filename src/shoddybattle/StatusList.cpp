@@ -0,0 +1,137 @@
+/*
+ * File:   StatusList.cpp
+ * Author: Catherine
+ *
+ * Created on October 19, 2026, 2:40 PM
+ *
+ * This file is a part of Shoddy Battle.
+ * Copyright (C) 2009  Catherine Fitzpatrick and Benjamin Gwin
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program; if not, visit the Free Software Foundation, Inc.
+ * online at http://gnu.org.
+ */
+
+#include "StatusList.h"
+#include "../scripting/ScriptMachine.h"
+
+using namespace std;
+using namespace boost;
+
+namespace shoddybattle {
+
+namespace {
+
+/**
+ * The properties which put an effect into each fixed hook.
+ */
+const char *HOOK_PROPERTIES[StatusList::HOOK_COUNT][2] = {
+    { "modifier", NULL },
+    { "statModifier", NULL },
+    { "immunity", "vulnerability" },
+    { "transformEffectiveness", NULL },
+    { "transformStatus", NULL },
+    { "transformStatLevel", NULL },
+    { "transformHealthChange", NULL },
+    { "vetoSelection", NULL },
+    { "vetoExecution", NULL },
+    { "informTargeted", NULL }
+};
+
+/**
+ * Renumber the slots in an index after compaction, dropping tombstones.
+ */
+void remap(StatusList::INDEX &index, const vector<int> &slots) {
+    StatusList::INDEX::iterator out = index.begin();
+    StatusList::INDEX::const_iterator i = index.begin();
+    for (; i != index.end(); ++i) {
+        const int slot = slots[*i];
+        if (slot != -1) {
+            *out++ = slot;
+        }
+    }
+    index.erase(out, index.end());
+}
+
+} // anonymous namespace
+
+const StatusList::INDEX &StatusList::getHook(const string &name,
+        ScriptContext *cx) const {
+    NAMED_INDEX::iterator i = m_named.find(name);
+    if (i != m_named.end()) {
+        return i->second;
+    }
+    INDEX &index = m_named[name];
+    const int size = m_slots.size();
+    for (int j = 0; j < size; ++j) {
+        StatusObject *effect = m_slots[j].get();
+        if (effect && cx->hasProperty(effect, name)) {
+            index.push_back(j);
+        }
+    }
+    return index;
+}
+
+void StatusList::push_back(const value_type &effect, ScriptContext *cx) {
+    const int slot = m_slots.size();
+    m_slots.push_back(effect);
+    for (int i = 0; i < HOOK_COUNT; ++i) {
+        const char **properties = HOOK_PROPERTIES[i];
+        for (int j = 0; (j < 2) && properties[j]; ++j) {
+            if (cx->hasProperty(effect.get(), properties[j])) {
+                m_hooks[i].push_back(slot);
+                break;
+            }
+        }
+    }
+    NAMED_INDEX::iterator i = m_named.begin();
+    for (; i != m_named.end(); ++i) {
+        if (cx->hasProperty(effect.get(), i->first)) {
+            i->second.push_back(slot);
+        }
+    }
+}
+
+void StatusList::erase(const int slot) {
+    if (m_slots[slot]) {
+        m_slots[slot].reset();
+        ++m_dead;
+    }
+}
+
+void StatusList::compact() {
+    if (m_dead == 0)
+        return;
+
+    const int size = m_slots.size();
+    vector<int> slots(size, -1);
+    int live = 0;
+    for (int i = 0; i < size; ++i) {
+        if (m_slots[i]) {
+            slots[i] = live;
+            m_slots[live++] = m_slots[i];
+        }
+    }
+    m_slots.resize(live);
+    m_dead = 0;
+
+    for (int i = 0; i < HOOK_COUNT; ++i) {
+        remap(m_hooks[i], slots);
+    }
+    NAMED_INDEX::iterator i = m_named.begin();
+    for (; i != m_named.end(); ++i) {
+        remap(i->second, slots);
+    }
+}
+
+}
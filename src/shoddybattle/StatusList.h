@@ -0,0 +1,189 @@
+/*
+ * File:   StatusList.h
+ * Author: Catherine
+ *
+ * Created on October 19, 2026, 2:40 PM
+ *
+ * This file is a part of Shoddy Battle.
+ * Copyright (C) 2009  Catherine Fitzpatrick and Benjamin Gwin
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program; if not, visit the Free Software Foundation, Inc.
+ * online at http://gnu.org.
+ */
+
+#ifndef _STATUS_LIST_H_
+#define _STATUS_LIST_H_
+
+#include <boost/shared_ptr.hpp>
+#include <vector>
+#include <string>
+#include <map>
+#include <iterator>
+#include <cstddef>
+
+namespace shoddybattle {
+
+class StatusObject;
+class ScriptContext;
+
+/**
+ * The status effects on a pokemon or on the field, stored contiguously in
+ * the order in which they were applied.
+ *
+ * Removing an effect leaves a tombstone in its slot, so slot numbers stay
+ * valid while the list is being walked. The tombstones are squeezed out by
+ * compact(), which may only be called when nothing is walking the list.
+ *
+ * For each hook the engine queries, the list also keeps the slots of the
+ * effects which implement it, so a query such as "who has a statModifier"
+ * only visits the effects that do. Hooks are detected when an effect is
+ * added, so an effect must not gain or lose a hook after it is applied.
+ *
+ * Effects added while the list is being walked are visited by that walk,
+ * just as they were when this was a std::list. To keep that true, walks
+ * must go by slot number and re-read the size on each step.
+ */
+class StatusList {
+public:
+    typedef boost::shared_ptr<StatusObject> value_type;
+    typedef std::vector<int> INDEX;
+
+    enum HOOK {
+        H_MODIFIER,
+        H_STAT_MODIFIER,
+        H_IMMUNITY,                 // "immunity" or "vulnerability"
+        H_TRANSFORM_EFFECTIVENESS,
+        H_TRANSFORM_STATUS,
+        H_TRANSFORM_STAT_LEVEL,
+        H_TRANSFORM_HEALTH_CHANGE,
+        H_VETO_SELECTION,
+        H_VETO_EXECUTION,
+        H_INFORM_TARGETED,
+        HOOK_COUNT
+    };
+
+    /**
+     * Iterates over the live effects, skipping tombstones.
+     */
+    class const_iterator {
+    public:
+        typedef std::forward_iterator_tag iterator_category;
+        typedef StatusList::value_type value_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef const value_type *pointer;
+        typedef const value_type &reference;
+
+        const_iterator(): m_list(NULL), m_slot(0) { }
+
+        reference operator*() const {
+            return m_list->m_slots[m_slot];
+        }
+        pointer operator->() const {
+            return &m_list->m_slots[m_slot];
+        }
+        const_iterator &operator++() {
+            ++m_slot;
+            skip();
+            return *this;
+        }
+        const_iterator operator++(int) {
+            const_iterator ret = *this;
+            ++*this;
+            return ret;
+        }
+        bool operator==(const const_iterator &rhs) const {
+            return (m_slot == rhs.m_slot);
+        }
+        bool operator!=(const const_iterator &rhs) const {
+            return (m_slot != rhs.m_slot);
+        }
+
+    private:
+        friend class StatusList;
+        const_iterator(const StatusList *list, const int slot):
+                m_list(list), m_slot(slot) {
+            skip();
+        }
+        void skip() {
+            const int size = m_list->m_slots.size();
+            while ((m_slot < size) && !m_list->m_slots[m_slot]) {
+                ++m_slot;
+            }
+        }
+        const StatusList *m_list;
+        int m_slot;
+    };
+    typedef const_iterator iterator;
+
+    StatusList(): m_dead(0) { }
+
+    const_iterator begin() const { return const_iterator(this, 0); }
+    const_iterator end() const { return const_iterator(this, m_slots.size()); }
+    bool empty() const { return (m_slots.size() == m_dead); }
+
+    /**
+     * Get the number of slots, including tombstones.
+     */
+    int getSlotCount() const { return m_slots.size(); }
+
+    /**
+     * Get the effect in a slot, or NULL if the slot is a tombstone.
+     */
+    StatusObject *operator[](const int slot) const {
+        return m_slots[slot].get();
+    }
+    const value_type &getSlot(const int slot) const {
+        return m_slots[slot];
+    }
+
+    /**
+     * Get the slots of the effects which implement a hook, in the order the
+     * effects were applied. May contain tombstones.
+     */
+    const INDEX &getHook(const HOOK hook) const {
+        return m_hooks[hook];
+    }
+
+    /**
+     * As above, for an arbitrary message such as those sent through
+     * Pokemon::sendMessage. The index is built the first time a message is
+     * asked for and kept up to date from then on.
+     */
+    const INDEX &getHook(const std::string &name, ScriptContext *cx) const;
+
+    void push_back(const value_type &effect, ScriptContext *cx);
+
+    /**
+     * Turn a slot into a tombstone.
+     */
+    void erase(const int slot);
+
+    /**
+     * Squeeze out the tombstones. This renumbers the slots, so it must not
+     * be called while anything is walking the list.
+     */
+    void compact();
+
+private:
+    typedef std::map<std::string, INDEX> NAMED_INDEX;
+
+    std::vector<value_type> m_slots;
+    unsigned int m_dead;
+    INDEX m_hooks[HOOK_COUNT];
+    mutable NAMED_INDEX m_named;
+};
+
+}
+
+#endif
@@ -27,6 +27,7 @@
 #include <string>
 #include <sstream>
 #include <cstdarg>
+#include <cctype>
 #include <iostream>
 
 using namespace std;
@@ -39,35 +40,114 @@ string trim(string &s, const string &space) {
     return r.erase(0, r.find_first_not_of(space));
 }
 
+namespace {
+
+inline const char *getArg(const char **args, const int i) {
+    return args[i];
+}
+
+inline const std::string &getArg(const vector<string> &args, const int i) {
+    return args[i];
+}
+
+} // anonymous namespace
+
+const Text::Template *Text::getTemplate(const int type, const int id) const {
+    if ((type < 0) || (type >= int(m_text.size())))
+        return NULL;
+    const vector<Template> &category = m_text[type];
+    if ((id < 0) || (id >= int(category.size())))
+        return NULL;
+    return &category[id];
+}
+
 /**
- * Load a string from the table.
+ * Split a template into literals and $n argument references. Each reference
+ * keeps its source text so that it can be printed as is if the argument is
+ * not supplied.
  */
-string Text::getText(const int type, const int id, const int count,
-        const char **args) const {
-    TEXT_MAP::const_iterator itr = m_text.find(type);
-    if (itr == m_text.end()) {
-        return string();
+void Text::compile(const int type, const int id, const string &text) {
+    if (type >= int(m_text.size())) {
+        m_text.resize(type + 1);
     }
-
-    const INDEX_MAP &j = itr->second;
-    INDEX_MAP::const_iterator k = j.find(id);
-    if (k == j.end()) {
-        return string();
+    vector<Template> &category = m_text[type];
+    if (id >= int(category.size())) {
+        category.resize(id + 1);
+    }
+    Template &t = category[id];
+    t.first = m_segments.size();
+
+    size_t begin = 0;
+    while (begin < text.length()) {
+        size_t end = text.find('$', begin);
+        int arg = -1;
+        if (end == begin) {
+            ++end;
+            int n = 0;
+            while ((end < text.length()) && isdigit(text[end])) {
+                n = n * 10 + (text[end++] - '0');
+            }
+            if (end > begin + 1) {
+                arg = n - 1;
+            }
+        } else if (end == string::npos) {
+            end = text.length();
+        }
+        if ((arg == -1) && (m_segments.size() > t.first)
+                && (m_segments.back().arg == -1)) {
+            m_segments.back().length += end - begin;
+        } else {
+            const Segment segment =
+                    { unsigned(m_literals.length()), unsigned(end - begin), arg };
+            m_segments.push_back(segment);
+        }
+        m_literals.append(text, begin, end - begin);
+        begin = end;
     }
-    string text = k->second;
-
-    // Replace $n entities in the string.
-    for (int i = 1; i <= count; ++i) {
-        stringstream ss;
-        ss << "$" << i;
-        string str = ss.str();
-        size_t pos = text.find(str);
-        if (pos != string::npos) {
-            text.replace(pos, str.length(), args[i - 1]);
+
+    t.count = m_segments.size() - t.first;
+}
+
+template <class ARGS>
+void Text::format(const Template &t, const int count, ARGS args,
+        string &out) const {
+    const Segment *i = &m_segments[0] + t.first;
+    const Segment *end = i + t.count;
+    for (; i != end; ++i) {
+        if ((i->arg >= 0) && (i->arg < count)) {
+            out += getArg(args, i->arg);
+        } else {
+            out.append(m_literals, i->offset, i->length);
         }
     }
+}
+
+void Text::getText(const int type, const int id, const int count,
+        const char **args, string &out) const {
+    out.clear();
+    const Template *t = getTemplate(type, id);
+    if (t && t->count) {
+        format(*t, count, args, out);
+    }
+}
+
+void Text::getText(const int type, const int id,
+        const vector<string> &args, string &out) const {
+    out.clear();
+    const Template *t = getTemplate(type, id);
+    if (t && t->count) {
+        format<const vector<string> &>(*t, args.size(), args, out);
+    }
+}
 
-    return text;
+/**
+ * Load a string from the table.
+ */
+string Text::getText(const int type, const int id, const int count,
+        const char **args) const {
+    string ret;
+    getText(type, id, count, args, ret);
+    return ret;
 }
 
 /**
@@ -145,7 +225,7 @@ bool Text::loadFile(const string path, LOOKUP_FUNCTION lookup)
         }
 
         string text = line.substr(pos + 1);
-        m_text[category][idx] = trim(text);
+        compile(category, idx, trim(text));
 
     }
     return true;
@@ -27,7 +27,7 @@
 
 #include <boost/function.hpp>
 #include <string>
-#include <map>
+#include <vector>
 
 namespace shoddybattle {
 
@@ -41,9 +41,6 @@ private:
     unsigned int m_line;
 };
 
-typedef std::map<int, std::string> INDEX_MAP;
-typedef std::map<int, INDEX_MAP> TEXT_MAP;
-
 typedef boost::function<int (std::string)> LOOKUP_FUNCTION;
 
 std::string trim(std::string &s, const std::string &space = " ");
@@ -64,6 +61,15 @@ public:
     std::string getText(const int type,
             const int id, const int count, const char **args) const;
 
+    /**
+     * Format text from the string table into a buffer, replacing its
+     * contents. Reusing the buffer avoids allocating for each message.
+     */
+    void getText(const int type, const int id,
+            const int count, const char **args, std::string &out) const;
+    void getText(const int type, const int id,
+            const std::vector<std::string> &args, std::string &out) const;
+
     /**
      * Populate the string table by reading a file.
      */
@@ -71,7 +77,32 @@ public:
             throw(SyntaxException);
 
 private:
-    TEXT_MAP m_text;
+    /**
+     * A piece of a template: either a range of m_literals or a reference to
+     * one of the arguments.
+     */
+    struct Segment {
+        unsigned int offset;
+        unsigned int length;
+        int arg;            // -1 for a literal
+    };
+
+    /** The segments [first, first + count) of m_segments. **/
+    struct Template {
+        unsigned int first;
+        unsigned int count;
+    };
+
+    const Template *getTemplate(const int type, const int id) const;
+    void compile(const int type, const int id, const std::string &text);
+
+    template <class ARGS>
+    void format(const Template &t, const int count, ARGS args,
+            std::string &out) const;
+
+    std::vector<std::vector<Template> > m_text;  // by category, then id
+    std::vector<Segment> m_segments;
+    std::string m_literals;
 };
 
 }
@@ -0,0 +1,230 @@
+/*
+ * File:   DamageFormulaTest.cpp
+ * Author: Catherine
+ *
+ * Created on October 19, 2026, 2:05 AM
+ *
+ * This file is a part of Shoddy Battle.
+ * Copyright (C) 2009  Catherine Fitzpatrick and Benjamin Gwin
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program; if not, visit the Free Software Foundation, Inc.
+ * online at http://gnu.org.
+ */
+
+#include <iostream>
+#include <climits>
+#include <cmath>
+#include <map>
+#include <vector>
+#include <boost/random.hpp>
+
+#include "../src/mechanics/DamageFormula.h"
+#include "../src/mechanics/JewelMechanics.h"
+#include "../src/mechanics/stat.h"
+
+/**
+ * Equivalence test for the integer damage pipeline. The reference functions
+ * below are the floating point versions that it replaced, working on the
+ * doubles that the scripts and the old stat tables supplied; the same inputs
+ * are converted with toFraction and run through the new pipeline, and the
+ * results must be identical. Some of the multipliers are deliberately not
+ * simple fractions.
+ *
+ * Run with "make test".
+ */
+
+using namespace std;
+using namespace shoddybattle;
+
+namespace {
+
+typedef map<int, double> REFERENCE_MAP;
+
+const double MULTIPLIERS[] = { 0.5, 0.75, 0.8, 0.9, 1.1, 1.2, 1.3, 1.5, 1.6,
+        2.0, 1.25, 1.33, 2.0 / 3.0, 0.125, 1.0 / 6.0, 1.4142, 0.0625 };
+const int MULTIPLIER_COUNT = sizeof(MULTIPLIERS) / sizeof(double);
+
+const double FACTORS[] = { 0.25, 0.5, 1.0, 2.0, 4.0 };
+
+// The stat tables from before multipliers were fractions.
+const double STAT_MULTIPLIER[] = { 4.0, 3.5, 3.0, 2.5, 2.0, 1.5, 1.0,
+        2.0/3.0, 0.5, 0.4, 1.0/3.0, 2.0/7.0, 0.25 };
+const double ACCURACY_MULTIPLIER[] = { 3.0, 2.66, 2.5, 2.0, 1.66, 1.33, 1.0,
+        0.75, 0.6, 0.5, 0.43, 0.36, 0.33 };
+
+boost::mt19937 g_rand(42);
+
+int randomInt(const int lower, const int upper) {
+    boost::uniform_int<> range(lower, upper);
+    return range(g_rand);
+}
+
+/**
+ * A set of modifiers in both forms.
+ */
+struct Modifiers {
+    REFERENCE_MAP reference;
+    PriorityMap fixed;
+
+    void set(const int priority, const double value) {
+        reference[priority] = value;
+        fixed[priority] = toFraction(value);
+    }
+    void fill(const int count) {
+        for (int i = 0; i < count; ++i) {
+            set(randomInt(-2, 5),
+                    MULTIPLIERS[randomInt(0, MULTIPLIER_COUNT - 1)]);
+        }
+    }
+    void fillStat(const STAT stat) {
+        fill(randomInt(0, 1));
+        const int level = randomInt(-6, 6);
+        const bool accuracy = (stat == S_ACCURACY) || (stat == S_EVASION);
+        reference[0] = accuracy ? ACCURACY_MULTIPLIER[6 - level]
+                : STAT_MULTIPLIER[6 - level];
+        fixed[0] = getStatMultiplier(stat, level);
+    }
+};
+
+void referenceMultiplyBy(int &value, const REFERENCE_MAP &elements) {
+    REFERENCE_MAP::const_iterator i = elements.begin();
+    for (; i != elements.end(); ++i) {
+        value *= i->second;
+    }
+}
+
+int referenceMultiplyOut(const REFERENCE_MAP &elements) {
+    REFERENCE_MAP::const_iterator i = elements.begin();
+    double value = i->second;
+    for (++i; i != elements.end(); ++i) {
+        value = floor(value * i->second);
+    }
+    return int(value);
+}
+
+struct Input {
+    int level, power, attack, defence, critical, roll, accuracy;
+    double stab;
+    vector<double> factors;
+    Modifiers attackMods, defenceMods, accuracyMods;
+    Modifiers mods[ModifierSet::POSITION_COUNT];
+};
+
+int referenceAccuracy(Input &in) {
+    int accuracy = in.accuracy;
+    referenceMultiplyBy(accuracy, in.accuracyMods.reference);
+    return accuracy;
+}
+
+int fixedAccuracy(Input &in) {
+    int accuracy = in.accuracy;
+    multiplyBy(accuracy, in.accuracyMods.fixed);
+    return accuracy;
+}
+
+int referenceDamage(Input &in) {
+    int attack = in.attack, defence = in.defence;
+    referenceMultiplyBy(attack, in.attackMods.reference);
+    referenceMultiplyBy(defence, in.defenceMods.reference);
+    if (defence == 0) {
+        // The engine cannot divide by this either.
+        return -1;
+    }
+    int damage = (in.level * 2 / 5 + 2)
+            * referenceMultiplyOut(in.mods[0].reference)
+            * attack / 50 / defence;
+    referenceMultiplyBy(damage, in.mods[1].reference);
+    damage = (damage + 2) * in.critical;
+    referenceMultiplyBy(damage, in.mods[2].reference);
+    if (damage > INT_MAX / (255 * 100)) {
+        // The roll overflows an int in both versions; nothing gets near this
+        // in a real battle.
+        return -1;
+    }
+    damage = damage * in.roll * 100 / 255 / 100;
+    damage *= in.stab;
+    for (size_t i = 0; i < in.factors.size(); ++i) {
+        damage *= in.factors[i];
+    }
+    referenceMultiplyBy(damage, in.mods[3].reference);
+    return (damage < 1) ? 1 : damage;
+}
+
+int fixedDamage(Input &in) {
+    int attack = in.attack, defence = in.defence;
+    multiplyBy(attack, in.attackMods.fixed);
+    multiplyBy(defence, in.defenceMods.fixed);
+    if (defence == 0) {
+        return -1;
+    }
+    int damage = (in.level * 2 / 5 + 2) * multiplyOut(in.mods[0].fixed)
+            * attack / 50 / defence;
+    multiplyBy(damage, in.mods[1].fixed);
+    damage = (damage + 2) * in.critical;
+    multiplyBy(damage, in.mods[2].fixed);
+    applyRoll(&damage, 1, in.roll);
+    applyPostRoll(&damage, 1, in.stab, in.factors, in.mods[3].fixed);
+    return damage;
+}
+
+} // anonymous namespace
+
+int main() {
+    const int ITERATIONS = 2000000;
+    int mismatches = 0, skipped = 0;
+    for (int i = 0; i < ITERATIONS; ++i) {
+        Input in;
+        in.level = randomInt(1, 100);
+        in.power = randomInt(10, 150);
+        in.attack = randomInt(5, 500);
+        in.defence = randomInt(50, 500);
+        in.critical = randomInt(1, 3);
+        in.roll = randomInt(DamageDistribution::ROLL_MIN,
+                DamageDistribution::ROLL_MAX);
+        const double STABS[] = { 1.0, 1.5, 2.0 };
+        in.stab = STABS[randomInt(0, 2)];
+        const int factors = randomInt(0, 2);
+        for (int j = 0; j < factors; ++j) {
+            in.factors.push_back(FACTORS[randomInt(0, 4)]);
+        }
+        in.attackMods.fillStat(S_ATTACK);
+        in.defenceMods.fillStat(S_DEFENCE);
+        in.accuracy = randomInt(30, 100);
+        in.accuracyMods.fillStat(S_ACCURACY);
+        in.mods[0].fill(randomInt(0, 1));
+        in.mods[0].set(0, in.power);
+        for (int j = 1; j < ModifierSet::POSITION_COUNT; ++j) {
+            in.mods[j].fill(randomInt(0, 2));
+        }
+        int expected = referenceDamage(in);
+        if (expected == -1) {
+            ++skipped;
+            continue;
+        }
+        int actual = fixedDamage(in);
+        if (expected == actual) {
+            expected = referenceAccuracy(in);
+            actual = fixedAccuracy(in);
+        }
+        if (expected != actual) {
+            if (++mismatches <= 10) {
+                cout << "mismatch at " << i << ": expected " << expected
+                        << ", got " << actual << endl;
+            }
+        }
+    }
+    cout << ITERATIONS << " inputs, " << skipped << " out of range, "
+            << mismatches << " mismatches" << endl;
+    return (mismatches == 0) ? 0 : 1;
+}
@@ -0,0 +1,139 @@
+/*
+ * File:   DamageQueryTest.cpp
+ * Author: Catherine
+ *
+ * Created on October 19, 2026, 1:20 AM
+ *
+ * This file is a part of Shoddy Battle.
+ * Copyright (C) 2009  Catherine Fitzpatrick and Benjamin Gwin
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program; if not, visit the Free Software Foundation, Inc.
+ * online at http://gnu.org.
+ */
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "../src/shoddybattle/BattleField.h"
+#include "../src/shoddybattle/Pokemon.h"
+#include "../src/shoddybattle/PokemonSpecies.h"
+#include "../src/mechanics/JewelMechanics.h"
+#include "../src/mechanics/PokemonNature.h"
+#include "../src/matchmaking/MetagameList.h"
+#include "../src/scripting/ScriptMachine.h"
+
+/**
+ * Check that JewelMechanics::getDamageDistribution leaves the battle exactly
+ * as it found it. The target holds an Occa Berry, whose modifier normally
+ * prints a message and consumes the berry when a super effective fire move
+ * hits; a query must do neither, but must still include the berry in the
+ * damage it reports.
+ *
+ * Run from the top of the tree with "make test".
+ */
+
+using namespace std;
+using namespace shoddybattle;
+
+namespace {
+
+/**
+ * A battle that counts the messages it would have narrated.
+ */
+class CountingBattle : public BattleField {
+public:
+    CountingBattle(): m_printed(0) { }
+    void print(const TextMessage &) {
+        if (isNarrationEnabled()) {
+            ++m_printed;
+        }
+    }
+    int getPrinted() const { return m_printed; }
+private:
+    int m_printed;
+};
+
+Pokemon::PTR makePokemon(const SpeciesDatabase *species,
+        const string &name, const string &ability, const string &item,
+        const string &move) {
+    const int iv[STAT_COUNT] = { 31, 31, 31, 31, 31, 31 };
+    const int ev[STAT_COUNT] = { 0, 0, 0, 0, 0, 0 };
+    vector<string> moves(1, move);
+    vector<int> ppUps(1, 0);
+    return Pokemon::PTR(new Pokemon(species->getSpecies(name), name,
+            PokemonNature::getNature(0), ability, item, iv, ev, 100, 0, 255,
+            false, moves, ppUps));
+}
+
+bool check(const char *what, const bool pass) {
+    cout << what << ": " << (pass ? "pass" : "FAIL") << endl;
+    return pass;
+}
+
+} // anonymous namespace
+
+int main() {
+    ScriptMachine machine;
+    machine.acquireContext()->runFile("resources/main.js");
+    machine.finalise();
+    vector<GenerationPtr> generations;
+    Generation::readGenerations("resources/metagames.xml", generations);
+
+    ScriptContextPtr cx = machine.acquireContext();
+    ScriptContextLock cxLock(cx);
+
+    const SpeciesDatabase *species = machine.getSpeciesDatabase();
+    Pokemon::ARRAY teams[TEAM_COUNT];
+    teams[0].push_back(makePokemon(species, "Charizard", "Blaze", "",
+            "Flamethrower"));
+    teams[1].push_back(makePokemon(species, "Scizor", "Technician",
+            "Occa Berry", "Bullet Punch"));
+    const string trainer[TEAM_COUNT] = { "Alice", "Bob" };
+    vector<StatusObject> clauses;
+
+    JewelMechanics mech(42);
+    CountingBattle field;
+    field.initialise(&mech, generations[0].get(), &machine, teams, trainer,
+            1, clauses);
+    field.beginBattle();
+
+    Pokemon::PTR user = field.getActivePokemon(0, 0);
+    Pokemon::PTR target = field.getActivePokemon(1, 0);
+    const int printed = field.getPrinted();
+    const int hp = target->getHp();
+
+    DamageDistribution dist;
+    mech.getDamageDistribution(field, *user->getMove(0), *user, *target, 1,
+            dist);
+    const int last = DamageDistribution::ROLL_COUNT - 1;
+
+    bool pass = true;
+    pass &= check("berry kept", target->getItemName() == "Occa Berry");
+    pass &= check("nothing printed", field.getPrinted() == printed);
+    pass &= check("health unchanged", target->getHp() == hp);
+    pass &= check("query mode left", !field.isQuery()
+            && field.isNarrationEnabled());
+
+    // A real hit does eat the berry, and does the damage that the query
+    // reported for the highest roll.
+    const int damage = mech.calculateDamage(field, *user->getMove(0), *user,
+            *target, 1, false);
+    pass &= check("berry used by a real hit", !target->getItem());
+    pass &= check("damage matches", (damage == dist.normal[last])
+            || (damage == dist.critical[last]));
+
+    field.terminate();
+    return pass ? 0 : 1;
+}
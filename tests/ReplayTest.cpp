@@ -0,0 +1,308 @@
+/*
+ * File:   ReplayTest.cpp
+ * Author: Catherine
+ *
+ * Created on October 19, 2026, 1:35 AM
+ *
+ * This file is a part of Shoddy Battle.
+ * Copyright (C) 2009  Catherine Fitzpatrick and Benjamin Gwin
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program; if not, visit the Free Software Foundation, Inc.
+ * online at http://gnu.org.
+ */
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "../src/shoddybattle/BattleField.h"
+#include "../src/shoddybattle/BattleRecord.h"
+#include "../src/shoddybattle/ReplayBattle.h"
+#include "../src/shoddybattle/Pokemon.h"
+#include "../src/shoddybattle/PokemonSpecies.h"
+#include "../src/mechanics/JewelMechanics.h"
+#include "../src/mechanics/PokemonNature.h"
+#include "../src/matchmaking/MetagameList.h"
+#include "../src/scripting/ScriptMachine.h"
+
+/**
+ * Record a battle in which every turn forces both players to pick a
+ * replacement in the middle of the turn (each pokemon only knows U-turn),
+ * then check that:
+ *
+ *   1) replaying the record reports exactly the same events;
+ *   2) a record whose selection names a pokemon that is not on the team is
+ *      rejected; and
+ *   3) a record whose selection names a different pokemon is rejected.
+ *
+ * The binary form of a record is also checked separately, including a
+ * forfeit made while a player was choosing a pokemon, which is recorded as a
+ * selection of -1 followed by the forfeit.
+ *
+ * The recording side follows NetworkBattleImpl: selections are recorded as
+ * they are made, and each turn is recorded before it is processed.
+ *
+ * Run from the top of the tree with "make test".
+ */
+
+using namespace std;
+using namespace shoddybattle;
+
+namespace {
+
+const int TURN_COUNT = 4;
+
+/**
+ * A battle played by two players who always pick the first pokemon they
+ * are allowed to, recorded as NetworkBattle would record it.
+ */
+class RecordingBattle : public BattleField {
+public:
+    RecordingBattle(BattleRecord &record):
+            m_record(record),
+            m_mech(record.seed),
+            m_victory(false) { }
+
+    void play(ScriptMachine *machine, Generation *generation,
+            Pokemon::ARRAY teams[TEAM_COUNT]) {
+        vector<StatusObject> clauses;
+        initialise(&m_mech, generation, machine, teams, m_record.trainer,
+                m_record.partySize, clauses);
+        beginBattle();
+        for (int i = 0; !m_victory && (i < TURN_COUNT); ++i) {
+            Pokemon::ARRAY active;
+            getActivePokemon(active);
+            Pokemon::ARRAY::iterator j = active.begin();
+            for (; j != active.end(); ++j) {
+                (*j)->determineLegalActions();
+            }
+            vector<PokemonTurn> turns;
+            turns.push_back(PokemonTurn(TT_MOVE, 0, 1));
+            turns.push_back(PokemonTurn(TT_MOVE, 0, 0));
+            m_record.steps.push_back(BattleStep(BattleStep::S_TURN));
+            m_record.steps.back().turns = turns;
+            processTurn(turns);
+        }
+        terminate();
+        m_record.digest = m_digest.getHash();
+        m_record.eventCount = m_digest.getCount();
+    }
+
+    Pokemon *requestInactivePokemon(Pokemon *pokemon) {
+        vector<bool> switches;
+        getLegalSwitches(pokemon, switches);
+        for (unsigned int i = 0; i < switches.size(); ++i) {
+            if (switches[i]) {
+                m_record.steps.push_back(
+                        BattleStep(BattleStep::S_SELECTION, i));
+                return getTeam(pokemon->getParty())[i].get();
+            }
+        }
+        return NULL;
+    }
+
+    void print(const TextMessage &msg) {
+        if (!isNarrationEnabled())
+            return;
+        m_digest.print(msg);
+    }
+    void informVictory(const int party) {
+        m_victory = true;
+        m_digest.victory(party);
+    }
+    void informUseMove(Pokemon *pokemon, MoveObject *move) {
+        m_digest.useMove(pokemon, move->getTemplate(getContext())->getId());
+    }
+    void informWithdraw(Pokemon *pokemon) {
+        m_digest.withdraw(pokemon);
+    }
+    void informSendOut(Pokemon *pokemon) {
+        m_digest.sendOut(pokemon);
+    }
+    void informHealthChange(Pokemon *pokemon, const int raw) {
+        m_digest.healthChange(pokemon, raw);
+    }
+    void informSetPp(Pokemon *pokemon, const int move, const int pp) {
+        m_digest.setPp(pokemon, move, pp);
+    }
+    void informSetMove(Pokemon *pokemon, const int idx, const int move,
+            const int pp, const int maxPp) {
+        m_digest.setMove(pokemon, idx, move, pp, maxPp);
+    }
+    void informFainted(Pokemon *pokemon) {
+        m_digest.fainted(pokemon);
+    }
+    void informStatusChange(Pokemon *p, StatusObject *effect,
+            const bool applied) {
+        m_digest.statusChange(p, effect->getId(getContext()), applied);
+    }
+
+private:
+    BattleRecord &m_record;
+    JewelMechanics m_mech;
+    EventDigest m_digest;
+    bool m_victory;
+};
+
+Pokemon::PTR makePokemon(const SpeciesDatabase *species,
+        const string &name) {
+    const int iv[STAT_COUNT] = { 31, 31, 31, 31, 31, 31 };
+    const int ev[STAT_COUNT] = { 0, 0, 0, 0, 0, 0 };
+    vector<string> moves(1, "U-turn");
+    vector<int> ppUps(1, 3);
+    return Pokemon::PTR(new Pokemon(species->getSpecies(name), name,
+            PokemonNature::getNature(0), "", "", iv, ev, 100, 0, 255,
+            false, moves, ppUps));
+}
+
+bool replay(ScriptMachine *machine, Generation *generation,
+        const BattleRecord &record) {
+    ReplayBattle battle(record);
+    return battle.run(machine, generation);
+}
+
+bool sameSteps(const BattleStep &a, const BattleStep &b) {
+    if ((a.type != b.type) || (a.value != b.value)
+            || (a.turns.size() != b.turns.size()))
+        return false;
+    for (size_t i = 0; i < a.turns.size(); ++i) {
+        const PokemonTurn &x = a.turns[i], &y = b.turns[i];
+        if ((x.type != y.type) || (x.id != y.id) || (x.target != y.target))
+            return false;
+    }
+    return true;
+}
+
+bool roundTrip() {
+    BattleRecord record;
+    record.seed = 123456789;
+    record.generation = 1;
+    record.partySize = 2;
+    record.metagame = 3;
+    record.trainer[0] = "Bob";
+    record.trainer[1] = "Alice";
+    record.clauses.push_back("Sleep Clause");
+    record.digest = 0xdeadbeef;
+    record.eventCount = 42;
+
+    BattleStep turn(BattleStep::S_TURN);
+    turn.turns.push_back(PokemonTurn(TT_MOVE, 0, 2));
+    turn.turns.push_back(PokemonTurn(TT_SWITCH, 4, -1));
+    record.steps.push_back(turn);
+    record.steps.push_back(BattleStep(BattleStep::S_SELECTION, 3));
+    record.steps.push_back(BattleStep(BattleStep::S_SELECTION, -1));
+    record.steps.push_back(BattleStep(BattleStep::S_FORFEIT, 1));
+
+    vector<unsigned char> data;
+    record.write(data);
+    BattleRecord copy;
+    bool pass = copy.read(data)
+            && (copy.seed == record.seed)
+            && (copy.generation == record.generation)
+            && (copy.partySize == record.partySize)
+            && (copy.metagame == record.metagame)
+            && (copy.trainer[0] == record.trainer[0])
+            && (copy.trainer[1] == record.trainer[1])
+            && (copy.clauses == record.clauses)
+            && (copy.digest == record.digest)
+            && (copy.eventCount == record.eventCount)
+            && (copy.steps.size() == record.steps.size());
+    for (size_t i = 0; pass && (i < record.steps.size()); ++i) {
+        pass = sameSteps(copy.steps[i], record.steps[i]);
+    }
+    return pass;
+}
+
+bool badStepRejected() {
+    BattleRecord record;
+    record.steps.push_back(BattleStep(BattleStep::TYPE(9)));
+    vector<unsigned char> data;
+    record.write(data);
+    BattleRecord copy;
+    return !copy.read(data);
+}
+
+bool check(const char *what, const bool pass) {
+    cout << what << ": " << (pass ? "pass" : "FAIL") << endl;
+    return pass;
+}
+
+} // anonymous namespace
+
+int main() {
+    ScriptMachine machine;
+    machine.acquireContext()->runFile("resources/main.js");
+    machine.finalise();
+    vector<GenerationPtr> generations;
+    Generation::readGenerations("resources/metagames.xml", generations);
+    Generation *generation = generations[0].get();
+
+    const SpeciesDatabase *species = machine.getSpeciesDatabase();
+    const char *names[] = { "Blissey", "Skarmory", "Blissey" };
+    Pokemon::ARRAY teams[TEAM_COUNT];
+    BattleRecord record;
+    record.seed = 20091019;
+    record.trainer[0] = "Alice";
+    record.trainer[1] = "Bob";
+    for (int i = 0; i < TEAM_COUNT; ++i) {
+        for (int j = 0; j < 3; ++j) {
+            Pokemon::PTR p = makePokemon(species, names[j]);
+            record.teams[i].push_back(PokemonRecord(*p));
+            teams[i].push_back(p);
+        }
+    }
+
+    {
+        ScriptContextPtr cx = machine.acquireContext();
+        ScriptContextLock cxLock(cx);
+        RecordingBattle battle(record);
+        battle.play(&machine, generation, teams);
+    }
+
+    int selections = 0;
+    BattleStep *first = NULL;
+    vector<BattleStep>::iterator i = record.steps.begin();
+    for (; i != record.steps.end(); ++i) {
+        if (i->type == BattleStep::S_SELECTION) {
+            if (!first) first = &*i;
+            ++selections;
+        }
+    }
+
+    bool pass = true;
+    pass &= check("round trip", roundTrip());
+    pass &= check("bad step type rejected", badStepRejected());
+    pass &= check("selections recorded", selections >= 2 * TURN_COUNT);
+    pass &= check("replay matches", replay(&machine, generation, record));
+
+    // The record survives being written out and read back in.
+    vector<unsigned char> data;
+    record.write(data);
+    BattleRecord copy;
+    pass &= check("replay after round trip", copy.read(data)
+            && replay(&machine, generation, copy));
+
+    if (first) {
+        const int value = first->value;
+        first->value = 7;
+        pass &= check("selection off the team rejected",
+                !replay(&machine, generation, record));
+        first->value = (value == 1) ? 2 : 1;
+        pass &= check("different selection rejected",
+                !replay(&machine, generation, record));
+        first->value = value;
+    }
+
+    return pass ? 0 : 1;
+}
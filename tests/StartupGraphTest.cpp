@@ -0,0 +1,188 @@
+/*
+ * File:   StartupGraphTest.cpp
+ * Author: Catherine
+ *
+ * Created on October 19, 2026, 2:15 AM
+ *
+ * This file is a part of Shoddy Battle.
+ * Copyright (C) 2009  Catherine Fitzpatrick and Benjamin Gwin
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program; if not, visit the Free Software Foundation, Inc.
+ * online at http://gnu.org.
+ */
+
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+
+#include "../src/main/ServerStartup.h"
+#include "../src/main/StartupGraph.h"
+
+/**
+ * Test of the order in which the server starts up. Every step of the real
+ * ServerStartup graph is replaced by one that records when it ran; the steps
+ * that others wait for take longest, so that a missing edge shows up as a
+ * step running too early.
+ *
+ * Run with "make test".
+ */
+
+using namespace std;
+using namespace boost;
+using namespace shoddybattle;
+
+namespace {
+
+class Recorder {
+public:
+    void run(const string name, const int ms) {
+        this_thread::sleep(posix_time::milliseconds(ms));
+        lock_guard<mutex> lock(m_mutex);
+        m_order.push_back(name);
+    }
+
+    void fail(const string name) {
+        run(name, 0);
+        throw runtime_error("failed");
+    }
+
+    /**
+     * Whether first finished before second started (and both ran).
+     */
+    bool before(const string &first, const string &second) const {
+        const int i = position(first);
+        const int j = position(second);
+        return (i != -1) && (j != -1) && (i < j);
+    }
+
+    bool ran(const string &name) const {
+        return position(name) != -1;
+    }
+
+private:
+    int position(const string &name) const {
+        const int size = m_order.size();
+        for (int i = 0; i < size; ++i) {
+            if (m_order[i] == name)
+                return i;
+        }
+        return -1;
+    }
+
+    mutex m_mutex;
+    vector<string> m_order;
+};
+
+ServerStartup makeStartup(Recorder &r) {
+    ServerStartup s;
+    s.metagames = bind(&Recorder::run, &r, "metagames", 40);
+    s.scripts = bind(&Recorder::run, &r, "scripts", 40);
+    s.database = bind(&Recorder::run, &r, "database", 80);
+    s.welcome = bind(&Recorder::run, &r, "welcome", 0);
+    s.channels = bind(&Recorder::run, &r, "channels", 0);
+    s.bans = bind(&Recorder::run, &r, "bans", 20);
+    s.clauses = bind(&Recorder::run, &r, "clauses", 60);
+    s.matchmaking = bind(&Recorder::run, &r, "matchmaking", 0);
+    return s;
+}
+
+bool check(const char *what, const bool pass) {
+    cout << what << ": " << (pass ? "pass" : "FAIL") << endl;
+    return pass;
+}
+
+/**
+ * Three independent steps followed by one that depends on all of them
+ * should take about two steps' time.
+ */
+bool independentStepsOverlap() {
+    Recorder r;
+    StartupGraph graph;
+    const int a = graph.add("a", bind(&Recorder::run, &r, "a", 100));
+    const int b = graph.add("b", bind(&Recorder::run, &r, "b", 100));
+    const int c = graph.add("c", bind(&Recorder::run, &r, "c", 100));
+    const int d = graph.add("d", bind(&Recorder::run, &r, "d", 100));
+    graph.depend(d, a);
+    graph.depend(d, b);
+    graph.depend(d, c);
+    const posix_time::ptime start = posix_time::microsec_clock::universal_time();
+    graph.run(4);
+    const posix_time::time_duration taken =
+            posix_time::microsec_clock::universal_time() - start;
+    return r.before("a", "d") && r.before("b", "d") && r.before("c", "d")
+            && (taken.total_milliseconds() < 300);
+}
+
+bool cycleRejected() {
+    Recorder r;
+    StartupGraph graph;
+    const int a = graph.add("a", bind(&Recorder::run, &r, "a", 0));
+    const int b = graph.add("b", bind(&Recorder::run, &r, "b", 0));
+    graph.depend(a, b);
+    graph.depend(b, a);
+    try {
+        graph.run(2);
+    } catch (runtime_error &) {
+        return !r.ran("a") && !r.ran("b");
+    }
+    return false;
+}
+
+/**
+ * A step that throws (as matchmaking does when a ladder cannot be set up)
+ * is named in the error, and nothing that waits on it runs.
+ */
+bool failureReported() {
+    Recorder r;
+    StartupGraph graph;
+    ServerStartup s = makeStartup(r);
+    s.clauses = bind(&Recorder::fail, &r, "clauses");
+    s.addTo(graph);
+    try {
+        graph.run(4);
+    } catch (runtime_error &e) {
+        return (string(e.what()) == "clauses: failed")
+                && !r.ran("matchmaking");
+    }
+    return false;
+}
+
+} // anonymous namespace
+
+int main() {
+    Recorder r;
+    StartupGraph graph;
+    makeStartup(r).addTo(graph);
+    graph.run(4);
+
+    bool pass = true;
+    pass &= check("scripts after metagames", r.before("metagames", "scripts"));
+    pass &= check("welcome after database", r.before("database", "welcome"));
+    pass &= check("channels after database",
+            r.before("database", "channels"));
+    pass &= check("bans after scripts", r.before("scripts", "bans"));
+    pass &= check("clauses after bans", r.before("bans", "clauses"));
+    pass &= check("matchmaking after bans", r.before("bans", "matchmaking"));
+    pass &= check("matchmaking after database",
+            r.before("database", "matchmaking"));
+    pass &= check("matchmaking after clauses",
+            r.before("clauses", "matchmaking"));
+    pass &= check("independent steps overlap", independentStepsOverlap());
+    pass &= check("cycle rejected", cycleRejected());
+    pass &= check("failure reported", failureReported());
+    return pass ? 0 : 1;
+}